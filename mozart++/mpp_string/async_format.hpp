@@ -0,0 +1,373 @@
+/**
+ * Mozart++ Template Library: String
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#pragma once
+
+#include <mozart++/core>
+#include <mozart++/string>
+#include "format.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace mpp_impl {
+    /**
+     * Bytes available for the arguments of a deferred message.
+     */
+    static constexpr size_t async_payload_size = 96;
+
+    template <typename ...Ts>
+    struct all_trivially_copyable : std::true_type {
+    };
+
+    template <typename T, typename ...Ts>
+    struct all_trivially_copyable<T, Ts...>
+            : std::integral_constant<bool, std::is_trivially_copyable<T>::value
+                                           && all_trivially_copyable<Ts...>::value> {
+    };
+
+    /**
+     * A message waiting in the ring: the format string, the arguments
+     * copied by value, and the function that knows their types.
+     */
+    struct async_record {
+        std::atomic<size_t> sequence;
+        void (*write)(std::ostream &, const char *, const void *);
+        const char *fmt;
+        alignas(std::max_align_t) unsigned char payload[async_payload_size];
+    };
+
+    template <typename Tuple, size_t ...I>
+    void write_async_tuple(std::ostream &out, const char *fmt, const Tuple &args, std::index_sequence<I...>) {
+        mpp_impl::format_ref(out, mpp::string_ref::with(fmt), std::get<I>(args)...);
+    }
+
+    template <typename Tuple>
+    void write_async_record(std::ostream &out, const char *fmt, const void *payload) {
+        write_async_tuple(out, fmt, *static_cast<const Tuple *>(payload),
+                          std::make_index_sequence<std::tuple_size<Tuple>::value>());
+    }
+
+    inline size_t round_up_power_of_two(size_t n) {
+        size_t result = 2;
+        while (result < n) {
+            result <<= 1;
+        }
+        return result;
+    }
+}
+
+namespace mpp {
+    /**
+     * What async_formatter::post() does when the ring is full.
+     */
+    enum class async_overflow {
+        /**
+         * Wait for the consumer to make room.
+         */
+        block,
+        /**
+         * Discard the message.
+         */
+        drop,
+        /**
+         * Discard the message, and have the consumer report how many
+         * messages were lost through the sink, before the next one or
+         * once it has caught up.
+         */
+        count,
+    };
+
+    struct async_format_options {
+        /**
+         * Messages the ring holds, rounded up to a power of two.
+         */
+        size_t capacity = 4096;
+        async_overflow overflow = async_overflow::block;
+    };
+
+    /**
+     * Deferred formatting: post() copies the format string pointer and the
+     * arguments into a lock-free ring buffer, and a background thread does
+     * the actual mpp::format() and hands the text to a sink.
+     *
+     * Any number of threads may post (the ring is a bounded MPSC queue; a
+     * single producer never contends). Since formatting happens later, on
+     * another thread, the format string must outlive the formatter (use
+     * string literals) and arguments must be trivially copyable and not
+     * point to anything that may go away: numbers, chars, enums and
+     * pointers to static strings, not std::string.
+     *
+     *     mpp::async_formatter log([](mpp::string_ref line) {
+     *         fwrite(line.data(), 1, line.size(), stderr);
+     *     });
+     *     log.post("request {} took {.3} ms\n", id, ms);
+     */
+    class async_formatter {
+    public:
+        using sink_type = mpp::function<void(string_ref)>;
+
+    private:
+        std::unique_ptr<mpp_impl::async_record[]> _ring;
+        size_t _mask;
+        async_overflow _overflow;
+        sink_type _sink;
+
+        // Producers claim slots here, padded to a cache line of its own.
+        // Padding rather than alignas(64): C++14 operator new does not
+        // honor over-alignment, and formatters may live on the heap.
+        char _pad_before[64];
+        std::atomic<size_t> _enqueue_pos{0};
+        char _pad_after[64 - sizeof(std::atomic<size_t>)];
+        // the consumer's position, and the messages it has handed to the sink
+        std::atomic<size_t> _dequeue_pos{0};
+        std::atomic<size_t> _written{0};
+        std::atomic<size_t> _dropped{0};
+        std::atomic<bool> _sleeping{false};
+        std::atomic<bool> _stopping{false};
+
+        std::mutex _lock;
+        std::condition_variable _wakeup;
+        std::thread _consumer;
+
+        /**
+         * Wake the consumer after publishing. The fence pairs with the
+         * one in run(): either the consumer sees what was published, or
+         * this sees it sleeping.
+         */
+        void wake_consumer() {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (_sleeping.load(std::memory_order_relaxed)) {
+                std::lock_guard<std::mutex> guard(_lock);
+                _wakeup.notify_one();
+            }
+        }
+
+        /**
+         * Claim a free slot, or nullptr if the ring is full.
+         */
+        mpp_impl::async_record *claim(size_t &pos) {
+            pos = _enqueue_pos.load(std::memory_order_relaxed);
+            for (;;) {
+                mpp_impl::async_record &record = _ring[pos & _mask];
+                size_t sequence = record.sequence.load(std::memory_order_acquire);
+                auto diff = static_cast<std::ptrdiff_t>(sequence - pos);
+                if (diff == 0) {
+                    if (_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        return &record;
+                    }
+                } else if (diff < 0) {
+                    return nullptr;
+                } else {
+                    pos = _enqueue_pos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        void emit(std::ostringstream &out, const std::string &text) {
+            try {
+                _sink(text);
+            } catch (...) {
+                // a failing sink must not take the consumer down
+            }
+            out.str(std::string());
+            out.clear();
+        }
+
+        /**
+         * Report the messages dropped since the last report, in count mode.
+         */
+        void report_dropped(std::ostringstream &out, size_t &reported) {
+            if (_overflow != async_overflow::count) {
+                return;
+            }
+            size_t dropped = _dropped.load(std::memory_order_relaxed);
+            if (dropped != reported) {
+                mpp_impl::format(out, "async_formatter: {} message(s) dropped\n", dropped - reported);
+                reported = dropped;
+                emit(out, out.str());
+            }
+        }
+
+        /**
+         * Format every published message, returning how many there were.
+         * Drops are reported before the next message, or once the ring
+         * is empty.
+         */
+        size_t drain(std::ostringstream &out, size_t &reported) {
+            size_t pos = _dequeue_pos.load(std::memory_order_relaxed);
+            size_t done = 0;
+            for (;;) {
+                mpp_impl::async_record &record = _ring[pos & _mask];
+                if (record.sequence.load(std::memory_order_acquire) != pos + 1) {
+                    break;
+                }
+                report_dropped(out, reported);
+                bool formatted = true;
+                try {
+                    record.write(out, record.fmt, record.payload);
+                } catch (...) {
+                    // skip messages that fail to format, with what they wrote
+                    formatted = false;
+                    out.str(std::string());
+                    out.clear();
+                }
+                // hand the slot back before the sink runs, producers may be waiting
+                record.sequence.store(pos + _mask + 1, std::memory_order_release);
+                _dequeue_pos.store(++pos, std::memory_order_release);
+                if (formatted) {
+                    emit(out, out.str());
+                }
+                _written.store(pos, std::memory_order_release);
+                ++done;
+            }
+            report_dropped(out, reported);
+            return done;
+        }
+
+        void run() {
+            std::ostringstream out;
+            size_t reported = 0;
+            for (;;) {
+                if (drain(out, reported) != 0) {
+                    continue;
+                }
+                if (_stopping.load()) {
+                    // producers are gone: whatever was claimed is published
+                    if (_dequeue_pos.load() == _enqueue_pos.load()) {
+                        return;
+                    }
+                    std::this_thread::yield();
+                    continue;
+                }
+                std::unique_lock<std::mutex> guard(_lock);
+                _sleeping.store(true, std::memory_order_relaxed);
+                // pairs with the fence in wake_consumer(): either the check
+                // below sees the message, or its producer sees the flag
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                size_t pos = _dequeue_pos.load(std::memory_order_relaxed);
+                if (_ring[pos & _mask].sequence.load(std::memory_order_acquire) != pos + 1
+                    && (_overflow != async_overflow::count || _dropped.load(std::memory_order_relaxed) == reported)
+                    && !_stopping.load()) {
+                    _wakeup.wait(guard);
+                }
+                _sleeping.store(false, std::memory_order_relaxed);
+            }
+        }
+
+    public:
+        /**
+         * Start the consumer thread.
+         *
+         * @param sink called on the consumer thread with every formatted message
+         * @param options
+         */
+        explicit async_formatter(sink_type sink, const async_format_options &options = async_format_options())
+                : _ring(new mpp_impl::async_record[mpp_impl::round_up_power_of_two(options.capacity)]),
+                  _mask(mpp_impl::round_up_power_of_two(options.capacity) - 1),
+                  _overflow(options.overflow),
+                  _sink(std::move(sink)) {
+            for (size_t i = 0; i <= _mask; ++i) {
+                _ring[i].sequence.store(i, std::memory_order_relaxed);
+            }
+            _consumer = std::thread([this] { run(); });
+        }
+
+        async_formatter(const async_formatter &) = delete;
+        async_formatter &operator=(const async_formatter &) = delete;
+
+        /**
+         * Format the remaining messages and stop the consumer.
+         * No thread may post() concurrently.
+         */
+        ~async_formatter() {
+            _stopping.store(true);
+            {
+                std::lock_guard<std::mutex> guard(_lock);
+                _wakeup.notify_one();
+            }
+            _consumer.join();
+        }
+
+        /**
+         * Queue a message for formatting on the consumer thread.
+         *
+         * @param fmt a format string for mpp::format() that outlives the formatter
+         * @param args trivially copyable arguments, copied by value
+         * @return false if the message was dropped because the ring was full
+         */
+        template <typename ...Args>
+        bool post(const char *fmt, Args &&... args) {
+            using tuple_type = std::tuple<std::decay_t<Args>...>;
+            static_assert(mpp_impl::all_trivially_copyable<std::decay_t<Args>...>::value,
+                          "async_formatter: arguments must be trivially copyable");
+            static_assert(sizeof(tuple_type) <= mpp_impl::async_payload_size,
+                          "async_formatter: arguments too large");
+            static_assert(alignof(tuple_type) <= alignof(std::max_align_t),
+                          "async_formatter: arguments over-aligned");
+
+            size_t pos = 0;
+            mpp_impl::async_record *record = claim(pos);
+            while (record == nullptr) {
+                if (_overflow != async_overflow::block) {
+                    _dropped.fetch_add(1, std::memory_order_relaxed);
+                    if (_overflow == async_overflow::count) {
+                        // the consumer reports it even if nothing follows
+                        wake_consumer();
+                    }
+                    return false;
+                }
+                wake_consumer();
+                std::this_thread::yield();
+                record = claim(pos);
+            }
+
+            new(record->payload) tuple_type(std::forward<Args>(args)...);
+            record->write = &mpp_impl::write_async_record<tuple_type>;
+            record->fmt = fmt;
+            record->sequence.store(pos + 1, std::memory_order_release);
+            wake_consumer();
+            return true;
+        }
+
+        /**
+         * Wait until every message posted before the call has been
+         * handed to the sink.
+         */
+        void flush() {
+            size_t target = _enqueue_pos.load();
+            while (_written.load(std::memory_order_acquire) < target) {
+                wake_consumer();
+                std::this_thread::yield();
+            }
+        }
+
+        /**
+         * Get the number of messages dropped so far.
+         */
+        size_t dropped() const {
+            return _dropped.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Get the number of messages the ring holds.
+         */
+        size_t capacity() const {
+            return _mask + 1;
+        }
+    };
+}
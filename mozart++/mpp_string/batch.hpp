@@ -0,0 +1,343 @@
+/**
+ * Mozart++ Template Library: String
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#pragma once
+
+#include <mozart++/core>
+#include <mozart++/string>
+#include "simd.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace mpp {
+    /**
+     * One bit per row, set for the selected rows: the result of the batch
+     * predicates and of column scans. Bit i lives in word i / 64, at
+     * i % 64, and the bits past size() are always clear.
+     */
+    class selection_bitmap {
+    private:
+        std::vector<std::uint64_t> _words;
+        size_t _size = 0;
+
+        void clear_padding() {
+            if (_size % 64 != 0) {
+                _words.back() &= (std::uint64_t(1) << (_size % 64)) - 1;
+            }
+        }
+
+    public:
+        selection_bitmap() = default;
+
+        explicit selection_bitmap(size_t size, bool value = false)
+                : _words((size + 63) / 64, value ? ~std::uint64_t(0) : 0), _size(size) {
+            clear_padding();
+        }
+
+        /**
+         * Change the number of rows, rows added are not selected.
+         *
+         * @param size
+         */
+        void resize(size_t size) {
+            if (size < _size) {
+                _words.resize((size + 63) / 64);
+                _size = size;
+                clear_padding();
+            } else {
+                _words.resize((size + 63) / 64, 0);
+                _size = size;
+            }
+        }
+
+        size_t size() const { return _size; }
+
+        bool test(size_t index) const {
+            return (_words[index / 64] >> (index % 64)) & 1;
+        }
+
+        void set(size_t index, bool value = true) {
+            std::uint64_t bit = std::uint64_t(1) << (index % 64);
+            if (value) {
+                _words[index / 64] |= bit;
+            } else {
+                _words[index / 64] &= ~bit;
+            }
+        }
+
+        /**
+         * Count the selected rows.
+         *
+         * @return
+         */
+        size_t count() const {
+            size_t n = 0;
+            for (std::uint64_t word : _words) {
+                n += mpp_impl::popcount64(word);
+            }
+            return n;
+        }
+
+        std::uint64_t *words() { return _words.data(); }
+
+        const std::uint64_t *words() const { return _words.data(); }
+
+        size_t word_count() const { return _words.size(); }
+
+        /**
+         * Call fn with the index of every selected row, in order.
+         *
+         * @param fn
+         */
+        template <typename Fn>
+        void for_each(Fn &&fn) const {
+            for (size_t w = 0; w < _words.size(); ++w) {
+                for (std::uint64_t word = _words[w]; word != 0; word &= word - 1) {
+                    auto low = static_cast<std::uint32_t>(word);
+                    unsigned bit = low != 0 ? mpp_impl::ctz32(low)
+                                            : 32 + mpp_impl::ctz32(static_cast<std::uint32_t>(word >> 32));
+                    fn(w * 64 + bit);
+                }
+            }
+        }
+
+        /**
+         * Select the rows not selected and the other way around.
+         */
+        void flip() {
+            for (std::uint64_t &word : _words) {
+                word = ~word;
+            }
+            clear_padding();
+        }
+
+        selection_bitmap &operator&=(const selection_bitmap &rhs) {
+            for (size_t w = 0; w < _words.size(); ++w) {
+                _words[w] &= w < rhs._words.size() ? rhs._words[w] : 0;
+            }
+            return *this;
+        }
+
+        selection_bitmap &operator|=(const selection_bitmap &rhs) {
+            for (size_t w = 0; w < _words.size() && w < rhs._words.size(); ++w) {
+                _words[w] |= rhs._words[w];
+            }
+            clear_padding();
+            return *this;
+        }
+    };
+
+    /**
+     * A read-only view of an array of string_refs.
+     */
+    struct string_ref_span {
+        const string_ref *data = nullptr;
+        size_t size = 0;
+
+        string_ref_span() = default;
+
+        string_ref_span(const string_ref *strings, size_t count) : data(strings), size(count) {}
+
+        /*implicit*/ string_ref_span(const std::vector<string_ref> &strings)
+                : data(strings.data()), size(strings.size()) {}
+    };
+}
+
+namespace mpp_impl {
+    /**
+     * How many rows ahead the batch loops prefetch the string data.
+     */
+    static constexpr size_t batch_prefetch_distance = 16;
+
+    /**
+     * Evaluate match on every string, filling a bitmap word per 64 rows
+     * without branching on the outcome, while prefetching the bytes of
+     * the strings a few rows ahead: the handles are read in order but
+     * the strings may live anywhere.
+     *
+     * @return the number of rows selected
+     */
+    template <typename Matcher>
+    size_t batch_select(mpp::string_ref_span strings, mpp::selection_bitmap &out, const Matcher &match) {
+        out.resize(strings.size);
+        std::uint64_t *bits = out.words();
+        size_t selected = 0;
+        for (size_t base = 0; base < strings.size; base += 64) {
+            size_t rows = std::min<size_t>(64, strings.size - base);
+            const mpp::string_ref *row = strings.data + base;
+            std::uint64_t word = 0;
+            for (size_t j = 0; j < rows; ++j) {
+                if (base + j + batch_prefetch_distance < strings.size) {
+                    prefetch(row[j + batch_prefetch_distance].data());
+                }
+                word |= std::uint64_t(match(row[j])) << j;
+            }
+            bits[base / 64] = word;
+            selected += popcount64(word);
+        }
+        return selected;
+    }
+
+    /**
+     * startswith() against one prefix: its first 8 bytes are loaded and
+     * masked once, and most strings are rejected by one word compare.
+     */
+    class prefix_matcher {
+    private:
+        mpp::string_ref _prefix;
+        std::uint64_t _head;
+        std::uint64_t _mask;
+
+    public:
+        explicit prefix_matcher(mpp::string_ref prefix)
+                : _prefix(prefix),
+                  _head(prefix.empty() ? 0 : load_word(prefix.data(), std::min<size_t>(prefix.size(), 8))),
+                  _mask(prefix.size() >= 8 ? ~std::uint64_t(0) : (std::uint64_t(1) << (8 * prefix.size())) - 1) {}
+
+        bool operator()(mpp::string_ref str) const {
+            size_t length = _prefix.size();
+            if (str.size() < length) {
+                return false;
+            }
+            if (str.size() < 8) {
+                return length == 0 || std::memcmp(str.data(), _prefix.data(), length) == 0;
+            }
+            if ((load_word(str.data(), 8) & _mask) != _head) {
+                return false;
+            }
+            return length <= 8 || std::memcmp(str.data() + 8, _prefix.data() + 8, length - 8) == 0;
+        }
+    };
+
+    /**
+     * equals() or equals_ignore_case() against one string: lengths are
+     * compared first, then the first and last 8 bytes as words (folded
+     * when ignoring case), precomputed for the needle.
+     */
+    template <bool Fold>
+    class equal_matcher {
+    private:
+        mpp::string_ref _needle;
+        std::uint64_t _head = 0;
+        std::uint64_t _tail = 0;
+
+        static std::uint64_t fold(std::uint64_t w) {
+            return Fold ? fold_word(w) : w;
+        }
+
+    public:
+        explicit equal_matcher(mpp::string_ref needle) : _needle(needle) {
+            size_t length = needle.size();
+            if (length >= 8) {
+                _head = fold(load_word(needle.data(), 8));
+                _tail = fold(load_word(needle.data() + length - 8, 8));
+            } else if (length != 0) {
+                // all of the bytes for the short ones
+                _head = fold(load_tail(needle.data(), length));
+            }
+        }
+
+        bool operator()(mpp::string_ref str) const {
+            size_t length = _needle.size();
+            if (str.size() != length) {
+                return false;
+            }
+            if (length < 8) {
+                return length == 0 || fold(load_tail(str.data(), length)) == _head;
+            }
+            if (fold(load_word(str.data(), 8)) != _head || fold(load_word(str.data() + length - 8, 8)) != _tail) {
+                return false;
+            }
+            for (size_t i = 8; i + 8 < length; i += 8) {
+                if (fold(load_word(str.data() + i, 8)) != fold(load_word(_needle.data() + i, 8))) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+
+    class contains_matcher {
+    private:
+        mpp::string_ref _needle;
+
+    public:
+        explicit contains_matcher(mpp::string_ref needle) : _needle(needle) {}
+
+        bool operator()(mpp::string_ref str) const {
+            return str.size() >= _needle.size() && str.find(_needle) != mpp::string_ref::npos;
+        }
+    };
+}
+
+namespace mpp {
+    /**
+     * Predicates and hashing over arrays of strings, for filters that
+     * apply one operation to many short strings: the setup (loading and
+     * folding the needle) is done once per batch, the strings are
+     * prefetched ahead of use, and the results are packed into a bitmap.
+     */
+    namespace batch {
+        /**
+         * Select the strings starting with prefix.
+         *
+         * @param strings
+         * @param prefix
+         * @param out resized to the number of strings, bit i set if strings[i] matches
+         * @return the number of strings selected
+         */
+        inline size_t starts_with(string_ref_span strings, string_ref prefix, selection_bitmap &out) {
+            return mpp_impl::batch_select(strings, out, mpp_impl::prefix_matcher(prefix));
+        }
+
+        /**
+         * Select the strings equal to needle.
+         */
+        inline size_t equals(string_ref_span strings, string_ref needle, selection_bitmap &out) {
+            return mpp_impl::batch_select(strings, out, mpp_impl::equal_matcher<false>(needle));
+        }
+
+        /**
+         * Select the strings equal to needle, ignoring the case of ASCII letters.
+         */
+        inline size_t equals_ignore_case(string_ref_span strings, string_ref needle, selection_bitmap &out) {
+            return mpp_impl::batch_select(strings, out, mpp_impl::equal_matcher<true>(needle));
+        }
+
+        /**
+         * Select the strings containing needle.
+         */
+        inline size_t contains(string_ref_span strings, string_ref needle, selection_bitmap &out) {
+            return mpp_impl::batch_select(strings, out, mpp_impl::contains_matcher(needle));
+        }
+
+        /**
+         * Hash every string like string_ref::hash() would.
+         *
+         * @param strings
+         * @param out room for strings.size hashes
+         * @param seed
+         */
+        inline void hash(string_ref_span strings, std::uint64_t *out, std::uint64_t seed = 0) {
+            for (size_t i = 0; i < strings.size; ++i) {
+                if (i + mpp_impl::batch_prefetch_distance < strings.size) {
+                    mpp_impl::prefetch(strings.data[i + mpp_impl::batch_prefetch_distance].data());
+                }
+                out[i] = mpp_impl::hash_bytes(strings.data[i].data(), strings.data[i].size(), seed);
+            }
+        }
+
+        inline std::vector<std::uint64_t> hash(string_ref_span strings, std::uint64_t seed = 0) {
+            std::vector<std::uint64_t> result(strings.size);
+            hash(strings, result.data(), seed);
+            return result;
+        }
+    }
+}
@@ -9,11 +9,120 @@
 #pragma once
 
 #include <mozart++/core>
+#include <mozart++/string>
+#include <mozart++/unicode>
 #include <codecvt>
-#include <cwctype>
 #include <locale>
+#include <memory>
 #include <string>
 
+namespace mpp {
+    namespace codecvt {
+        /**
+         * What a conversion does when it meets malformed input
+         * or a character the target charset cannot represent.
+         */
+        enum class error_policy {
+            // stop and report the error
+            strict,
+            // emit a replacement character and go on
+            replace,
+            // drop the offending input and go on
+            skip,
+        };
+
+        enum class convert_error {
+            none,
+            // the input is not a valid sequence in the source charset
+            ill_formed,
+            // the character has no encoding in the target charset
+            unrepresentable,
+        };
+
+        /**
+         * The outcome of a conversion, returned instead of throwing.
+         *
+         * error and error_offset describe the first offending input under
+         * every policy. The offset counts bytes when decoding and code units
+         * when encoding. With error_policy::strict, value holds everything
+         * converted before the error; with the other policies it is complete.
+         */
+        template <typename StrT>
+        struct convert_result {
+            StrT value;
+            convert_error error = convert_error::none;
+            size_t error_offset = string_ref::npos;
+
+            bool ok() const { return error == convert_error::none; }
+
+            explicit operator bool() const { return ok(); }
+        };
+
+    }
+}
+
+namespace mpp_impl {
+    /**
+     * An empty result whose string allocates with alloc.
+     */
+    template <typename StrT, typename Alloc>
+    mpp::codecvt::convert_result<StrT> make_convert_result(const Alloc &alloc) {
+        return mpp::codecvt::convert_result<StrT>{StrT(typename StrT::allocator_type(alloc))};
+    }
+
+    /**
+     * Record a conversion error and apply the policy.
+     *
+     * @return whether the conversion should go on; with error_policy::strict
+     * this is a constant false, so the strict loops carry no extra branches.
+     */
+    template <mpp::codecvt::error_policy P, typename StrT, typename Rep>
+    inline bool convert_error_at(mpp::codecvt::convert_result<StrT> &result, mpp::codecvt::convert_error error,
+                                 size_t offset, const Rep &replacement) {
+        if (P == mpp::codecvt::error_policy::strict) {
+            result.error = error;
+            result.error_offset = offset;
+            return false;
+        }
+        if (result.ok()) {
+            result.error = error;
+            result.error_offset = offset;
+        }
+        if (P == mpp::codecvt::error_policy::replace) {
+            result.value += replacement;
+        }
+        return true;
+    }
+
+    template <typename Charset>
+    inline mpp::codecvt::convert_result<std::u32string>
+    dispatch_decode(mpp::string_ref local, mpp::codecvt::error_policy policy) {
+        MOZART_STRING_PROBE(decode, local.size());
+        mpp::codecvt::convert_result<std::u32string> result =
+                policy == mpp::codecvt::error_policy::replace
+                ? Charset::template decode<mpp::codecvt::error_policy::replace>(local)
+                : policy == mpp::codecvt::error_policy::skip
+                  ? Charset::template decode<mpp::codecvt::error_policy::skip>(local)
+                  : Charset::template decode<mpp::codecvt::error_policy::strict>(local);
+        MOZART_STRING_COUNT_ALLOCATIONS(decode, mpp_impl::heap_allocated(result.value));
+        return result;
+    }
+
+    template <typename Charset>
+    inline mpp::codecvt::convert_result<std::string>
+    dispatch_encode(const std::u32string &wide, mpp::codecvt::error_policy policy) {
+        MOZART_STRING_PROBE(encode, wide.size() * sizeof(char32_t));
+        mpp::codecvt::convert_result<std::string> result =
+                policy == mpp::codecvt::error_policy::replace
+                ? Charset::template encode<mpp::codecvt::error_policy::replace>(wide)
+                : policy == mpp::codecvt::error_policy::skip
+                  ? Charset::template encode<mpp::codecvt::error_policy::skip>(wide)
+                  : Charset::template encode<mpp::codecvt::error_policy::strict>(wide);
+        MOZART_STRING_COUNT_ALLOCATIONS(encode, mpp_impl::heap_allocated(result.value));
+        return result;
+    }
+}
+
 namespace mpp {
     namespace codecvt {
         class charset {
@@ -24,48 +133,265 @@ namespace mpp {
 
             virtual std::string wide2local(const std::u32string &) = 0;
 
+            /**
+             * Decode without throwing, the policy is chosen at runtime.
+             * Use the static decode<P>() of a concrete charset when the policy
+             * is known at compile time.
+             */
+            virtual convert_result<std::u32string> try_local2wide(string_ref, error_policy) = 0;
+
+            /**
+             * Encode without throwing, the policy is chosen at runtime.
+             * Use the static encode<P>() of a concrete charset when the policy
+             * is known at compile time.
+             */
+            virtual convert_result<std::string> try_wide2local(const std::u32string &, error_policy) = 0;
+
             virtual bool is_identifier(char32_t) = 0;
+
+            /**
+             * Check whether the character can start an identifier
+             * (XID_Start for Unicode charsets).
+             */
+            virtual bool is_xid_start(char32_t) = 0;
+
+            /**
+             * Check whether the character can continue an identifier
+             * (XID_Continue for Unicode charsets).
+             */
+            virtual bool is_xid_continue(char32_t) = 0;
+
+            /**
+             * Measure the identifier at the beginning of an encoded string
+             * without converting it to wide characters.
+             *
+             * @return length of the identifier in bytes, 0 if there is none
+             */
+            virtual size_t scan_identifier(string_ref) = 0;
         };
 
         class ascii final : public charset {
+            static constexpr std::uint32_t ascii_max = 0x7F;
+
         public:
             std::u32string local2wide(const std::string &local) override {
-                return std::u32string(local.begin(), local.end());
+                MOZART_STRING_PROBE(decode, local.size());
+                std::u32string wide(local.begin(), local.end());
+                MOZART_STRING_COUNT_ALLOCATIONS(decode, mpp_impl::heap_allocated(wide));
+                return wide;
             }
 
             std::string wide2local(const std::u32string &str) override {
-                return std::string(str.begin(), str.end());
+                MOZART_STRING_PROBE(encode, str.size() * sizeof(char32_t));
+                std::string local(str.begin(), str.end());
+                MOZART_STRING_COUNT_ALLOCATIONS(encode, mpp_impl::heap_allocated(local));
+                return local;
+            }
+
+            /**
+             * Decode 7-bit ASCII, bytes above 0x7F are ill-formed.
+             */
+            template <error_policy P = error_policy::strict>
+            static convert_result<std::u32string> decode(string_ref local) {
+                return decode<P>(local, std::allocator<char32_t>());
+            }
+
+            /**
+             * Like decode(), with the result allocated by alloc.
+             */
+            template <error_policy P = error_policy::strict, typename Alloc>
+            static convert_result<alloc_string<Alloc, char32_t>> decode(string_ref local, const Alloc &alloc) {
+                auto result = mpp_impl::make_convert_result<alloc_string<Alloc, char32_t>>(alloc);
+                result.value.reserve(local.size());
+                for (const unsigned char *p = local.bytes_begin(), *e = local.bytes_end(); p < e; ++p) {
+                    if (*p > ascii_max) {
+                        if (!mpp_impl::convert_error_at<P>(result, convert_error::ill_formed,
+                                                           p - local.bytes_begin(), mpp_impl::unicode_replacement)) {
+                            return result;
+                        }
+                        continue;
+                    }
+                    result.value.push_back(*p);
+                }
+                return result;
+            }
+
+            /**
+             * Encode to 7-bit ASCII, the replacement character is '?'.
+             */
+            template <error_policy P = error_policy::strict>
+            static convert_result<std::string> encode(const std::u32string &wide) {
+                return encode<P>(wide, std::allocator<char>());
+            }
+
+            /**
+             * Like encode(), with the result allocated by alloc.
+             */
+            template <error_policy P = error_policy::strict, typename WideAlloc, typename Alloc>
+            static convert_result<alloc_string<Alloc>>
+            encode(const std::basic_string<char32_t, std::char_traits<char32_t>, WideAlloc> &wide, const Alloc &alloc) {
+                auto result = mpp_impl::make_convert_result<alloc_string<Alloc>>(alloc);
+                result.value.reserve(wide.size());
+                for (size_t i = 0; i < wide.size(); ++i) {
+                    if (wide[i] > ascii_max) {
+                        if (!mpp_impl::convert_error_at<P>(result, convert_error::unrepresentable, i, '?')) {
+                            return result;
+                        }
+                        continue;
+                    }
+                    result.value.push_back(static_cast<char>(wide[i]));
+                }
+                return result;
+            }
+
+            convert_result<std::u32string> try_local2wide(string_ref local, error_policy policy) override {
+                return mpp_impl::dispatch_decode<ascii>(local, policy);
+            }
+
+            convert_result<std::string> try_wide2local(const std::u32string &wide, error_policy policy) override {
+                return mpp_impl::dispatch_encode<ascii>(wide, policy);
             }
 
             bool is_identifier(char32_t ch) override {
-                return ch == '_' || std::iswalnum(ch);
+                return is_xid_continue(ch);
+            }
+
+            bool is_xid_start(char32_t ch) override {
+                return ch <= ascii_max && unicode::is_xid_start(ch);
+            }
+
+            bool is_xid_continue(char32_t ch) override {
+                return ch <= ascii_max && unicode::is_xid_continue(ch);
+            }
+
+            size_t scan_identifier(string_ref str) override {
+                size_t length = 0;
+                for (unsigned char ch : str.bytes()) {
+                    if (!(length == 0 ? is_xid_start(ch) || ch == '_' : is_xid_continue(ch))) {
+                        break;
+                    }
+                    ++length;
+                }
+                return length;
             }
         };
 
         class utf8 final : public charset {
             std::wstring_convert<std::codecvt_utf8<char32_t>, char32_t> cvt;
 
-            static constexpr std::uint32_t ascii_max = 0x7F;
         public:
             std::u32string local2wide(const std::string &str) override {
-                return cvt.from_bytes(str);
+                MOZART_STRING_PROBE(decode, str.size());
+                std::u32string wide = cvt.from_bytes(str);
+                MOZART_STRING_COUNT_ALLOCATIONS(decode, mpp_impl::heap_allocated(wide));
+                return wide;
             }
 
             std::string wide2local(const std::u32string &str) override {
-                return cvt.to_bytes(str);
+                MOZART_STRING_PROBE(encode, str.size() * sizeof(char32_t));
+                std::string local = cvt.to_bytes(str);
+                MOZART_STRING_COUNT_ALLOCATIONS(encode, mpp_impl::heap_allocated(local));
+                return local;
+            }
+
+            /**
+             * Decode UTF-8, each maximal subpart of an ill-formed sequence
+             * counts as one error and is replaced by one U+FFFD.
+             */
+            template <error_policy P = error_policy::strict>
+            static convert_result<std::u32string> decode(string_ref local) {
+                return decode<P>(local, std::allocator<char32_t>());
+            }
+
+            /**
+             * Like decode(), with the result allocated by alloc.
+             */
+            template <error_policy P = error_policy::strict, typename Alloc>
+            static convert_result<alloc_string<Alloc, char32_t>> decode(string_ref local, const Alloc &alloc) {
+                auto result = mpp_impl::make_convert_result<alloc_string<Alloc, char32_t>>(alloc);
+                result.value.reserve(unicode::count_code_points(local));
+
+                const unsigned char *begin = local.bytes_begin();
+                const unsigned char *end = local.bytes_end();
+                for (const unsigned char *p = begin; p < end;) {
+                    char32_t ch = 0;
+                    size_t n = mpp_impl::utf8_decode(p, end, ch);
+                    if (n == 0) {
+                        if (!mpp_impl::convert_error_at<P>(result, convert_error::ill_formed,
+                                                           p - begin, mpp_impl::unicode_replacement)) {
+                            return result;
+                        }
+                        p += mpp_impl::utf8_invalid_length(p, end);
+                        continue;
+                    }
+                    result.value.push_back(ch);
+                    p += n;
+                }
+                return result;
+            }
+
+            /**
+             * Encode to UTF-8, surrogates and values beyond U+10FFFF
+             * are unrepresentable.
+             */
+            template <error_policy P = error_policy::strict>
+            static convert_result<std::string> encode(const std::u32string &wide) {
+                return encode<P>(wide, std::allocator<char>());
+            }
+
+            /**
+             * Like encode(), with the result allocated by alloc.
+             */
+            template <error_policy P = error_policy::strict, typename WideAlloc, typename Alloc>
+            static convert_result<alloc_string<Alloc>>
+            encode(const std::basic_string<char32_t, std::char_traits<char32_t>, WideAlloc> &wide, const Alloc &alloc) {
+                auto result = mpp_impl::make_convert_result<alloc_string<Alloc>>(alloc);
+                result.value.resize(unicode::utf8_length_from_utf32(wide.data(), wide.size()));
+
+                size_t length = 0;
+                for (size_t i = 0; i < wide.size(); ++i) {
+                    char32_t ch = wide[i];
+                    if (ch > mpp_impl::unicode_max || (ch >= 0xD800 && ch <= 0xDFFF)) {
+                        result.value.resize(length);
+                        if (!mpp_impl::convert_error_at<P>(result, convert_error::unrepresentable,
+                                                           i, "\xEF\xBF\xBD")) {
+                            return result;
+                        }
+                        // the replacement may need more room than the estimate
+                        length = result.value.size();
+                        result.value.resize(length + unicode::utf8_length_from_utf32(wide.data() + i + 1,
+                                                                                      wide.size() - i - 1));
+                        continue;
+                    }
+                    length += mpp_impl::utf8_encode(ch, &result.value[length]);
+                }
+                result.value.resize(length);
+                return result;
+            }
+
+            convert_result<std::u32string> try_local2wide(string_ref local, error_policy policy) override {
+                return mpp_impl::dispatch_decode<utf8>(local, policy);
+            }
+
+            convert_result<std::string> try_wide2local(const std::u32string &wide, error_policy policy) override {
+                return mpp_impl::dispatch_encode<utf8>(wide, policy);
             }
 
             bool is_identifier(char32_t ch) override {
-                /**
-                 * Chinese Character in Unicode Charset
-                 * Basic:    0x4E00 - 0x9FA5
-                 * Extended: 0x9FA6 - 0x9FEF
-                 * Special:  0x3007
-                 */
-                if (ch > ascii_max)
-                    return (ch >= 0x4E00 && ch <= 0x9FA5) || (ch >= 0x9FA6 && ch <= 0x9FEF) || ch == 0x3007;
-                else
-                    return ch == '_' || std::iswalnum(ch);
+                // XID_Continue covers the Chinese characters and '_'
+                return unicode::is_xid_continue(ch);
+            }
+
+            bool is_xid_start(char32_t ch) override {
+                return unicode::is_xid_start(ch);
+            }
+
+            bool is_xid_continue(char32_t ch) override {
+                return unicode::is_xid_continue(ch);
+            }
+
+            size_t scan_identifier(string_ref str) override {
+                return unicode::scan_identifier(str);
             }
         };
 
@@ -74,11 +400,32 @@ namespace mpp {
                 return ch & 0x0000ffff;
             }
 
+            /**
+             * Chinese Character in GBK Charset
+             * GBK/2: 0xB0A1 - 0xF7FE
+             * GBK/3: 0x8140 - 0xA0FE
+             * GBK/4: 0xAA40 - 0xFEA0
+             * GBK/5: 0xA996
+             */
+            static bool is_chinese(char32_t ch) {
+                return (ch >= 0xB0A1 && ch <= 0xF7FE) || (ch >= 0x8140 && ch <= 0xA0FE) ||
+                       (ch >= 0xAA40 && ch <= 0xFEA0) || ch == 0xA996;
+            }
+
             static constexpr std::uint8_t u8_blck_begin = 0x80;
             static constexpr std::uint32_t u32_blck_begin = 0x8000;
 
+            static bool is_lead(std::uint32_t b) {
+                return b >= 0x81 && b <= 0xFE;
+            }
+
+            static bool is_trail(std::uint32_t b) {
+                return b >= 0x40 && b <= 0xFE && b != 0x7F;
+            }
+
         public:
             std::u32string local2wide(const std::string &local) override {
+                MOZART_STRING_PROBE(decode, local.size());
                 std::u32string wide;
                 std::uint32_t head = 0;
                 bool read_next = true;
@@ -97,33 +444,334 @@ namespace mpp {
                 }
                 if (!read_next)
                     throw_ex<mpp::runtime_error>("Codecvt: Bad encoding.");
+                MOZART_STRING_COUNT_ALLOCATIONS(decode, mpp_impl::heap_allocated(wide));
                 return std::move(wide);
             }
 
             std::string wide2local(const std::u32string &wide) override {
+                MOZART_STRING_PROBE(encode, wide.size() * sizeof(char32_t));
                 std::string local;
                 for (auto &ch:wide) {
                     if (ch & u32_blck_begin)
                         local.push_back(ch >> 8);
                     local.push_back(ch);
                 }
+                MOZART_STRING_COUNT_ALLOCATIONS(encode, mpp_impl::heap_allocated(local));
                 return std::move(local);
             }
 
+            /**
+             * Decode GBK into the same wide form as local2wide(), that is
+             * ASCII bytes as they are and double-byte characters as
+             * (lead << 8 | trail). Bad lead or trail bytes are ill-formed,
+             * and are replaced by U+FFFD.
+             */
+            template <error_policy P = error_policy::strict>
+            static convert_result<std::u32string> decode(string_ref local) {
+                return decode<P>(local, std::allocator<char32_t>());
+            }
+
+            /**
+             * Like decode(), with the result allocated by alloc.
+             */
+            template <error_policy P = error_policy::strict, typename Alloc>
+            static convert_result<alloc_string<Alloc, char32_t>> decode(string_ref local, const Alloc &alloc) {
+                auto result = mpp_impl::make_convert_result<alloc_string<Alloc, char32_t>>(alloc);
+                result.value.reserve(local.size());
+
+                const unsigned char *begin = local.bytes_begin();
+                const unsigned char *end = local.bytes_end();
+                for (const unsigned char *p = begin; p < end;) {
+                    std::uint32_t head = *p;
+                    if (head < u8_blck_begin) {
+                        result.value.push_back(head);
+                        ++p;
+                        continue;
+                    }
+                    if (is_lead(head) && end - p >= 2 && is_trail(p[1])) {
+                        result.value.push_back(head << 8 | p[1]);
+                        p += 2;
+                        continue;
+                    }
+                    if (!mpp_impl::convert_error_at<P>(result, convert_error::ill_formed,
+                                                       p - begin, mpp_impl::unicode_replacement)) {
+                        return result;
+                    }
+                    // resynchronize on the next byte, a bad trail may well be ASCII
+                    ++p;
+                }
+                return result;
+            }
+
+            /**
+             * Encode the wide form produced by decode(),
+             * the replacement character is '?'.
+             */
+            template <error_policy P = error_policy::strict>
+            static convert_result<std::string> encode(const std::u32string &wide) {
+                return encode<P>(wide, std::allocator<char>());
+            }
+
+            /**
+             * Like encode(), with the result allocated by alloc.
+             */
+            template <error_policy P = error_policy::strict, typename WideAlloc, typename Alloc>
+            static convert_result<alloc_string<Alloc>>
+            encode(const std::basic_string<char32_t, std::char_traits<char32_t>, WideAlloc> &wide, const Alloc &alloc) {
+                auto result = mpp_impl::make_convert_result<alloc_string<Alloc>>(alloc);
+                result.value.reserve(wide.size() * 2);
+                for (size_t i = 0; i < wide.size(); ++i) {
+                    char32_t ch = wide[i];
+                    if (ch < u8_blck_begin) {
+                        result.value.push_back(static_cast<char>(ch));
+                        continue;
+                    }
+                    if (ch <= 0xFFFF && is_lead(ch >> 8) && is_trail(ch & 0xFF)) {
+                        result.value.push_back(static_cast<char>(ch >> 8));
+                        result.value.push_back(static_cast<char>(ch & 0xFF));
+                        continue;
+                    }
+                    if (!mpp_impl::convert_error_at<P>(result, convert_error::unrepresentable, i, '?')) {
+                        return result;
+                    }
+                }
+                return result;
+            }
+
+            convert_result<std::u32string> try_local2wide(string_ref local, error_policy policy) override {
+                return mpp_impl::dispatch_decode<gbk>(local, policy);
+            }
+
+            convert_result<std::string> try_wide2local(const std::u32string &wide, error_policy policy) override {
+                return mpp_impl::dispatch_encode<gbk>(wide, policy);
+            }
+
             bool is_identifier(char32_t ch) override {
-                /**
-                 * Chinese Character in GBK Charset
-                 * GBK/2: 0xB0A1 - 0xF7FE
-                 * GBK/3: 0x8140 - 0xA0FE
-                 * GBK/4: 0xAA40 - 0xFEA0
-                 * GBK/5: 0xA996
-                 */
                 if (ch & u32_blck_begin)
-                    return (ch >= 0xB0A1 && ch <= 0xF7FE) || (ch >= 0x8140 && ch <= 0xA0FE) ||
-                           (ch >= 0xAA40 && ch <= 0xFEA0) || ch == 0xA996;
+                    return is_chinese(ch);
                 else
-                    return ch == '_' || std::iswalnum(ch);
+                    return ch < u8_blck_begin && unicode::is_xid_continue(ch);
+            }
+
+            bool is_xid_start(char32_t ch) override {
+                if (ch & u32_blck_begin)
+                    return is_chinese(ch);
+                else
+                    return ch < u8_blck_begin && unicode::is_xid_start(ch);
+            }
+
+            bool is_xid_continue(char32_t ch) override {
+                return is_identifier(ch);
+            }
+
+            size_t scan_identifier(string_ref str) override {
+                const unsigned char *begin = str.bytes_begin();
+                const unsigned char *end = str.bytes_end();
+                const unsigned char *p = begin;
+                while (p < end) {
+                    char32_t ch = *p;
+                    size_t n = 1;
+                    if (ch & u8_blck_begin) {
+                        // a bad trail, e.g. ASCII, is not part of the character
+                        if (end - p < 2 || !is_trail(p[1])) {
+                            break;
+                        }
+                        ch = set_zero(ch << 8 | p[1]);
+                        n = 2;
+                    }
+                    if (!(p == begin ? is_xid_start(ch) || ch == '_' : is_xid_continue(ch))) {
+                        break;
+                    }
+                    p += n;
+                }
+                return p - begin;
             }
         };
+
+        enum class charset_kind {
+            ascii,
+            utf8,
+            gbk,
+        };
+
+        /**
+         * The guess made by detect_charset().
+         * confidence is in [0, 1], bom_length is the number of bytes of a
+         * byte order mark to strip before decoding.
+         */
+        struct detect_result {
+            charset_kind kind = charset_kind::ascii;
+            double confidence = 0;
+            size_t bom_length = 0;
+        };
+    }
+}
+
+namespace mpp_impl {
+    struct gbk_stats {
+        // well-formed double-byte characters
+        size_t pairs = 0;
+        // pairs in the GB2312 Chinese character area (B0-F7, A1-FE)
+        size_t common = 0;
+        // bytes that cannot be part of a GBK character
+        size_t bad = 0;
+    };
+
+    inline gbk_stats gbk_scan(const unsigned char *p, const unsigned char *e) {
+        gbk_stats stats;
+        while (p < e) {
+            if (static_cast<size_t>(e - p) >= simd_block) {
+                std::uint32_t high = simd_mask_high(p);
+                if (high == 0) {
+                    p += simd_block;
+                    continue;
+                }
+                p += ctz32(high);
+            }
+            std::uint32_t lead = *p;
+            if (lead < 0x80) {
+                ++p;
+                continue;
+            }
+            if (e - p < 2) {
+                // possibly cut off by the prefix limit, not evidence either way
+                break;
+            }
+            std::uint32_t trail = p[1];
+            if (lead >= 0x81 && lead <= 0xFE && trail >= 0x40 && trail <= 0xFE && trail != 0x7F) {
+                ++stats.pairs;
+                stats.common += lead >= 0xB0 && lead <= 0xF7 && trail >= 0xA1;
+                p += 2;
+            } else {
+                ++stats.bad;
+                ++p;
+            }
+        }
+        return stats;
+    }
+
+    /**
+     * Count multibyte sequences and ill-formed subparts in UTF-8 text.
+     */
+    inline void utf8_scan(const unsigned char *p, const unsigned char *e, bool truncated,
+                          size_t &sequences, size_t &bad) {
+        sequences = 0;
+        bad = 0;
+        while (p < e) {
+            const unsigned char *q = utf8_valid_prefix(p, e);
+            // in well-formed text every byte >= 0xC0 leads a multibyte sequence
+            sequences += simd_count_range(p, q, 0xC0, 0xFF);
+            if (q == e) {
+                break;
+            }
+            size_t n = utf8_invalid_length(q, e);
+            if (truncated && q + n == e && utf8_sequence_length[*q] > n) {
+                // the last sequence was cut off by the prefix limit
+                break;
+            }
+            ++bad;
+            p = q + n;
+        }
+    }
+}
+
+namespace mpp {
+    namespace codecvt {
+        /**
+         * Guess the charset of a byte stream without a declared encoding.
+         *
+         * At most max_prefix bytes are inspected. A UTF-8 byte order mark
+         * decides immediately; pure 7-bit text is ASCII; text that is valid
+         * UTF-8 is UTF-8, with more confidence the more multibyte sequences
+         * it has. Otherwise GBK and UTF-8 are scored by how much of the
+         * non-ASCII input forms well-formed characters, and GBK gains weight
+         * for characters in the common GB2312 area.
+         *
+         * @param data bytes to inspect
+         * @param max_prefix upper bound on the bytes read
+         * @return the most likely charset
+         */
+        inline detect_result detect_charset(string_ref data, size_t max_prefix = 4096) {
+            detect_result result;
+            if (data.startswith("\xEF\xBB\xBF")) {
+                result.kind = charset_kind::utf8;
+                result.confidence = 1;
+                result.bom_length = 3;
+                return result;
+            }
+
+            bool truncated = data.size() > max_prefix;
+            string_ref prefix = data.substr(0, max_prefix);
+            const unsigned char *begin = prefix.bytes_begin();
+            const unsigned char *end = prefix.bytes_end();
+
+            const unsigned char *first_high = begin;
+            while (static_cast<size_t>(end - first_high) >= mpp_impl::simd_block
+                   && mpp_impl::simd_mask_high(first_high) == 0) {
+                first_high += mpp_impl::simd_block;
+            }
+            while (first_high < end && *first_high < 0x80) {
+                ++first_high;
+            }
+            if (first_high == end) {
+                result.kind = charset_kind::ascii;
+                result.confidence = 1;
+                return result;
+            }
+
+            size_t sequences = 0;
+            size_t utf8_bad = 0;
+            mpp_impl::utf8_scan(first_high, end, truncated, sequences, utf8_bad);
+            if (utf8_bad == 0) {
+                // Each multibyte sequence that validates makes a legacy
+                // encoding less likely, GBK text almost never does.
+                result.kind = charset_kind::utf8;
+                result.confidence = 1.0 - 0.5 / static_cast<double>(1 + sequences);
+                return result;
+            }
+
+            mpp_impl::gbk_stats gbk = mpp_impl::gbk_scan(first_high, end);
+            double utf8_score = static_cast<double>(sequences) / static_cast<double>(sequences + utf8_bad);
+            double gbk_score = gbk.pairs == 0 ? 0.0 :
+                               static_cast<double>(gbk.pairs) / static_cast<double>(gbk.pairs + gbk.bad)
+                               * (0.6 + 0.4 * static_cast<double>(gbk.common) / static_cast<double>(gbk.pairs));
+
+            if (gbk_score >= utf8_score) {
+                result.kind = charset_kind::gbk;
+                result.confidence = gbk_score;
+            } else {
+                result.kind = charset_kind::utf8;
+                result.confidence = utf8_score * 0.5;
+            }
+            return result;
+        }
+
+        /**
+         * Create the charset for a kind returned by detect_charset().
+         *
+         * @param kind
+         * @return a new charset
+         */
+        inline std::unique_ptr<charset> make_charset(charset_kind kind) {
+            switch (kind) {
+                case charset_kind::utf8:
+                    return std::unique_ptr<charset>(new utf8);
+                case charset_kind::gbk:
+                    return std::unique_ptr<charset>(new gbk);
+                default:
+                    return std::unique_ptr<charset>(new ascii);
+            }
+        }
+
+        /**
+         * Detect the charset of data and create it.
+         *
+         * @param data bytes to inspect
+         * @param max_prefix upper bound on the bytes read
+         * @return a new charset
+         */
+        inline std::unique_ptr<charset> make_charset(string_ref data, size_t max_prefix = 4096) {
+            return make_charset(detect_charset(data, max_prefix).kind);
+        }
     }
 }
@@ -12,15 +12,16 @@
 #include <mozart++/any>
 #include <mozart++/string>
 #include <mozart++/iterator_range>
+#include <climits>
+#include <cstring>
 #include <iomanip>
-#include <regex>
+#include <memory>
+#include <ostream>
 #include <sstream>
+#include <streambuf>
 #include <string>
 
 namespace mpp_impl {
-    using string_iter_t = mpp::string_ref::const_iterator;
-    using match_t = std::match_results<string_iter_t>;
-
     template <typename Out, typename T>
     void write_value(Out &out, T &&t);
 
@@ -50,6 +51,30 @@ namespace mpp_impl {
         }
     };
 
+    /**
+     * Write text straight into streams, without copying it to a string.
+     */
+    template <typename Out>
+    std::enable_if_t<std::is_base_of<std::ostream, Out>::value> write_text(Out &out, mpp::string_ref text) {
+        // pad to the field width like operator<< on a string does
+        auto size = static_cast<std::streamsize>(text.size());
+        std::streamsize padding = out.width() > size ? out.width() - size : 0;
+        bool left = (out.flags() & std::ios::adjustfield) == std::ios::left;
+        out.width(0);
+        for (; !left && padding > 0; --padding) {
+            out.put(out.fill());
+        }
+        out.write(text.data(), size);
+        for (; padding > 0; --padding) {
+            out.put(out.fill());
+        }
+    }
+
+    template <typename Out>
+    std::enable_if_t<!std::is_base_of<std::ostream, Out>::value> write_text(Out &out, mpp::string_ref text) {
+        requires_writable<std::string>::doit(out, text.str());
+    }
+
     template <typename T, bool = mpp::is_iterable_v<T>>
     struct iterable_writer;
 
@@ -86,6 +111,22 @@ namespace mpp_impl {
         }
     };
 
+    template <>
+    struct value_writer<mpp::string_ref> {
+        template <typename Out>
+        static void doit(Out &out, mpp::string_ref str) {
+            write_text(out, str);
+        }
+    };
+
+    template <typename Alloc>
+    struct value_writer<std::basic_string<char, std::char_traits<char>, Alloc>> {
+        template <typename Out>
+        static void doit(Out &out, mpp::string_ref str) {
+            write_text(out, str);
+        }
+    };
+
     template <typename T, typename R>
     struct value_writer<std::pair<T, R>> {
         template <typename Out>
@@ -277,82 +318,136 @@ namespace mpp_impl {
         stream_flags_saver &operator=(const stream_flags_saver &) = delete;
     };
 
+    /**
+     * A placeholder of a format string, {[.N][x|d|o|e][:[-]W[|F]]}:
+     * N digits after the point, a radix or the scientific notation, and
+     * a field of width W, aligned left with '-', filled with F.
+     */
+    struct format_spec {
+        int precision = -1;
+        char radix = 0;
+        int width = -1;
+        bool left = false;
+        bool has_fill = false;
+        char fill = ' ';
+    };
+
+    inline const char *parse_format_int(const char *p, const char *end, int &value) {
+        value = 0;
+        for (; p != end && is_ascii_digit(*p); ++p) {
+            // saturate instead of overflowing on absurd widths
+            value = value > (INT_MAX - 9) / 10 ? INT_MAX : value * 10 + (*p - '0');
+        }
+        return p;
+    }
+
+    /**
+     * Parse the placeholder starting at the '{' at p.
+     *
+     * @return the end of the placeholder, or nullptr if p does not start one
+     */
+    inline const char *parse_format_spec(const char *p, const char *end, format_spec &spec) {
+        spec = format_spec();
+        ++p;
+        if (end - p >= 2 && p[0] == '.' && is_ascii_digit(p[1])) {
+            p = parse_format_int(p + 1, end, spec.precision);
+        }
+        if (p != end && (*p == 'x' || *p == 'd' || *p == 'o' || *p == 'e')) {
+            spec.radix = *p++;
+        }
+        if (p != end && *p == ':') {
+            ++p;
+            if (p != end && *p == '-') {
+                spec.left = true;
+                ++p;
+            }
+            if (p == end || !is_ascii_digit(*p)) {
+                return nullptr;
+            }
+            p = parse_format_int(p, end, spec.width);
+            // any fill but a line break
+            if (end - p >= 2 && p[0] == '|' && p[1] != '\n' && p[1] != '\r') {
+                spec.has_fill = true;
+                spec.fill = p[1];
+                p += 2;
+            }
+        }
+        return p != end && *p == '}' ? p + 1 : nullptr;
+    }
+
+    /**
+     * Find the first placeholder in fmt.
+     *
+     * @return whether there is one, at [start, stop)
+     */
+    inline bool find_format_spec(mpp::string_ref fmt, size_t &start, size_t &stop, format_spec &spec) {
+        const char *begin = fmt.data();
+        const char *end = begin + fmt.size();
+        for (size_t pos = fmt.find('{'); pos != mpp::string_ref::npos; pos = fmt.find('{', pos + 1)) {
+            const char *spec_end = parse_format_spec(begin + pos, end, spec);
+            if (spec_end != nullptr) {
+                start = pos;
+                stop = static_cast<size_t>(spec_end - begin);
+                return true;
+            }
+        }
+        return false;
+    }
+
     template <typename Out, typename T>
-    void write_value_and_control(Out &out, T &&t, const match_t &match) {
+    void write_value_and_control(Out &out, T &&t, const format_spec &spec) {
         using actual_type = remove_cr_t<T>;
-        const std::string &floats = match.str(1);
-        const std::string &formats = match.str(2);
-        const std::string &align = match.str(3);
 
         // restore format flags for the next format cycle.
         stream_flags_saver<Out> saver(out);
 
-        if (!floats.empty()) {
-            // regex ensures the atoi will never fail
-            int npoints = ::atoi(floats.c_str() + 1);
-            control_writer<ctflag::FLOATINGS, actual_type>::doit(out, npoints);
-        }
-
-        if (!formats.empty()) {
-            switch (*formats.c_str()) {
-                case 'x':
-                    control_writer<ctflag::FORMAT_HEX, actual_type>::doit(out);
-                    break;
-                case 'o':
-                    control_writer<ctflag::FORMAT_OCT, actual_type>::doit(out);
-                    break;
-                case 'd':
-                    control_writer<ctflag::FORMAT_DEC, actual_type>::doit(out);
-                    break;
-                case 'e':
-                    control_writer<ctflag::FORMAT_SCI, actual_type>::doit(out);
-                    break;
-                default:
-                    break;
-            }
+        if (spec.precision >= 0) {
+            control_writer<ctflag::FLOATINGS, actual_type>::doit(out, spec.precision);
         }
 
-        if (!align.empty()) {
-            bool left = *(align.c_str() + 1) == '-';
-            // regex ensures the atoi will never fail
-            int width = ::atoi(left ? align.c_str() + 2 : align.c_str() + 1);
-            control_writer<ctflag::ALIGN, actual_type>::doit(out, width, left);
+        switch (spec.radix) {
+            case 'x':
+                control_writer<ctflag::FORMAT_HEX, actual_type>::doit(out);
+                break;
+            case 'o':
+                control_writer<ctflag::FORMAT_OCT, actual_type>::doit(out);
+                break;
+            case 'd':
+                control_writer<ctflag::FORMAT_DEC, actual_type>::doit(out);
+                break;
+            case 'e':
+                control_writer<ctflag::FORMAT_SCI, actual_type>::doit(out);
+                break;
+            default:
+                break;
+        }
 
-            // check the fill control flag
-            const std::string &fill = match.str(4);
-            if (!fill.empty()) {
-                char fill_ch = *(fill.c_str() + 1);
-                control_writer<ctflag::FILL, actual_type>::doit(out, fill_ch);
+        if (spec.width >= 0) {
+            control_writer<ctflag::ALIGN, actual_type>::doit(out, spec.width, spec.left);
+            if (spec.has_fill) {
+                control_writer<ctflag::FILL, actual_type>::doit(out, spec.fill);
             }
         }
 
         write_value(out, std::forward<T>(t));
     }
 
-    template <typename Out, typename T>
-    bool try_format_one(Out &out, mpp::string_ref &fmt, const std::regex &re, T &&t) {
-        string_iter_t begin = fmt.begin();
-        string_iter_t end = fmt.end();
-
-        std::regex_iterator<string_iter_t> re_begin(begin, end, re), re_end;
-        if (re_begin != re_end) {
-            // text before the match
-            write_value(out, fmt.slice(0, re_begin->position(0)).str());
-            // the match itself
-            write_value_and_control(out, std::forward<T>(t), *re_begin);
-            // the rest text to be matched next time
-            fmt = fmt.substr(re_begin->position(0) + re_begin->length(0));
-            // be greedy
-            return true;
-        }
-        // nothing to match
-        return false;
-    }
-
     template <typename Out, typename T>
     bool format_impl(Out &out, mpp::string_ref &fmt, T &&t) {
-        std::regex r(R"(\{(\.[0-9]+)?([xdoe])?(\:\-?[0-9]+(\|.)?)?\})");
-        return try_format_one(out, fmt, r, std::forward<T>(t));
+        MOZART_STRING_PROBE(format_placeholder, fmt.size());
+        size_t start = 0;
+        size_t stop = 0;
+        format_spec spec;
+        if (!find_format_spec(fmt, start, stop, spec)) {
+            // nothing to match
+            return false;
+        }
+        // text before the placeholder
+        write_text(out, fmt.slice(0, start));
+        write_value_and_control(out, std::forward<T>(t), spec);
+        // the rest text to be matched next time
+        fmt = fmt.substr(stop);
+        return true;
     }
 
     template <typename Out, typename T, typename ...Args>
@@ -365,17 +460,91 @@ namespace mpp_impl {
     }
 
     template <typename Out>
-    void format(Out &out, const std::string &fmt) {
-        write_value(out, fmt);
+    void format_ref(Out &out, mpp::string_ref fmt) {
+        MOZART_STRING_PROBE(format, fmt.size());
+        write_text(out, fmt);
+    }
+
+    template <typename Out, typename ...Args>
+    void format_ref(Out &out, mpp::string_ref fmt, Args &&... args) {
+        MOZART_STRING_PROBE(format, fmt.size());
+        mpp_impl::format_impl(out, fmt, std::forward<Args>(args)...);
+        if (!fmt.empty()) {
+            write_text(out, fmt);
+        }
     }
 
+    /**
+     * Format into a stream (or anything writable with operator<<).
+     * Strings are never outputs here, so that mpp::format(fmt, args...)
+     * stays unambiguous when the first argument converts to a string.
+     */
     template <typename Out, typename ...Args>
-    void format(Out &out, const std::string &fmt, Args &&... args) {
-        mpp::string_ref fmt_ref{fmt};
-        mpp_impl::format_impl(out, fmt_ref, std::forward<Args>(args)...);
-        if (!fmt_ref.empty()) {
-            write_value(out, fmt_ref.str());
+    std::enable_if_t<!std::is_convertible<Out &, mpp::string_ref>::value>
+    format(Out &out, const std::string &fmt, Args &&... args) {
+        mpp_impl::format_ref(out, mpp::string_ref(fmt), std::forward<Args>(args)...);
+    }
+
+    /**
+     * A stream buffer appending to a string through a small put area,
+     * so that formatting into a string needs no stringstream of its own
+     * and allocates only through the string's allocator.
+     */
+    template <typename String>
+    class string_append_buffer : public std::streambuf {
+    private:
+        String &_out;
+        char _pending[128];
+
+        void drain() {
+            _out.append(pbase(), static_cast<size_t>(pptr() - pbase()));
+            setp(_pending, _pending + sizeof(_pending));
+        }
+
+    protected:
+        int_type overflow(int_type c) override {
+            drain();
+            if (!traits_type::eq_int_type(c, traits_type::eof())) {
+                *pptr() = traits_type::to_char_type(c);
+                pbump(1);
+            }
+            return traits_type::not_eof(c);
         }
+
+        std::streamsize xsputn(const char *s, std::streamsize n) override {
+            if (n <= epptr() - pptr()) {
+                std::memcpy(pptr(), s, static_cast<size_t>(n));
+                pbump(static_cast<int>(n));
+            } else {
+                drain();
+                _out.append(s, static_cast<size_t>(n));
+            }
+            return n;
+        }
+
+        int sync() override {
+            drain();
+            return 0;
+        }
+
+    public:
+        explicit string_append_buffer(String &out) : _out(out) {
+            setp(_pending, _pending + sizeof(_pending));
+        }
+
+        string_append_buffer(const string_append_buffer &) = delete;
+        string_append_buffer &operator=(const string_append_buffer &) = delete;
+
+        ~string_append_buffer() override {
+            drain();
+        }
+    };
+
+    template <typename String, typename ...Args>
+    void format_append(String &out, mpp::string_ref fmt, Args &&... args) {
+        string_append_buffer<String> buffer(out);
+        std::ostream stream(&buffer);
+        mpp_impl::format_ref(stream, fmt, std::forward<Args>(args)...);
     }
 }
 
@@ -388,8 +557,41 @@ namespace mpp {
 
     template <typename ...Args>
     std::string format(const std::string &fmt, Args &&... args) {
-        std::stringstream out;
-        format(out, fmt, std::forward<Args>(args)...);
-        return out.str();
+        std::string result;
+        mpp_impl::format_append(result, fmt, std::forward<Args>(args)...);
+        MOZART_STRING_COUNT_ALLOCATIONS(format, mpp_impl::heap_allocated(result));
+        return result;
+    }
+
+    /**
+     * Format into a string allocated by alloc, e.g.
+     * mpp::format(std::allocator_arg, arena_allocator<char>(arena), "{}", x).
+     * Nothing else is allocated on the way.
+     *
+     * @param alloc
+     * @param fmt
+     * @param args
+     * @return
+     */
+    template <typename Alloc, typename ...Args>
+    alloc_string<Alloc> format(std::allocator_arg_t, const Alloc &alloc, string_ref fmt, Args &&... args) {
+        using string_type = alloc_string<Alloc>;
+        string_type result{typename string_type::allocator_type(alloc)};
+        mpp_impl::format_append(result, fmt, std::forward<Args>(args)...);
+        MOZART_STRING_COUNT_ALLOCATIONS(format, mpp_impl::heap_allocated(result));
+        return result;
+    }
+
+    /**
+     * Append the output of mpp::format(fmt, args...) to out, whatever
+     * its allocator, reusing its capacity.
+     *
+     * @param out
+     * @param fmt
+     * @param args
+     */
+    template <typename Alloc, typename ...Args>
+    void format_to(std::basic_string<char, std::char_traits<char>, Alloc> &out, string_ref fmt, Args &&... args) {
+        mpp_impl::format_append(out, fmt, std::forward<Args>(args)...);
     }
 }
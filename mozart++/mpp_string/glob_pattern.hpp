@@ -0,0 +1,296 @@
+/**
+ * Mozart++ Template Library: String
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#pragma once
+
+#include <mozart++/core>
+#include <mozart++/string>
+#include "simd.hpp"
+#include "batch.hpp"
+#include "pattern.hpp"
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace mpp_impl {
+    /**
+     * The part of a glob between two stars, of a fixed length.
+     */
+    struct glob_segment {
+        // the literal bytes, folded when ignoring case
+        std::string bytes;
+        // for every byte: -1 for a literal, -2 for '?', or the index of a
+        // class; empty when all of them are literals
+        std::vector<int> kinds;
+        // the longest literal run, what the segment is searched by
+        size_t anchor = 0;
+        size_t anchor_size = 0;
+    };
+
+    /**
+     * Find a needle in [data, data + size), ignoring case if fold, the
+     * needle being lower case then. Blocks are scanned for its first and
+     * last bytes at once (in either case), and the candidates compared.
+     */
+    inline size_t find_segment_literal(const char *data, size_t size, mpp::string_ref needle, bool fold) {
+        size_t n = needle.size();
+        if (n == 0) {
+            return 0;
+        }
+        if (size < n) {
+            return mpp::string_ref::npos;
+        }
+        auto other_case = [fold](char c) {
+            return fold && c >= 'a' && c <= 'z' ? static_cast<char>(c - 'a' + 'A') : c;
+        };
+        char first = needle[0];
+        char first_other = other_case(first);
+        char last = needle[n - 1];
+        char last_other = other_case(last);
+        auto same = [&](size_t at) {
+            return fold ? mpp::string_ref(data + at, n).equals_ignore_case(needle)
+                        : std::memcmp(data + at, needle.data(), n) == 0;
+        };
+        size_t end = size - n;
+        size_t i = 0;
+        for (; i + simd_block <= end + 1; i += simd_block) {
+            std::uint32_t mask = (simd_mask_eq(data + i, first) | simd_mask_eq(data + i, first_other))
+                                 & (simd_mask_eq(data + i + n - 1, last) | simd_mask_eq(data + i + n - 1, last_other));
+            for (; mask != 0; mask &= mask - 1) {
+                size_t at = i + ctz32(mask);
+                if (same(at)) {
+                    return at;
+                }
+            }
+        }
+        for (; i <= end; ++i) {
+            if ((data[i] == first || data[i] == first_other) && same(i)) {
+                return i;
+            }
+        }
+        return mpp::string_ref::npos;
+    }
+}
+
+namespace mpp {
+    /**
+     * A compiled shell wildcard: `*` for any run of bytes, `?` for any
+     * byte, `[a-z]` `[!a-z]` (or `[^a-z]`) for classes, and a backslash
+     * to take the next byte literally. A `[` with no `]` is a literal.
+     *
+     * The pattern is split at its stars into segments of fixed length.
+     * The first and the last are compared at the ends of the string, the
+     * ones in between are found left to right at their first occurrence,
+     * which is always the right choice: the matching is linear, with no
+     * backtracking. Each segment is searched for by its longest literal
+     * run, with a SIMD scan for its first and last bytes.
+     */
+    class glob_pattern {
+    private:
+        std::vector<mpp_impl::glob_segment> _segments;
+        std::vector<mpp_impl::byte_set> _classes;
+        size_t _min_size = 0;
+        bool _ignore_case;
+
+        /**
+         * Parse a class after its '['.
+         *
+         * @return the index of the class, or -1 if there is no ']'
+         */
+        int parse_class(const char *&p, const char *end) {
+            const char *cur = p;
+            mpp_impl::byte_set set;
+            bool negate = cur != end && (*cur == '!' || *cur == '^');
+            if (negate) {
+                ++cur;
+            }
+            // a ']' first is a literal
+            for (bool first = true; cur != end && (first || *cur != ']'); first = false) {
+                unsigned char lo = static_cast<unsigned char>(*cur++);
+                if (cur + 1 < end && *cur == '-' && cur[1] != ']') {
+                    auto hi = static_cast<unsigned char>(cur[1]);
+                    cur += 2;
+                    if (lo <= hi) {
+                        set.set_range(lo, hi);
+                    }
+                } else {
+                    set.set(lo);
+                }
+            }
+            if (cur == end) {
+                return -1;
+            }
+            p = cur + 1;
+            if (_ignore_case) {
+                set.fold_case();
+            }
+            if (negate) {
+                set.invert();
+            }
+            _classes.push_back(set);
+            return static_cast<int>(_classes.size() - 1);
+        }
+
+        void add(mpp_impl::glob_segment &segment, char c, int kind) {
+            segment.bytes.push_back(_ignore_case ? mpp_impl::ascii_fold(c) : c);
+            segment.kinds.push_back(kind);
+        }
+
+        void finish(mpp_impl::glob_segment &segment) {
+            size_t run = 0;
+            for (size_t i = 0; i < segment.kinds.size(); ++i) {
+                run = segment.kinds[i] == -1 ? run + 1 : 0;
+                if (run > segment.anchor_size) {
+                    segment.anchor_size = run;
+                    segment.anchor = i + 1 - run;
+                }
+            }
+            if (segment.anchor_size == segment.bytes.size()) {
+                segment.kinds.clear();
+            }
+            _min_size += segment.bytes.size();
+        }
+
+        bool match_at(const mpp_impl::glob_segment &segment, const char *p) const {
+            size_t n = segment.bytes.size();
+            if (segment.kinds.empty()) {
+                return n == 0 || (_ignore_case ? string_ref(p, n).equals_ignore_case(segment.bytes)
+                                               : std::memcmp(p, segment.bytes.data(), n) == 0);
+            }
+            // most strings fail on the anchor, which is compared as a whole
+            if (!_ignore_case && segment.anchor_size != 0
+                && std::memcmp(p + segment.anchor, segment.bytes.data() + segment.anchor, segment.anchor_size) != 0) {
+                return false;
+            }
+            for (size_t i = 0; i < n; ++i) {
+                int kind = segment.kinds[i];
+                if (kind == -1) {
+                    char c = _ignore_case ? mpp_impl::ascii_fold(p[i]) : p[i];
+                    if (c != segment.bytes[i]) {
+                        return false;
+                    }
+                } else if (kind >= 0 && !_classes[kind].test(static_cast<unsigned char>(p[i]))) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * The first position in [from, end) where a segment matches.
+         */
+        size_t find(const mpp_impl::glob_segment &segment, string_ref text, size_t from, size_t end) const {
+            size_t n = segment.bytes.size();
+            if (segment.anchor_size == 0) {
+                for (size_t p = from; p + n <= end; ++p) {
+                    if (match_at(segment, text.data() + p)) {
+                        return p;
+                    }
+                }
+                return string_ref::npos;
+            }
+            string_ref anchor(segment.bytes.data() + segment.anchor, segment.anchor_size);
+            // where the anchor may be, for the segment to fit
+            size_t first = from + segment.anchor;
+            size_t limit = end - (n - segment.anchor - segment.anchor_size);
+            while (first + anchor.size() <= limit) {
+                string_ref window(text.data() + first, limit - first);
+                size_t at = mpp_impl::find_segment_literal(window.data(), window.size(), anchor, _ignore_case);
+                if (at == string_ref::npos) {
+                    return string_ref::npos;
+                }
+                size_t p = first + at - segment.anchor;
+                if (segment.kinds.empty() || match_at(segment, text.data() + p)) {
+                    return p;
+                }
+                first += at + 1;
+            }
+            return string_ref::npos;
+        }
+
+    public:
+        /**
+         * Compile a pattern.
+         *
+         * @param source
+         * @param ignore_case match ASCII letters of either case
+         */
+        explicit glob_pattern(string_ref source, bool ignore_case = false) : _ignore_case(ignore_case) {
+            _segments.emplace_back();
+            const char *end = source.data() + source.size();
+            for (const char *p = source.data(); p != end;) {
+                char c = *p++;
+                if (c == '*') {
+                    // a run of stars is one star
+                    if (!_segments.back().bytes.empty() || _segments.size() == 1) {
+                        _segments.emplace_back();
+                    }
+                } else if (c == '?') {
+                    add(_segments.back(), c, -2);
+                } else if (c == '[') {
+                    int kind = parse_class(p, end);
+                    add(_segments.back(), c, kind >= 0 ? kind : -1);
+                } else if (c == '\\' && p != end) {
+                    add(_segments.back(), *p++, -1);
+                } else {
+                    add(_segments.back(), c, -1);
+                }
+            }
+            for (auto &segment : _segments) {
+                finish(segment);
+            }
+        }
+
+        /**
+         * Whether the whole of text matches.
+         *
+         * @param text
+         * @return
+         */
+        bool match(string_ref text) const {
+            size_t size = text.size();
+            if (size < _min_size) {
+                return false;
+            }
+            const mpp_impl::glob_segment &head = _segments.front();
+            if (_segments.size() == 1) {
+                return size == head.bytes.size() && match_at(head, text.data());
+            }
+            const mpp_impl::glob_segment &tail = _segments.back();
+            if (!match_at(head, text.data()) || !match_at(tail, text.data() + size - tail.bytes.size())) {
+                return false;
+            }
+            size_t pos = head.bytes.size();
+            size_t end = size - tail.bytes.size();
+            for (size_t i = 1; i + 1 < _segments.size(); ++i) {
+                pos = find(_segments[i], text, pos, end);
+                if (pos == string_ref::npos) {
+                    return false;
+                }
+                pos += _segments[i].bytes.size();
+            }
+            return true;
+        }
+
+        bool operator()(string_ref text) const {
+            return match(text);
+        }
+
+        /**
+         * Match many strings at once.
+         *
+         * @param strings
+         * @param out resized to the number of strings, bit i set if strings[i] matches
+         * @return the number of strings selected
+         */
+        size_t match(string_ref_span strings, selection_bitmap &out) const {
+            return mpp_impl::batch_select(strings, out, *this);
+        }
+    };
+}
@@ -0,0 +1,356 @@
+/**
+ * Mozart++ Template Library: String
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+/**
+ * Opt-in instrumentation of the string algorithms, mpp::format and
+ * codecvt conversions: define MOZART_STRING_INSTRUMENT (for the whole
+ * program) to count calls, bytes scanned, heap allocations and CPU
+ * cycles per operation. Without it the probes expand to nothing, and
+ * collect_string_stats() reports zeros.
+ *
+ * Every thread counts into its own counters, which are summed only when
+ * the statistics are collected. Cycles are inclusive: a split() also
+ * pays for the find() calls it makes, which are counted as well.
+ */
+#ifdef MOZART_STRING_INSTRUMENT
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#endif
+
+namespace mpp {
+    /**
+     * The instrumented operations.
+     */
+    enum class string_op : unsigned {
+        /**
+         * string_ref::find() of a char or a string.
+         */
+        find,
+        /**
+         * The memcmp() behind string_ref::compare(), equals(),
+         * startswith() and endswith().
+         */
+        compare,
+        /**
+         * string_ref::split() into a vector.
+         */
+        split,
+        /**
+         * string_ref::lower() and upper().
+         */
+        case_convert,
+        /**
+         * string_ref::str().
+         */
+        copy,
+        /**
+         * mpp::format(), to a string or a stream.
+         */
+        format,
+        /**
+         * Parsing and writing a placeholder inside mpp::format().
+         */
+        format_placeholder,
+        /**
+         * codecvt conversions from a local charset to wide characters.
+         */
+        decode,
+        /**
+         * codecvt conversions from wide characters to a local charset.
+         */
+        encode,
+    };
+}
+
+namespace mpp_impl {
+    static constexpr size_t string_op_count = 9;
+
+    /**
+     * Check whether a string keeps its characters on the heap rather than
+     * inside the object (the small string optimization).
+     */
+    template <typename CharT, typename Traits, typename Alloc>
+    bool heap_allocated(const std::basic_string<CharT, Traits, Alloc> &str) {
+        auto object = reinterpret_cast<const char *>(&str);
+        auto data = reinterpret_cast<const char *>(str.data());
+        return data < object || data >= object + sizeof(str);
+    }
+}
+
+namespace mpp {
+    struct string_op_stats {
+        std::uint64_t calls = 0;
+        std::uint64_t bytes = 0;
+        std::uint64_t allocations = 0;
+        std::uint64_t cycles = 0;
+    };
+
+    /**
+     * Counters of every operation, summed over all threads.
+     */
+    struct string_stats {
+        string_op_stats ops[mpp_impl::string_op_count];
+
+        string_op_stats &operator[](string_op op) { return ops[static_cast<unsigned>(op)]; }
+
+        const string_op_stats &operator[](string_op op) const { return ops[static_cast<unsigned>(op)]; }
+    };
+
+    inline const char *string_op_name(string_op op) {
+        static const char *names[] = {
+                "find", "compare", "split", "case_convert", "copy",
+                "format", "format_placeholder", "decode", "encode"
+        };
+        return names[static_cast<unsigned>(op)];
+    }
+
+    constexpr bool string_stats_enabled() {
+#ifdef MOZART_STRING_INSTRUMENT
+        return true;
+#else
+        return false;
+#endif
+    }
+}
+
+#ifdef MOZART_STRING_INSTRUMENT
+namespace mpp_impl {
+    inline std::uint64_t instrument_ticks() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    struct instrument_slot {
+        std::atomic<std::uint64_t> calls{0};
+        std::atomic<std::uint64_t> bytes{0};
+        std::atomic<std::uint64_t> allocations{0};
+        std::atomic<std::uint64_t> cycles{0};
+    };
+
+    /**
+     * Add to a counter only its own thread writes: a plain load and store,
+     * no locked instruction, while readers still see a whole value.
+     */
+    inline void instrument_add(std::atomic<std::uint64_t> &counter, std::uint64_t n) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    struct instrument_thread;
+
+    struct instrument_registry {
+        std::mutex lock;
+        std::vector<instrument_thread *> threads;
+        // counters of the threads that have exited
+        mpp::string_stats retired;
+        // subtracted from the totals, set by reset_string_stats()
+        mpp::string_stats baseline;
+    };
+
+    inline instrument_registry &instrument_registry_instance() {
+        static instrument_registry registry;
+        return registry;
+    }
+
+    inline void instrument_accumulate(mpp::string_stats &stats, const instrument_slot *slots) {
+        for (size_t i = 0; i < string_op_count; ++i) {
+            stats.ops[i].calls += slots[i].calls.load(std::memory_order_relaxed);
+            stats.ops[i].bytes += slots[i].bytes.load(std::memory_order_relaxed);
+            stats.ops[i].allocations += slots[i].allocations.load(std::memory_order_relaxed);
+            stats.ops[i].cycles += slots[i].cycles.load(std::memory_order_relaxed);
+        }
+    }
+
+    struct instrument_thread {
+        instrument_slot slots[string_op_count];
+
+        instrument_thread() {
+            instrument_registry &registry = instrument_registry_instance();
+            std::lock_guard<std::mutex> guard(registry.lock);
+            registry.threads.push_back(this);
+        }
+
+        ~instrument_thread() {
+            instrument_registry &registry = instrument_registry_instance();
+            std::lock_guard<std::mutex> guard(registry.lock);
+            instrument_accumulate(registry.retired, slots);
+            for (auto &thread : registry.threads) {
+                if (thread == this) {
+                    thread = registry.threads.back();
+                    registry.threads.pop_back();
+                    break;
+                }
+            }
+        }
+
+        instrument_thread(const instrument_thread &) = delete;
+        instrument_thread &operator=(const instrument_thread &) = delete;
+    };
+
+    inline instrument_slot &instrument_slot_of(mpp::string_op op) {
+        static thread_local instrument_thread thread;
+        return thread.slots[static_cast<unsigned>(op)];
+    }
+
+    /**
+     * Count a call and its bytes, and the cycles until the end of the scope.
+     */
+    class instrument_probe {
+    private:
+        instrument_slot &_slot;
+        std::uint64_t _start;
+
+    public:
+        instrument_probe(mpp::string_op op, size_t bytes) : _slot(instrument_slot_of(op)) {
+            instrument_add(_slot.calls, 1);
+            instrument_add(_slot.bytes, bytes);
+            _start = instrument_ticks();
+        }
+
+        ~instrument_probe() {
+            instrument_add(_slot.cycles, instrument_ticks() - _start);
+        }
+
+        instrument_probe(const instrument_probe &) = delete;
+        instrument_probe &operator=(const instrument_probe &) = delete;
+    };
+
+    inline void instrument_allocations(mpp::string_op op, size_t count) {
+        if (count != 0) {
+            instrument_add(instrument_slot_of(op).allocations, count);
+        }
+    }
+
+    /**
+     * Count one allocation if a container grew during the scope.
+     */
+    template <typename Container>
+    class instrument_capacity_watch {
+    private:
+        mpp::string_op _op;
+        const Container &_container;
+        size_t _capacity;
+
+    public:
+        instrument_capacity_watch(mpp::string_op op, const Container &container)
+                : _op(op), _container(container), _capacity(container.capacity()) {}
+
+        ~instrument_capacity_watch() {
+            instrument_allocations(_op, _container.capacity() != _capacity ? 1 : 0);
+        }
+
+        instrument_capacity_watch(const instrument_capacity_watch &) = delete;
+        instrument_capacity_watch &operator=(const instrument_capacity_watch &) = delete;
+    };
+}
+
+#define MOZART_STRING_PROBE(op, bytes) \
+    ::mpp_impl::instrument_probe mozart_string_probe_(::mpp::string_op::op, (bytes))
+#define MOZART_STRING_COUNT_ALLOCATIONS(op, count) \
+    ::mpp_impl::instrument_allocations(::mpp::string_op::op, (count))
+#define MOZART_STRING_WATCH_CAPACITY(op, container) \
+    ::mpp_impl::instrument_capacity_watch<typename std::decay<decltype(container)>::type> \
+            mozart_string_watch_(::mpp::string_op::op, (container))
+#else
+#define MOZART_STRING_PROBE(op, bytes) ((void) 0)
+#define MOZART_STRING_COUNT_ALLOCATIONS(op, count) ((void) 0)
+#define MOZART_STRING_WATCH_CAPACITY(op, container) ((void) 0)
+#endif
+
+namespace mpp {
+    /**
+     * Sum the counters of all threads, live and exited, since the last
+     * reset_string_stats().
+     */
+    inline string_stats collect_string_stats() {
+        string_stats stats;
+#ifdef MOZART_STRING_INSTRUMENT
+        mpp_impl::instrument_registry &registry = mpp_impl::instrument_registry_instance();
+        std::lock_guard<std::mutex> guard(registry.lock);
+        stats = registry.retired;
+        for (const auto *thread : registry.threads) {
+            mpp_impl::instrument_accumulate(stats, thread->slots);
+        }
+        for (size_t i = 0; i < mpp_impl::string_op_count; ++i) {
+            stats.ops[i].calls -= registry.baseline.ops[i].calls;
+            stats.ops[i].bytes -= registry.baseline.ops[i].bytes;
+            stats.ops[i].allocations -= registry.baseline.ops[i].allocations;
+            stats.ops[i].cycles -= registry.baseline.ops[i].cycles;
+        }
+#endif
+        return stats;
+    }
+
+    /**
+     * Start counting from zero again. Threads keep writing their own
+     * counters, the current totals become the new baseline.
+     */
+    inline void reset_string_stats() {
+#ifdef MOZART_STRING_INSTRUMENT
+        mpp_impl::instrument_registry &registry = mpp_impl::instrument_registry_instance();
+        std::lock_guard<std::mutex> guard(registry.lock);
+        string_stats totals = registry.retired;
+        for (const auto *thread : registry.threads) {
+            mpp_impl::instrument_accumulate(totals, thread->slots);
+        }
+        registry.baseline = totals;
+#endif
+    }
+
+    /**
+     * Render statistics as a table, one line per operation called.
+     */
+    inline std::string format_string_stats(const string_stats &stats) {
+        std::string result;
+        char line[160];
+        std::snprintf(line, sizeof(line), "%-20s %12s %14s %12s %16s %10s\n",
+                      "operation", "calls", "bytes", "allocations", "cycles", "cyc/call");
+        result += line;
+        for (unsigned i = 0; i < mpp_impl::string_op_count; ++i) {
+            const string_op_stats &op = stats.ops[i];
+            if (op.calls == 0) {
+                continue;
+            }
+            std::snprintf(line, sizeof(line), "%-20s %12llu %14llu %12llu %16llu %10.1f\n",
+                          string_op_name(static_cast<string_op>(i)),
+                          static_cast<unsigned long long>(op.calls), static_cast<unsigned long long>(op.bytes),
+                          static_cast<unsigned long long>(op.allocations),
+                          static_cast<unsigned long long>(op.cycles),
+                          static_cast<double>(op.cycles) / static_cast<double>(op.calls));
+            result += line;
+        }
+        return result;
+    }
+
+    /**
+     * Print the statistics collected so far.
+     *
+     * @param out
+     */
+    inline void dump_string_stats(std::FILE *out = stderr) {
+        std::string table = format_string_stats(collect_string_stats());
+        std::fwrite(table.data(), 1, table.size(), out);
+    }
+}
@@ -0,0 +1,374 @@
+/**
+ * Mozart++ Template Library: String
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#pragma once
+
+#include <mozart++/core>
+#include <mozart++/string>
+#include <mozart++/iterator_range>
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <string>
+
+#ifdef MOZART_PLATFORM_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <memory>
+#endif
+
+namespace mpp {
+    /**
+     * How a mapped file is going to be read, passed on to madvise().
+     */
+    enum class access_hint {
+        normal, sequential, random, willneed
+    };
+
+    struct mapped_file_options {
+        access_hint hint = access_hint::sequential;
+        /**
+         * Ask for transparent huge pages (MADV_HUGEPAGE), best effort:
+         * ignored where the kernel or file system does not support it.
+         */
+        bool huge_pages = false;
+        /**
+         * Fault in the whole file up front (MAP_POPULATE).
+         */
+        bool populate = false;
+    };
+
+    /**
+     * A read-only view of a whole file.
+     *
+     * On Unix the file is mapped with mmap(), so the contents are paged in
+     * on demand and never copied; elsewhere it is read into memory.
+     * The contents are exposed as a string_ref valid while the mapped_file
+     * is open.
+     */
+    class mapped_file {
+    private:
+        const char *_data = nullptr;
+        size_t _size = 0;
+        bool _open = false;
+#ifndef MOZART_PLATFORM_UNIX
+        std::unique_ptr<char[]> _buffer;
+#endif
+
+#ifdef MOZART_PLATFORM_UNIX
+        static int advice_of(access_hint hint) {
+            switch (hint) {
+                case access_hint::sequential:
+                    return MADV_SEQUENTIAL;
+                case access_hint::random:
+                    return MADV_RANDOM;
+                case access_hint::willneed:
+                    return MADV_WILLNEED;
+                default:
+                    return MADV_NORMAL;
+            }
+        }
+
+        static size_t page_size() {
+            static const size_t size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+            return size;
+        }
+#endif
+
+    public:
+        mapped_file() = default;
+
+        /**
+         * Map a file.
+         *
+         * @param path
+         * @param options
+         */
+        explicit mapped_file(const std::string &path, const mapped_file_options &options = mapped_file_options()) {
+            open(path, options);
+        }
+
+        mapped_file(mapped_file &&other) noexcept {
+            *this = std::move(other);
+        }
+
+        mapped_file &operator=(mapped_file &&other) noexcept {
+            if (this != &other) {
+                close();
+                std::swap(_data, other._data);
+                std::swap(_size, other._size);
+                std::swap(_open, other._open);
+#ifndef MOZART_PLATFORM_UNIX
+                std::swap(_buffer, other._buffer);
+#endif
+            }
+            return *this;
+        }
+
+        mapped_file(const mapped_file &) = delete;
+        mapped_file &operator=(const mapped_file &) = delete;
+
+        ~mapped_file() {
+            close();
+        }
+
+        void open(const std::string &path, const mapped_file_options &options = mapped_file_options()) {
+            close();
+#ifdef MOZART_PLATFORM_UNIX
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                mpp::throw_ex<mpp::runtime_error>("mapped_file: cannot open " + path);
+            }
+            struct stat st;
+            if (::fstat(fd, &st) != 0) {
+                ::close(fd);
+                mpp::throw_ex<mpp::runtime_error>("mapped_file: cannot stat " + path);
+            }
+            size_t size = static_cast<size_t>(st.st_size);
+            if (size == 0) {
+                // mmap() refuses empty mappings
+                ::close(fd);
+                _open = true;
+                return;
+            }
+
+            int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+            if (options.populate) {
+                flags |= MAP_POPULATE;
+            }
+#endif
+            void *data = ::mmap(nullptr, size, PROT_READ, flags, fd, 0);
+            // the mapping keeps the file alive
+            ::close(fd);
+            if (data == MAP_FAILED) {
+                mpp::throw_ex<mpp::runtime_error>("mapped_file: cannot map " + path);
+            }
+            _data = static_cast<const char *>(data);
+            _size = size;
+            _open = true;
+
+            advise(options.hint);
+#ifdef MADV_HUGEPAGE
+            if (options.huge_pages) {
+                ::madvise(data, size, MADV_HUGEPAGE);
+            }
+#endif
+#else
+            std::ifstream in(path, std::ios::binary | std::ios::ate);
+            if (!in) {
+                mpp::throw_ex<mpp::runtime_error>("mapped_file: cannot open " + path);
+            }
+            size_t size = static_cast<size_t>(in.tellg());
+            _buffer.reset(new char[size + 1]);
+            in.seekg(0);
+            if (!in.read(_buffer.get(), static_cast<std::streamsize>(size))) {
+                _buffer.reset();
+                mpp::throw_ex<mpp::runtime_error>("mapped_file: cannot read " + path);
+            }
+            _data = _buffer.get();
+            _size = size;
+            _open = true;
+#endif
+        }
+
+        void close() {
+#ifdef MOZART_PLATFORM_UNIX
+            if (_data != nullptr) {
+                ::munmap(const_cast<char *>(_data), _size);
+            }
+#else
+            _buffer.reset();
+#endif
+            _data = nullptr;
+            _size = 0;
+            _open = false;
+        }
+
+        /**
+         * Tell the kernel how [offset, offset + length) will be accessed,
+         * e.g. willneed on the next chunk to read it ahead.
+         * Hints are advisory and errors are ignored.
+         *
+         * @param hint
+         * @param offset
+         * @param length
+         */
+        void advise(access_hint hint, size_t offset = 0, size_t length = string_ref::npos) const {
+#ifdef MOZART_PLATFORM_UNIX
+            if (_data == nullptr || offset >= _size) {
+                return;
+            }
+            length = std::min(length, _size - offset);
+            // madvise() wants a page-aligned start
+            size_t aligned = offset - offset % page_size();
+            ::madvise(const_cast<char *>(_data) + aligned, length + (offset - aligned), advice_of(hint));
+#else
+            (void) hint;
+            (void) offset;
+            (void) length;
+#endif
+        }
+
+        bool is_open() const { return _open; }
+
+        const char *data() const { return _data; }
+
+        size_t size() const { return _size; }
+
+        bool empty() const { return _size == 0; }
+
+        string_ref ref() const { return string_ref{_data, _size}; }
+
+        /*implicit*/ operator string_ref() const { return ref(); }
+    };
+
+    /**
+     * Forward iterator over the lines of a string, without the '\n'.
+     * A trailing newline does not start another (empty) line.
+     */
+    class line_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = string_ref;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const string_ref *;
+        using reference = string_ref;
+
+    private:
+        const char *_cursor = nullptr;
+        const char *_end = nullptr;
+        string_ref _line;
+
+        void next() {
+            if (_cursor == _end) {
+                _cursor = nullptr;
+                return;
+            }
+            const void *nl = std::memchr(_cursor, '\n', _end - _cursor);
+            const char *line_end = nl ? static_cast<const char *>(nl) : _end;
+            _line = string_ref{_cursor, static_cast<size_t>(line_end - _cursor)};
+            _cursor = nl ? line_end + 1 : _end;
+        }
+
+    public:
+        line_iterator() = default;
+
+        explicit line_iterator(string_ref str)
+                : _cursor(str.data()), _end(str.data() + str.size()) {
+            if (str.empty()) {
+                _cursor = nullptr;
+            } else {
+                next();
+            }
+        }
+
+        string_ref operator*() const { return _line; }
+
+        const string_ref *operator->() const { return &_line; }
+
+        line_iterator &operator++() {
+            next();
+            return *this;
+        }
+
+        line_iterator operator++(int) {
+            line_iterator old = *this;
+            next();
+            return old;
+        }
+
+        bool operator==(const line_iterator &rhs) const {
+            return _cursor == rhs._cursor;
+        }
+
+        bool operator!=(const line_iterator &rhs) const { return !(*this == rhs); }
+    };
+
+    /**
+     * Iterate over the lines of a string.
+     *
+     * @param str
+     * @return range of string_refs into str
+     */
+    inline mpp::iterator_range<line_iterator> lines(string_ref str) {
+        return mpp::make_range(line_iterator(str), line_iterator());
+    }
+
+    /**
+     * A piece of a large string handed out by chunked_reader.
+     */
+    struct string_chunk {
+        /**
+         * Position of data in the whole string.
+         */
+        size_t offset = 0;
+        /**
+         * The chunk, including the overlap into the next chunk.
+         */
+        string_ref data;
+        /**
+         * Length of the part of data that belongs to this chunk.
+         * Count a match only if it starts before owned, so that matches
+         * inside the overlap are reported once.
+         */
+        size_t owned = 0;
+
+        bool owns(size_t index) const { return index < owned; }
+    };
+
+    /**
+     * Cut a large string into fixed-size chunks that overlap by a few
+     * bytes, so that any pattern of up to overlap + 1 bytes lies entirely
+     * in the chunk where it starts.
+     */
+    class chunked_reader {
+    private:
+        string_ref _data;
+        size_t _chunk_size;
+        size_t _overlap;
+        size_t _offset = 0;
+
+    public:
+        /**
+         * @param data the whole string
+         * @param chunk_size bytes owned by each chunk
+         * @param overlap bytes shared with the next chunk, usually the
+         * longest pattern searched for minus one
+         */
+        chunked_reader(string_ref data, size_t chunk_size, size_t overlap = 0)
+                : _data(data), _chunk_size(std::max<size_t>(chunk_size, 1)), _overlap(overlap) {}
+
+        /**
+         * Get the next chunk.
+         *
+         * @param chunk filled in on success
+         * @return false when the string is exhausted
+         */
+        bool next(string_chunk &chunk) {
+            if (_offset >= _data.size()) {
+                return false;
+            }
+            chunk.offset = _offset;
+            chunk.owned = std::min(_chunk_size, _data.size() - _offset);
+            chunk.data = _data.substr(_offset, _chunk_size + _overlap);
+            _offset += chunk.owned;
+            return true;
+        }
+
+        void reset() { _offset = 0; }
+
+        size_t chunk_count() const {
+            return (_data.size() + _chunk_size - 1) / _chunk_size;
+        }
+    };
+}
@@ -0,0 +1,190 @@
+/**
+ * Mozart++ Template Library: String
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#pragma once
+
+#include <mozart++/core>
+#include <mozart++/string>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mpp_impl {
+    /**
+     * Below this size natural_sort() compares the strings directly,
+     * building keys does not pay off.
+     */
+    static constexpr size_t natural_sort_key_threshold = 32;
+
+    /**
+     * Append a sort key for str whose memcmp() order is the natural order
+     * (up to leading zeros): other bytes are copied, case folded if asked
+     * to, and a number becomes '0', its length without leading zeros
+     * (one byte, or 0xFF and 8 big-endian bytes) and its digits.
+     * Since no other byte falls in '0'..'9', a number still compares
+     * against other characters like its first digit does.
+     */
+    inline void append_natural_key(std::string &out, mpp::string_ref str, bool fold) {
+        const char *p = str.data();
+        const char *end = p + str.size();
+        while (p != end) {
+            if (!is_ascii_digit(*p)) {
+                out.push_back(fold ? ascii_fold(*p) : *p);
+                ++p;
+                continue;
+            }
+            while (p != end && *p == '0') {
+                ++p;
+            }
+            const char *digits = p;
+            while (p != end && is_ascii_digit(*p)) {
+                ++p;
+            }
+            auto length = static_cast<std::uint64_t>(p - digits);
+            out.push_back('0');
+            if (length < 0xFF) {
+                out.push_back(static_cast<char>(length));
+            } else {
+                out.push_back(static_cast<char>(0xFF));
+                for (int shift = 56; shift >= 0; shift -= 8) {
+                    out.push_back(static_cast<char>(length >> shift));
+                }
+            }
+            out.append(digits, p);
+        }
+    }
+
+    struct natural_key {
+        // the first 8 key bytes, big-endian, so most comparisons are one integer compare
+        std::uint64_t prefix;
+        size_t offset;
+        size_t length;
+        size_t index;
+    };
+}
+
+namespace mpp {
+    /**
+     * Compare two strings in natural order, e.g. "v1.9" < "v1.10" and
+     * "IMG_2" < "img_10" when ignoring case.
+     *
+     * @param lhs
+     * @param rhs
+     * @param ignore_case compare ASCII letters case insensitively
+     * @return -1, 0 or 1
+     */
+    inline int natural_compare(string_ref lhs, string_ref rhs, bool ignore_case = false) {
+        return mpp_impl::natural_compare(lhs.data(), lhs.size(), rhs.data(), rhs.size(), ignore_case);
+    }
+
+    /**
+     * Natural order as a comparator for std::sort() and ordered containers.
+     */
+    struct natural_less {
+        bool ignore_case = false;
+
+        bool operator()(string_ref lhs, string_ref rhs) const {
+            return natural_compare(lhs, rhs, ignore_case) < 0;
+        }
+    };
+
+    /**
+     * Stable sort of strings in natural order.
+     *
+     * Rather than parsing numbers again in every comparison, every
+     * string is turned into a key once (a Schwartzian transform) whose
+     * byte order is the natural order, and the keys are sorted with an
+     * integer compare of their first 8 bytes and memcmp().
+     *
+     * @param first random access iterators to std::string, string_ref or
+     * anything else convertible to string_ref
+     * @param last
+     * @param ignore_case compare ASCII letters case insensitively
+     */
+    template <typename Iter>
+    void natural_sort(Iter first, Iter last, bool ignore_case = false) {
+        using value_type = typename std::iterator_traits<Iter>::value_type;
+        auto count = static_cast<size_t>(std::distance(first, last));
+        if (count < mpp_impl::natural_sort_key_threshold) {
+            natural_less less;
+            less.ignore_case = ignore_case;
+            std::stable_sort(first, last, [&less](const value_type &lhs, const value_type &rhs) {
+                return less(string_ref(lhs), string_ref(rhs));
+            });
+            return;
+        }
+
+        std::vector<string_ref> strings;
+        strings.reserve(count);
+        size_t total = 0;
+        for (Iter it = first; it != last; ++it) {
+            strings.emplace_back(*it);
+            total += strings.back().size();
+        }
+
+        std::string keys;
+        keys.reserve(total + total / 2);
+        std::vector<mpp_impl::natural_key> order(count);
+        for (size_t i = 0; i < count; ++i) {
+            size_t offset = keys.size();
+            mpp_impl::append_natural_key(keys, strings[i], ignore_case);
+            order[i].offset = offset;
+            order[i].length = keys.size() - offset;
+            order[i].index = i;
+        }
+        for (auto &key : order) {
+            std::uint64_t prefix = 0;
+            for (size_t b = 0; b < 8; ++b) {
+                prefix <<= 8;
+                if (b < key.length) {
+                    prefix |= static_cast<unsigned char>(keys[key.offset + b]);
+                }
+            }
+            key.prefix = prefix;
+        }
+
+        const char *key_data = keys.data();
+        std::sort(order.begin(), order.end(),
+                  [&](const mpp_impl::natural_key &lhs, const mpp_impl::natural_key &rhs) {
+                      if (lhs.prefix != rhs.prefix) {
+                          return lhs.prefix < rhs.prefix;
+                      }
+                      size_t common = std::min(lhs.length, rhs.length);
+                      if (common > 8) {
+                          int r = std::memcmp(key_data + lhs.offset + 8, key_data + rhs.offset + 8, common - 8);
+                          if (r != 0) {
+                              return r < 0;
+                          }
+                      }
+                      if (lhs.length != rhs.length) {
+                          return lhs.length < rhs.length;
+                      }
+                      // same key: leading zeros decide, then the original order
+                      int r = mpp_impl::natural_compare(strings[lhs.index].data(), strings[lhs.index].size(),
+                                                        strings[rhs.index].data(), strings[rhs.index].size(),
+                                                        ignore_case);
+                      return r != 0 ? r < 0 : lhs.index < rhs.index;
+                  });
+
+        std::vector<value_type> sorted;
+        sorted.reserve(count);
+        for (const auto &key : order) {
+            sorted.push_back(std::move(first[key.index]));
+        }
+        std::move(sorted.begin(), sorted.end(), first);
+    }
+
+    template <typename Container>
+    void natural_sort(Container &strings, bool ignore_case = false) {
+        natural_sort(std::begin(strings), std::end(strings), ignore_case);
+    }
+}
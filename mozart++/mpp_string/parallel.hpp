@@ -0,0 +1,256 @@
+/**
+ * Mozart++ Template Library: String
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#pragma once
+
+#include <mozart++/core>
+#include <mozart++/string>
+#include "simd.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace mpp {
+    struct parallel_options {
+        /**
+         * Number of threads including the caller, 0 for one per hardware thread.
+         */
+        size_t concurrency = 0;
+        /**
+         * Bytes per work item, sized to stay in the L2 cache.
+         */
+        size_t chunk_size = 256 * 1024;
+    };
+}
+
+namespace mpp_impl {
+    inline size_t parallel_threads(const mpp::parallel_options &options, size_t chunks) {
+        size_t threads = options.concurrency;
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        return std::max<size_t>(1, std::min(threads, chunks));
+    }
+
+    /**
+     * Run fn(chunk) for every chunk in [0, chunks).
+     * Threads claim the next unprocessed chunk from a shared counter, so
+     * a thread that finishes early keeps taking work from the others.
+     * The calling thread takes part, and the first exception is rethrown.
+     */
+    template <typename F>
+    void parallel_for_chunks(size_t chunks, const mpp::parallel_options &options, F &&fn) {
+        size_t threads = parallel_threads(options, chunks);
+        if (threads <= 1) {
+            for (size_t i = 0; i < chunks; ++i) {
+                fn(i);
+            }
+            return;
+        }
+
+        std::atomic<size_t> next{0};
+        std::exception_ptr error;
+        std::atomic_flag error_lock = ATOMIC_FLAG_INIT;
+        auto worker = [&] {
+            try {
+                for (size_t i = next++; i < chunks; i = next++) {
+                    fn(i);
+                }
+            } catch (...) {
+                if (!error_lock.test_and_set()) {
+                    error = std::current_exception();
+                }
+                // make the others stop
+                next = chunks;
+            }
+        };
+
+        std::vector<std::thread> pool;
+        pool.reserve(threads - 1);
+        for (size_t t = 1; t < threads; ++t) {
+            pool.emplace_back(worker);
+        }
+        worker();
+        for (auto &t : pool) {
+            t.join();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    inline size_t parallel_chunk_size(const mpp::parallel_options &options) {
+        return std::max<size_t>(options.chunk_size, 1);
+    }
+
+    inline size_t parallel_chunk_count(size_t size, const mpp::parallel_options &options) {
+        size_t chunk = parallel_chunk_size(options);
+        return (size + chunk - 1) / chunk;
+    }
+
+    /**
+     * Call fn(offset) for every occurrence of str starting in
+     * [begin, end) of text, overlapping occurrences included.
+     */
+    template <typename F>
+    void find_each(mpp::string_ref text, mpp::string_ref str, size_t begin, size_t end, F &&fn) {
+        // look N - 1 bytes past the chunk for matches starting inside it
+        mpp::string_ref window = text.slice(begin, end + str.size() - 1);
+        for (size_t i = window.find(str); i != mpp::string_ref::npos && begin + i < end;
+             i = window.find(str, i + 1)) {
+            fn(begin + i);
+        }
+    }
+}
+
+namespace mpp {
+    /**
+     * Count the occurrences of a char, splitting the work across threads.
+     *
+     * @param str
+     * @param c
+     * @param options
+     * @return same as str.count(c)
+     */
+    inline size_t parallel_count(string_ref str, char c, const parallel_options &options = parallel_options()) {
+        size_t chunk_size = mpp_impl::parallel_chunk_size(options);
+        size_t chunks = mpp_impl::parallel_chunk_count(str.size(), options);
+        std::vector<size_t> counts(chunks);
+        mpp_impl::parallel_for_chunks(chunks, options, [&](size_t i) {
+            string_ref chunk = str.substr(i * chunk_size, chunk_size);
+            counts[i] = mpp_impl::simd_count_range(chunk.bytes_begin(), chunk.bytes_end(),
+                                                   static_cast<std::uint8_t>(c), static_cast<std::uint8_t>(c));
+        });
+        size_t total = 0;
+        for (size_t count : counts) {
+            total += count;
+        }
+        return total;
+    }
+
+    /**
+     * Count the (possibly overlapping) occurrences of a string, splitting
+     * the work across threads. Matches spanning chunk boundaries are
+     * counted by the chunk they start in.
+     *
+     * @param str
+     * @param needle
+     * @param options
+     * @return same as str.count(needle)
+     */
+    inline size_t parallel_count(string_ref str, string_ref needle,
+                                 const parallel_options &options = parallel_options()) {
+        if (needle.empty() || needle.size() > str.size()) {
+            return str.count(needle);
+        }
+        size_t chunk_size = mpp_impl::parallel_chunk_size(options);
+        size_t chunks = mpp_impl::parallel_chunk_count(str.size(), options);
+        std::vector<size_t> counts(chunks);
+        mpp_impl::parallel_for_chunks(chunks, options, [&](size_t i) {
+            size_t begin = i * chunk_size;
+            size_t end = std::min(begin + chunk_size, str.size());
+            size_t count = 0;
+            mpp_impl::find_each(str, needle, begin, end, [&count](size_t) { ++count; });
+            counts[i] = count;
+        });
+        size_t total = 0;
+        for (size_t count : counts) {
+            total += count;
+        }
+        return total;
+    }
+
+    /**
+     * Find every (possibly overlapping) occurrence of a string,
+     * splitting the work across threads.
+     *
+     * @param str
+     * @param needle must not be empty
+     * @param options
+     * @return the offsets of all matches, in ascending order
+     */
+    inline std::vector<size_t> parallel_find_all(string_ref str, string_ref needle,
+                                                 const parallel_options &options = parallel_options()) {
+        if (needle.empty()) {
+            mpp::throw_ex<mpp::runtime_error>("parallel_find_all: empty needle");
+        }
+        size_t chunk_size = mpp_impl::parallel_chunk_size(options);
+        size_t chunks = mpp_impl::parallel_chunk_count(str.size(), options);
+        std::vector<std::vector<size_t>> found(chunks);
+        mpp_impl::parallel_for_chunks(chunks, options, [&](size_t i) {
+            size_t begin = i * chunk_size;
+            size_t end = std::min(begin + chunk_size, str.size());
+            mpp_impl::find_each(str, needle, begin, end, [&](size_t offset) { found[i].push_back(offset); });
+        });
+
+        size_t total = 0;
+        for (const auto &part : found) {
+            total += part.size();
+        }
+        std::vector<size_t> result;
+        result.reserve(total);
+        for (const auto &part : found) {
+            result.insert(result.end(), part.begin(), part.end());
+        }
+        return result;
+    }
+
+    /**
+     * Split a string into lines like mpp::lines(), splitting the work
+     * across threads. A line belongs to the chunk it starts in and may
+     * run past the end of it.
+     *
+     * @param str
+     * @param options
+     * @return the lines without '\n', in order
+     */
+    inline std::vector<string_ref> parallel_split_lines(string_ref str,
+                                                        const parallel_options &options = parallel_options()) {
+        size_t chunk_size = mpp_impl::parallel_chunk_size(options);
+        size_t chunks = mpp_impl::parallel_chunk_count(str.size(), options);
+        std::vector<std::vector<string_ref>> found(chunks);
+        const char *data = str.data();
+        size_t size = str.size();
+        mpp_impl::parallel_for_chunks(chunks, options, [&](size_t i) {
+            size_t begin = i * chunk_size;
+            size_t end = std::min(begin + chunk_size, size);
+
+            // the first line starting at or after begin
+            size_t p = begin;
+            if (begin != 0 && data[begin - 1] != '\n') {
+                const void *nl = std::memchr(data + begin, '\n', end - begin);
+                if (nl == nullptr) {
+                    return;
+                }
+                p = static_cast<const char *>(nl) - data + 1;
+            }
+
+            std::vector<string_ref> &lines = found[i];
+            while (p < end) {
+                const void *nl = std::memchr(data + p, '\n', size - p);
+                size_t line_end = nl ? static_cast<const char *>(nl) - data : size;
+                lines.emplace_back(data + p, line_end - p);
+                p = line_end + 1;
+            }
+        });
+
+        size_t total = 0;
+        for (const auto &part : found) {
+            total += part.size();
+        }
+        std::vector<string_ref> result;
+        result.reserve(total);
+        for (const auto &part : found) {
+            result.insert(result.end(), part.begin(), part.end());
+        }
+        return result;
+    }
+}
@@ -0,0 +1,1114 @@
+/**
+ * Mozart++ Template Library: String
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#pragma once
+
+#include <mozart++/core>
+#include <mozart++/string>
+#include "simd.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mpp_impl {
+    /**
+     * The largest count of a {n,m} repetition.
+     */
+    static constexpr int pattern_max_repeat = 1000;
+
+    /**
+     * The most NFA states a pattern compiles to, counted repetitions
+     * being expanded.
+     */
+    static constexpr size_t pattern_max_states = 100000;
+
+    /**
+     * The most DFA states kept per pattern: past it the cache is dropped
+     * and built again from the current state, which keeps the memory
+     * bounded and the matching linear.
+     */
+    static constexpr size_t pattern_dfa_cache_states = 4096;
+
+    struct byte_set {
+        std::uint64_t words[4] = {0, 0, 0, 0};
+
+        bool test(unsigned char c) const {
+            return (words[c >> 6] >> (c & 63)) & 1;
+        }
+
+        void set(unsigned char c) {
+            words[c >> 6] |= std::uint64_t(1) << (c & 63);
+        }
+
+        void set_range(unsigned char lo, unsigned char hi) {
+            for (unsigned c = lo; c <= hi; ++c) {
+                set(static_cast<unsigned char>(c));
+            }
+        }
+
+        void merge(const byte_set &other) {
+            for (int i = 0; i < 4; ++i) {
+                words[i] |= other.words[i];
+            }
+        }
+
+        void invert() {
+            for (auto &word : words) {
+                word = ~word;
+            }
+        }
+
+        /**
+         * Add the other case of every ASCII letter in the set.
+         */
+        void fold_case() {
+            for (unsigned c = 'a'; c <= 'z'; ++c) {
+                if (test(static_cast<unsigned char>(c)) || test(static_cast<unsigned char>(c - 32))) {
+                    set(static_cast<unsigned char>(c));
+                    set(static_cast<unsigned char>(c - 32));
+                }
+            }
+        }
+
+        /**
+         * @return the only byte in the set, or -1
+         */
+        int single() const {
+            int found = -1;
+            for (int i = 0; i < 4; ++i) {
+                if (words[i] == 0) {
+                    continue;
+                }
+                if (found >= 0 || popcount64(words[i]) != 1) {
+                    return -1;
+                }
+                auto low = static_cast<std::uint32_t>(words[i]);
+                found = i * 64 + static_cast<int>(low != 0 ? ctz32(low)
+                                                           : 32 + ctz32(static_cast<std::uint32_t>(words[i] >> 32)));
+            }
+            return found;
+        }
+    };
+
+    struct pattern_node {
+        enum class kind {
+            empty, bytes, concat, alternate, repeat, begin_text, end_text
+        };
+
+        kind type;
+        int set = -1;
+        std::vector<int> children;
+        // repeat: max < 0 for no limit
+        int min = 0;
+        int max = -1;
+        bool greedy = true;
+
+        explicit pattern_node(kind t) : type(t) {}
+    };
+
+    /**
+     * Recursive descent parser of the pattern syntax into a tree of
+     * pattern_nodes, held in a vector and linked by index.
+     */
+    class pattern_parser {
+    private:
+        std::vector<pattern_node> &_nodes;
+        std::vector<byte_set> &_sets;
+        const char *_begin;
+        const char *_cur;
+        const char *_end;
+        bool _ignore_case;
+
+        [[noreturn]] void fail(const char *what) const {
+            mpp::throw_ex<mpp::runtime_error>(std::string("pattern: ") + what + " at offset "
+                                              + std::to_string(_cur - _begin));
+        }
+
+        bool at(char c) const {
+            return _cur != _end && *_cur == c;
+        }
+
+        int add(pattern_node node) {
+            _nodes.push_back(std::move(node));
+            return static_cast<int>(_nodes.size() - 1);
+        }
+
+        int add_bytes(byte_set set) {
+            if (_ignore_case) {
+                set.fold_case();
+            }
+            _sets.push_back(set);
+            pattern_node node(pattern_node::kind::bytes);
+            node.set = static_cast<int>(_sets.size() - 1);
+            return add(std::move(node));
+        }
+
+        static byte_set word_bytes() {
+            byte_set set;
+            set.set_range('a', 'z');
+            set.set_range('A', 'Z');
+            set.set_range('0', '9');
+            set.set('_');
+            return set;
+        }
+
+        static byte_set space_bytes() {
+            byte_set set;
+            for (char c : {' ', '\t', '\n', '\r', '\f', '\v'}) {
+                set.set(static_cast<unsigned char>(c));
+            }
+            return set;
+        }
+
+        int hex_digit() {
+            if (_cur == _end) {
+                fail("bad \\x escape");
+            }
+            char c = *_cur++;
+            if (c >= '0' && c <= '9') {
+                return c - '0';
+            }
+            if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+                return (c | 0x20) - 'a' + 10;
+            }
+            fail("bad \\x escape");
+        }
+
+        /**
+         * The bytes an escape stands for, the backslash being consumed.
+         */
+        byte_set parse_escape(bool in_class) {
+            if (_cur == _end) {
+                fail("trailing backslash");
+            }
+            char c = *_cur++;
+            byte_set set;
+            switch (c) {
+                case 'd':
+                case 'D':
+                    set.set_range('0', '9');
+                    break;
+                case 'w':
+                case 'W':
+                    set = word_bytes();
+                    break;
+                case 's':
+                case 'S':
+                    set = space_bytes();
+                    break;
+                case 'n':
+                    set.set('\n');
+                    return set;
+                case 'r':
+                    set.set('\r');
+                    return set;
+                case 't':
+                    set.set('\t');
+                    return set;
+                case 'f':
+                    set.set('\f');
+                    return set;
+                case 'v':
+                    set.set('\v');
+                    return set;
+                case '0':
+                    set.set(0);
+                    return set;
+                case 'x': {
+                    int high = hex_digit();
+                    set.set(static_cast<unsigned char>(high * 16 + hex_digit()));
+                    return set;
+                }
+                case 'b':
+                    if (in_class) {
+                        set.set('\b');
+                        return set;
+                    }
+                    fail("word boundaries are not supported");
+                default:
+                    if (c >= '1' && c <= '9') {
+                        fail("backreferences are not supported");
+                    }
+                    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+                        fail("unknown escape");
+                    }
+                    set.set(static_cast<unsigned char>(c));
+                    return set;
+            }
+            if (c >= 'A' && c <= 'Z') {
+                set.invert();
+            }
+            return set;
+        }
+
+        int parse_class() {
+            byte_set set;
+            bool negate = at('^');
+            if (negate) {
+                ++_cur;
+            }
+            while (!at(']')) {
+                if (_cur == _end) {
+                    fail("missing ]");
+                }
+                int lo;
+                if (*_cur == '\\') {
+                    ++_cur;
+                    byte_set escaped = parse_escape(true);
+                    lo = escaped.single();
+                    if (lo < 0) {
+                        set.merge(escaped);
+                        continue;
+                    }
+                } else {
+                    lo = static_cast<unsigned char>(*_cur++);
+                }
+                if (at('-') && _cur + 1 != _end && _cur[1] != ']') {
+                    ++_cur;
+                    int hi;
+                    if (*_cur == '\\') {
+                        ++_cur;
+                        hi = parse_escape(true).single();
+                        if (hi < 0) {
+                            fail("bad class range");
+                        }
+                    } else {
+                        hi = static_cast<unsigned char>(*_cur++);
+                    }
+                    if (hi < lo) {
+                        fail("bad class range");
+                    }
+                    set.set_range(static_cast<unsigned char>(lo), static_cast<unsigned char>(hi));
+                } else {
+                    set.set(static_cast<unsigned char>(lo));
+                }
+            }
+            ++_cur;
+            if (_ignore_case) {
+                set.fold_case();
+            }
+            if (negate) {
+                set.invert();
+            }
+            _sets.push_back(set);
+            pattern_node node(pattern_node::kind::bytes);
+            node.set = static_cast<int>(_sets.size() - 1);
+            return add(std::move(node));
+        }
+
+        int parse_atom() {
+            char c = *_cur++;
+            byte_set set;
+            switch (c) {
+                case '(': {
+                    if (at('?')) {
+                        if (_cur + 1 == _end || _cur[1] != ':') {
+                            fail("only (?: groups are supported");
+                        }
+                        _cur += 2;
+                    }
+                    int inner = parse_alternate();
+                    if (!at(')')) {
+                        fail("missing )");
+                    }
+                    ++_cur;
+                    return inner;
+                }
+                case '[':
+                    return parse_class();
+                case '.':
+                    set.set('\n');
+                    set.set('\r');
+                    set.invert();
+                    return add_bytes(set);
+                case '^':
+                    return add(pattern_node(pattern_node::kind::begin_text));
+                case '$':
+                    return add(pattern_node(pattern_node::kind::end_text));
+                case '*':
+                case '+':
+                case '?':
+                case '{':
+                    --_cur;
+                    fail("nothing to repeat");
+                case '\\':
+                    return add_bytes(parse_escape(false));
+                default:
+                    set.set(static_cast<unsigned char>(c));
+                    return add_bytes(set);
+            }
+        }
+
+        int parse_count() {
+            int n = 0;
+            if (_cur == _end || *_cur < '0' || *_cur > '9') {
+                fail("bad repeat count");
+            }
+            while (_cur != _end && *_cur >= '0' && *_cur <= '9') {
+                n = n * 10 + (*_cur++ - '0');
+                if (n > pattern_max_repeat) {
+                    fail("repeat count too large");
+                }
+            }
+            return n;
+        }
+
+        int parse_repeat() {
+            bool group = at('(');
+            int atom = parse_atom();
+            if (_cur == _end) {
+                return atom;
+            }
+            pattern_node node(pattern_node::kind::repeat);
+            switch (*_cur) {
+                case '*':
+                    node.min = 0;
+                    node.max = -1;
+                    ++_cur;
+                    break;
+                case '+':
+                    node.min = 1;
+                    node.max = -1;
+                    ++_cur;
+                    break;
+                case '?':
+                    node.min = 0;
+                    node.max = 1;
+                    ++_cur;
+                    break;
+                case '{':
+                    ++_cur;
+                    node.min = parse_count();
+                    node.max = node.min;
+                    if (at(',')) {
+                        ++_cur;
+                        node.max = at('}') ? -1 : parse_count();
+                    }
+                    if (!at('}') || (node.max >= 0 && node.max < node.min)) {
+                        fail("bad repeat count");
+                    }
+                    ++_cur;
+                    break;
+                default:
+                    return atom;
+            }
+            if (!group && (_nodes[atom].type == pattern_node::kind::begin_text
+                           || _nodes[atom].type == pattern_node::kind::end_text)) {
+                fail("nothing to repeat");
+            }
+            if (at('?')) {
+                node.greedy = false;
+                ++_cur;
+            }
+            if (at('*') || at('+') || at('?') || at('{')) {
+                fail("nothing to repeat");
+            }
+            node.children.push_back(atom);
+            return add(std::move(node));
+        }
+
+        int parse_concat() {
+            pattern_node node(pattern_node::kind::concat);
+            while (_cur != _end && *_cur != '|' && *_cur != ')') {
+                node.children.push_back(parse_repeat());
+            }
+            if (node.children.size() == 1) {
+                return node.children.front();
+            }
+            if (node.children.empty()) {
+                return add(pattern_node(pattern_node::kind::empty));
+            }
+            return add(std::move(node));
+        }
+
+        int parse_alternate() {
+            int first = parse_concat();
+            if (!at('|')) {
+                return first;
+            }
+            pattern_node node(pattern_node::kind::alternate);
+            node.children.push_back(first);
+            while (at('|')) {
+                ++_cur;
+                node.children.push_back(parse_concat());
+            }
+            return add(std::move(node));
+        }
+
+    public:
+        pattern_parser(std::vector<pattern_node> &nodes, std::vector<byte_set> &sets, mpp::string_ref source,
+                       bool ignore_case)
+                : _nodes(nodes), _sets(sets), _begin(source.data()), _cur(source.data()),
+                  _end(source.data() + source.size()), _ignore_case(ignore_case) {}
+
+        /**
+         * @return the root node
+         */
+        int parse() {
+            int root = parse_alternate();
+            if (_cur != _end) {
+                fail("unmatched )");
+            }
+            return root;
+        }
+    };
+
+    struct nfa_state {
+        enum class kind : std::uint8_t {
+            bytes, split, match, begin_text, end_text
+        };
+
+        kind type;
+        // bytes: on a byte of the set; split: both, out first
+        int out = -1;
+        int out1 = -1;
+        int set = -1;
+    };
+
+    /**
+     * Thompson's construction of the node tree, or of its reverse (the
+     * language of the reversed strings) for finding where matches start.
+     * Nodes are compiled back to front, each given the state it continues
+     * with.
+     */
+    class pattern_nfa {
+    private:
+        const std::vector<pattern_node> *_nodes = nullptr;
+        bool _reverse = false;
+
+        int add(nfa_state::kind type, int out = -1, int out1 = -1, int set = -1) {
+            if (states.size() >= pattern_max_states) {
+                mpp::throw_ex<mpp::runtime_error>("pattern: too large");
+            }
+            states.push_back(nfa_state{type, out, out1, set});
+            return static_cast<int>(states.size() - 1);
+        }
+
+        int compile(int index, int next) {
+            const pattern_node &node = (*_nodes)[index];
+            switch (node.type) {
+                case pattern_node::kind::empty:
+                    return next;
+                case pattern_node::kind::bytes:
+                    return add(nfa_state::kind::bytes, next, -1, node.set);
+                case pattern_node::kind::begin_text:
+                    return add(_reverse ? nfa_state::kind::end_text : nfa_state::kind::begin_text, next);
+                case pattern_node::kind::end_text:
+                    return add(_reverse ? nfa_state::kind::begin_text : nfa_state::kind::end_text, next);
+                case pattern_node::kind::concat:
+                    if (_reverse) {
+                        for (int child : node.children) {
+                            next = compile(child, next);
+                        }
+                    } else {
+                        for (size_t i = node.children.size(); i-- > 0;) {
+                            next = compile(node.children[i], next);
+                        }
+                    }
+                    return next;
+                case pattern_node::kind::alternate: {
+                    int entry = compile(node.children.back(), next);
+                    for (size_t i = node.children.size() - 1; i-- > 0;) {
+                        int first = compile(node.children[i], next);
+                        entry = add(nfa_state::kind::split, first, entry);
+                    }
+                    return entry;
+                }
+                case pattern_node::kind::repeat: {
+                    int child = node.children.front();
+                    int entry = next;
+                    if (node.max < 0) {
+                        int loop = add(nfa_state::kind::split);
+                        int body = compile(child, loop);
+                        states[loop].out = node.greedy ? body : next;
+                        states[loop].out1 = node.greedy ? next : body;
+                        entry = loop;
+                    } else {
+                        // the optional copies, each one skipping to the end
+                        for (int i = node.min; i < node.max; ++i) {
+                            int body = compile(child, entry);
+                            entry = node.greedy ? add(nfa_state::kind::split, body, next)
+                                                : add(nfa_state::kind::split, next, body);
+                        }
+                    }
+                    for (int i = 0; i < node.min; ++i) {
+                        entry = compile(child, entry);
+                    }
+                    return entry;
+                }
+            }
+            return next;
+        }
+
+    public:
+        std::vector<nfa_state> states;
+        int start = -1;
+
+        void build(const std::vector<pattern_node> &nodes, int root, bool reverse) {
+            _nodes = &nodes;
+            _reverse = reverse;
+            int match = add(nfa_state::kind::match);
+            start = compile(root, match);
+            _nodes = nullptr;
+        }
+    };
+
+    /**
+     * What a pattern compiles to, shared by its copies.
+     */
+    struct pattern_program {
+        std::string source;
+        std::vector<byte_set> sets;
+        pattern_nfa forward;
+        pattern_nfa reverse;
+        // bytes no set tells apart share a class, and a DFA transition
+        std::uint8_t class_of[256];
+        std::uint8_t representative[256];
+        size_t classes = 0;
+        // every match starts with the prefix
+        std::string prefix;
+        // the pattern is the prefix, and nothing else
+        bool literal = false;
+
+        pattern_program(mpp::string_ref pattern, bool ignore_case) : source(pattern.str()) {
+            std::vector<pattern_node> nodes;
+            int root = pattern_parser(nodes, sets, pattern, ignore_case).parse();
+            forward.build(nodes, root, false);
+            reverse.build(nodes, root, true);
+
+            bool boundary[256] = {false};
+            for (const byte_set &set : sets) {
+                for (unsigned c = 1; c < 256; ++c) {
+                    boundary[c] = boundary[c] || set.test(static_cast<unsigned char>(c)) != set.test(
+                            static_cast<unsigned char>(c - 1));
+                }
+            }
+            class_of[0] = 0;
+            representative[0] = 0;
+            for (unsigned c = 1; c < 256; ++c) {
+                class_of[c] = static_cast<std::uint8_t>(class_of[c - 1] + boundary[c]);
+                representative[class_of[c]] = static_cast<std::uint8_t>(c);
+            }
+            classes = class_of[255] + 1u;
+
+            bool assertions = false;
+            literal = append_literal(nodes, root, assertions) && !assertions;
+        }
+
+    private:
+        /**
+         * Append what every match of a node starts with to the prefix.
+         *
+         * @return whether the node is all literal
+         */
+        bool append_literal(const std::vector<pattern_node> &nodes, int index, bool &assertions) {
+            const pattern_node &node = nodes[index];
+            switch (node.type) {
+                case pattern_node::kind::empty:
+                    return true;
+                case pattern_node::kind::begin_text:
+                case pattern_node::kind::end_text:
+                    assertions = true;
+                    return true;
+                case pattern_node::kind::bytes: {
+                    int c = sets[node.set].single();
+                    if (c < 0) {
+                        return false;
+                    }
+                    prefix += static_cast<char>(c);
+                    return true;
+                }
+                case pattern_node::kind::concat:
+                    for (int child : node.children) {
+                        if (!append_literal(nodes, child, assertions)) {
+                            return false;
+                        }
+                    }
+                    return true;
+                case pattern_node::kind::repeat:
+                    for (int i = 0; i < node.min; ++i) {
+                        if (!append_literal(nodes, node.children.front(), assertions)) {
+                            return false;
+                        }
+                    }
+                    return node.min == node.max;
+                default:
+                    return false;
+            }
+        }
+    };
+
+    /**
+     * A DFA built from an NFA while matching: each DFA state is an
+     * ordered set of NFA states, made on the first visit of each
+     * transition and cached.
+     *
+     * The order of the set is the priority of the threads. Searches stop
+     * following threads of lower priority than a match, which gives the
+     * leftmost-first matches of backtracking engines, while `longest`
+     * DFAs keep all of them. Unanchored DFAs start a new thread after
+     * every byte, until something matched.
+     */
+    class pattern_dfa {
+    private:
+        enum : std::uint8_t {
+            dead = 1, matching = 2, matching_at_end = 4, start_state = 8, restart = 16, at_edge = 32
+        };
+
+        const pattern_program *_program;
+        const pattern_nfa *_nfa;
+        bool _longest;
+        std::vector<std::vector<int>> _lists;
+        std::vector<std::uint8_t> _flags;
+        std::vector<int> _table;
+        std::unordered_map<std::string, int> _ids;
+        int _start[2] = {-1, -1};
+        size_t _flushes = 0;
+        // the threads a restart adds
+        std::vector<int> _start_list;
+        std::vector<unsigned> _marks;
+        unsigned _generation = 0;
+        std::vector<int> _stack;
+
+        void next_generation() {
+            if (++_generation == 0) {
+                std::fill(_marks.begin(), _marks.end(), 0);
+                _generation = 1;
+            }
+        }
+
+        /**
+         * Add the states reached from state without consuming a byte, in
+         * priority order.
+         *
+         * @return whether the match state was reached
+         */
+        bool closure(std::vector<int> &list, int state, bool begin_ok, bool end_ok) {
+            bool matched = false;
+            _stack.push_back(state);
+            while (!_stack.empty()) {
+                int id = _stack.back();
+                _stack.pop_back();
+                if (_marks[id] == _generation) {
+                    continue;
+                }
+                _marks[id] = _generation;
+                const nfa_state &s = _nfa->states[id];
+                switch (s.type) {
+                    case nfa_state::kind::split:
+                        _stack.push_back(s.out1);
+                        _stack.push_back(s.out);
+                        break;
+                    case nfa_state::kind::begin_text:
+                        if (begin_ok) {
+                            _stack.push_back(s.out);
+                        }
+                        break;
+                    case nfa_state::kind::end_text:
+                        if (end_ok) {
+                            _stack.push_back(s.out);
+                        } else {
+                            // decided at the end of the text
+                            list.push_back(id);
+                        }
+                        break;
+                    case nfa_state::kind::bytes:
+                        list.push_back(id);
+                        break;
+                    case nfa_state::kind::match:
+                        list.push_back(id);
+                        matched = true;
+                        if (!_longest) {
+                            _stack.clear();
+                        }
+                        break;
+                }
+            }
+            return matched;
+        }
+
+        bool matches_at_end(const std::vector<int> &list, bool begin_ok) {
+            next_generation();
+            std::vector<int> scratch;
+            for (int id : list) {
+                const nfa_state &s = _nfa->states[id];
+                if (s.type == nfa_state::kind::match
+                    || (s.type == nfa_state::kind::end_text && closure(scratch, s.out, begin_ok, true))) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void flush() {
+            _lists.clear();
+            _flags.clear();
+            _table.clear();
+            _ids.clear();
+            _start[0] = _start[1] = -1;
+            ++_flushes;
+        }
+
+        int intern(std::vector<int> list, std::uint8_t mode) {
+            std::string key(1, static_cast<char>(mode));
+            key.append(reinterpret_cast<const char *>(list.data()), list.size() * sizeof(int));
+            auto it = _ids.find(key);
+            if (it != _ids.end()) {
+                return it->second;
+            }
+            if (_lists.size() >= pattern_dfa_cache_states) {
+                flush();
+            }
+            std::uint8_t flags = mode;
+            for (int id : list) {
+                if (_nfa->states[id].type == nfa_state::kind::match) {
+                    flags |= matching;
+                }
+            }
+            if (list.empty() && !(mode & restart)) {
+                flags |= dead;
+            }
+            if (matches_at_end(list, mode & at_edge)) {
+                flags |= matching_at_end;
+            }
+            if (mode == restart && list == _start_list) {
+                flags |= start_state;
+            }
+            int id = static_cast<int>(_lists.size());
+            _ids.emplace(std::move(key), id);
+            _lists.push_back(std::move(list));
+            _flags.push_back(flags);
+            _table.resize(_table.size() + _program->classes, -1);
+            return id;
+        }
+
+        int step(int from, unsigned cls) {
+            unsigned char byte = _program->representative[cls];
+            std::uint8_t mode = _flags[from];
+            std::vector<int> list;
+            bool matched = false;
+            next_generation();
+            for (int id : _lists[from]) {
+                const nfa_state &s = _nfa->states[id];
+                if (s.type == nfa_state::kind::bytes && _program->sets[s.set].test(byte)
+                    && closure(list, s.out, false, false)) {
+                    matched = true;
+                    if (!_longest) {
+                        // the threads after a match have lost to it
+                        break;
+                    }
+                }
+            }
+            if ((mode & restart) && !matched) {
+                matched = closure(list, _nfa->start, false, false);
+            }
+            size_t flushes = _flushes;
+            int id = intern(std::move(list), (mode & restart) && !matched ? restart : 0);
+            if (flushes == _flushes) {
+                _table[from * _program->classes + cls] = id;
+            }
+            return id;
+        }
+
+        int next_state(int state, unsigned char byte) {
+            unsigned cls = _program->class_of[byte];
+            int next = _table[state * _program->classes + cls];
+            return next >= 0 ? next : step(state, cls);
+        }
+
+        int start(bool at_text_edge, bool unanchored) {
+            int &cached = _start[at_text_edge];
+            if (cached < 0) {
+                next_generation();
+                std::vector<int> list;
+                bool matched = closure(list, _nfa->start, at_text_edge, false);
+                std::uint8_t mode = at_text_edge ? at_edge : 0;
+                if (unanchored && !matched && !_start_list.empty()) {
+                    mode |= restart;
+                }
+                int id = intern(std::move(list), mode);
+                cached = id;
+            }
+            return cached;
+        }
+
+    public:
+        pattern_dfa(const pattern_program &program, const pattern_nfa &nfa, bool longest)
+                : _program(&program), _nfa(&nfa), _longest(longest), _marks(nfa.states.size(), 0) {
+            next_generation();
+            closure(_start_list, _nfa->start, false, false);
+        }
+
+        /**
+         * Search text from a position, leftmost-first, jumping to the next
+         * occurrence of the prefix whenever no thread is alive.
+         *
+         * @param first stop at the first match state, for a yes or no answer
+         * @return where the match ends, or npos
+         */
+        size_t search(mpp::string_ref text, size_t from, mpp::string_ref prefix, bool first) {
+            const auto *bytes = reinterpret_cast<const unsigned char *>(text.data());
+            size_t n = text.size();
+            int state = start(from == 0, true);
+            size_t last = mpp::string_ref::npos;
+            if (_flags[state] & matching) {
+                last = from;
+                if (first) {
+                    return last;
+                }
+            }
+            for (size_t i = from; i < n; ++i) {
+                if ((_flags[state] & start_state) && !prefix.empty()) {
+                    i = text.find(prefix, i);
+                    if (i == mpp::string_ref::npos) {
+                        return last;
+                    }
+                }
+                state = next_state(state, bytes[i]);
+                std::uint8_t flags = _flags[state];
+                if (flags & (dead | matching)) {
+                    if (flags & dead) {
+                        return last;
+                    }
+                    last = i + 1;
+                    if (first) {
+                        return last;
+                    }
+                }
+            }
+            if (_flags[state] & matching_at_end) {
+                last = n;
+            }
+            return last;
+        }
+
+        /**
+         * Run a reverse DFA back from the end of a match to find where it
+         * starts: the smallest position not before from.
+         */
+        size_t search_back(mpp::string_ref text, size_t end, size_t from) {
+            const auto *bytes = reinterpret_cast<const unsigned char *>(text.data());
+            int state = start(end == text.size(), false);
+            size_t last = (_flags[state] & matching) ? end : mpp::string_ref::npos;
+            size_t i = end;
+            for (; i > from; --i) {
+                state = next_state(state, bytes[i - 1]);
+                if (_flags[state] & dead) {
+                    return last;
+                }
+                if (_flags[state] & matching) {
+                    last = i - 1;
+                }
+            }
+            if (i == 0 && (_flags[state] & matching_at_end)) {
+                last = 0;
+            }
+            return last;
+        }
+
+        /**
+         * Whether all of text matches.
+         */
+        bool match(mpp::string_ref text) {
+            const auto *bytes = reinterpret_cast<const unsigned char *>(text.data());
+            int state = start(true, false);
+            for (size_t i = 0; i < text.size(); ++i) {
+                state = next_state(state, bytes[i]);
+                if (_flags[state] & dead) {
+                    return false;
+                }
+            }
+            return (_flags[state] & matching_at_end) != 0;
+        }
+    };
+
+    /**
+     * The DFAs of a pattern, built as it is used.
+     */
+    struct pattern_cache {
+        std::mutex lock;
+        pattern_dfa search;
+        pattern_dfa match;
+        pattern_dfa reverse;
+
+        explicit pattern_cache(const pattern_program &program)
+                : search(program, program.forward, false),
+                  match(program, program.forward, true),
+                  reverse(program, program.reverse, true) {}
+    };
+}
+
+namespace mpp {
+    struct pattern_match {
+        size_t position = string_ref::npos;
+        size_t length = 0;
+
+        bool found() const { return position != string_ref::npos; }
+
+        explicit operator bool() const { return found(); }
+    };
+
+    /**
+     * A compiled regular expression: match(), contains() and search()
+     * run in time linear in the text, find_all() may not (see there).
+     *
+     * The syntax is the common subset of ECMAScript and POSIX: literals,
+     * `.` (any byte but '\n' and '\r'), classes `[a-z]` `[^...]`, the escapes
+     * `\d \w \s \D \W \S \n \r \t \f \v \0 \xHH`, groups `(...)` and
+     * `(?:...)`, `|`, the quantifiers `* + ? {n} {n,} {n,m}` and their
+     * lazy forms, and `^` `$` for the ends of the text. Matching is on
+     * bytes, so UTF-8 literals work but `.` takes one byte. Groups do not
+     * capture; there are no backreferences, lookarounds nor `\b`, which
+     * cannot run in linear time, and using them throws.
+     *
+     * Matches are the ones std::regex finds: the leftmost, and among those
+     * the one a backtracking engine would try first.
+     *
+     * The search runs a DFA built lazily from the Thompson NFA of the
+     * pattern, one cached transition per byte. When every match starts
+     * with some literal, string_ref::find() skips to its occurrences; a
+     * pattern that is only a literal is just a find(). A pattern may be
+     * used from several threads, which share its DFA cache under a lock:
+     * copies have caches of their own.
+     */
+    class pattern {
+    private:
+        std::shared_ptr<const mpp_impl::pattern_program> _program;
+        mutable std::unique_ptr<mpp_impl::pattern_cache> _cache;
+
+        pattern_match search_locked(string_ref text, size_t from) const {
+            if (!_program->prefix.empty()) {
+                from = text.find(_program->prefix, from);
+                if (from == string_ref::npos) {
+                    return {};
+                }
+            }
+            if (_program->literal) {
+                return {from, _program->prefix.size()};
+            }
+            size_t end = _cache->search.search(text, from, _program->prefix, false);
+            if (end == string_ref::npos) {
+                return {};
+            }
+            size_t begin = _cache->reverse.search_back(text, end, from);
+            return {begin, end - begin};
+        }
+
+    public:
+        /**
+         * Compile a pattern.
+         *
+         * @param source
+         * @param ignore_case match ASCII letters of either case
+         * @throw mpp::runtime_error on a syntax error, or a pattern too large
+         */
+        explicit pattern(string_ref source, bool ignore_case = false)
+                : _program(std::make_shared<const mpp_impl::pattern_program>(source, ignore_case)),
+                  _cache(new mpp_impl::pattern_cache(*_program)) {}
+
+        pattern(const pattern &other)
+                : _program(other._program), _cache(new mpp_impl::pattern_cache(*_program)) {}
+
+        pattern(pattern &&other) noexcept = default;
+
+        pattern &operator=(const pattern &other) {
+            if (this != &other) {
+                _program = other._program;
+                _cache.reset(new mpp_impl::pattern_cache(*_program));
+            }
+            return *this;
+        }
+
+        pattern &operator=(pattern &&other) noexcept = default;
+
+        const std::string &source() const { return _program->source; }
+
+        /**
+         * Whether all of text matches.
+         *
+         * @param text
+         * @return
+         */
+        bool match(string_ref text) const {
+            if (_program->literal) {
+                return text.equals(_program->prefix);
+            }
+            std::lock_guard<std::mutex> guard(_cache->lock);
+            return _cache->match.match(text);
+        }
+
+        /**
+         * Whether some part of text matches, without working out where.
+         */
+        bool contains(string_ref text) const {
+            size_t from = text.find(_program->prefix);
+            if (from == string_ref::npos || _program->literal) {
+                return from != string_ref::npos;
+            }
+            std::lock_guard<std::mutex> guard(_cache->lock);
+            return _cache->search.search(text, from, _program->prefix, true) != string_ref::npos;
+        }
+
+        /**
+         * Find the first match in text, starting at a position.
+         *
+         * @param text
+         * @param from
+         * @return the match, or one that is not found()
+         */
+        pattern_match search(string_ref text, size_t from = 0) const {
+            if (from > text.size()) {
+                return {};
+            }
+            if (_program->literal) {
+                return search_locked(text, from);
+            }
+            std::lock_guard<std::mutex> guard(_cache->lock);
+            return search_locked(text, from);
+        }
+
+        /**
+         * Append every match in text, left to right and not overlapping, to
+         * a vector. After an empty match the search goes on a byte further.
+         *
+         * Each match is one search(), which may read past the end of the
+         * match to rule out another one the pattern prefers, and the next
+         * search reads those bytes again: the worst case is O(n^2), e.g.
+         * `a+b|a` or `a*?b|a` over a long run of a's, which look for a 'b'
+         * to the end of the text at every match.
+         *
+         * @param text
+         * @param out
+         */
+        template <typename Alloc>
+        void find_all(string_ref text, std::vector<string_ref, Alloc> &out) const {
+            std::unique_lock<std::mutex> guard(_cache->lock, std::defer_lock);
+            if (!_program->literal) {
+                guard.lock();
+            }
+            for (size_t from = 0; from <= text.size();) {
+                pattern_match found = search_locked(text, from);
+                if (!found) {
+                    break;
+                }
+                out.push_back(text.substr(found.position, found.length));
+                from = found.position + std::max<size_t>(found.length, 1);
+            }
+        }
+
+        std::vector<string_ref> find_all(string_ref text) const {
+            std::vector<string_ref> result;
+            find_all(text, result);
+            return result;
+        }
+    };
+}
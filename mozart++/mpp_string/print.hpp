@@ -0,0 +1,347 @@
+/**
+ * Mozart++ Template Library: String
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#pragma once
+
+#include <mozart++/core>
+#include <mozart++/string>
+#include "format.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef MOZART_PLATFORM_UNIX
+#include <sys/uio.h>
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+namespace mpp {
+    /**
+     * When mpp::print() hands buffered output to the operating system.
+     */
+    enum class flush_policy {
+        /**
+         * line for terminals, full for pipes and files, like stdio.
+         */
+        automatic,
+        /**
+         * After every print() that writes a newline.
+         */
+        line,
+        /**
+         * Only when the buffer is full, on print_flush() and at thread exit.
+         */
+        full,
+        /**
+         * After every print().
+         */
+        always,
+    };
+
+    struct print_options {
+        flush_policy flush = flush_policy::automatic;
+        /**
+         * Size of the per-thread buffer.
+         */
+        size_t buffer_size = 64 * 1024;
+    };
+}
+
+namespace mpp_impl {
+    /**
+     * Write a gather list completely, retrying on partial writes.
+     *
+     * @return false on error, with errno set
+     */
+    inline bool write_fully(int fd, const char *first, size_t first_size, const char *second, size_t second_size) {
+#ifdef MOZART_PLATFORM_UNIX
+        struct iovec iov[2] = {{const_cast<char *>(first), first_size},
+                               {const_cast<char *>(second), second_size}};
+        struct iovec *cursor = first_size != 0 ? iov : iov + 1;
+        int count = first_size != 0 ? 2 : 1;
+        while (count != 0) {
+            ssize_t written = ::writev(fd, cursor, count);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            auto left = static_cast<size_t>(written);
+            while (count != 0 && left >= cursor->iov_len) {
+                left -= cursor->iov_len;
+                ++cursor;
+                --count;
+            }
+            if (count != 0) {
+                cursor->iov_base = static_cast<char *>(cursor->iov_base) + left;
+                cursor->iov_len -= left;
+            }
+        }
+        return true;
+#else
+        for (auto piece : {std::make_pair(first, first_size), std::make_pair(second, second_size)}) {
+            while (piece.second != 0) {
+                int written = ::_write(fd, piece.first, static_cast<unsigned>(piece.second));
+                if (written < 0) {
+                    return false;
+                }
+                piece.first += written;
+                piece.second -= static_cast<size_t>(written);
+            }
+        }
+        return true;
+#endif
+    }
+
+    inline bool is_terminal(int fd) {
+#ifdef MOZART_PLATFORM_UNIX
+        return ::isatty(fd) != 0;
+#else
+        return ::_isatty(fd) != 0;
+#endif
+    }
+
+    /**
+     * The per-thread output buffer behind mpp::print(), exposed to the
+     * formatter as a std::ostream over a stream buffer of our own, so that
+     * output is not synchronized with stdio nor copied through a
+     * stringstream.
+     *
+     * Output for one fd accumulates until the flush policy says otherwise,
+     * or a print() to another fd comes along.
+     */
+    class print_buffer : public std::streambuf {
+    private:
+        mpp::print_options _options;
+        std::vector<char> _data;
+        int _fd = -1;
+        bool _line_buffered = false;
+        // where the output of the current print() starts in the buffer
+        size_t _message_start = 0;
+        std::ostream _stream;
+
+        size_t pending() const {
+            return static_cast<size_t>(pptr() - pbase());
+        }
+
+        void reset_put_area() {
+            setp(_data.data(), _data.data() + _data.size());
+        }
+
+        static void write_failed(int error) {
+            mpp::throw_ex<mpp::runtime_error>(std::string("print: write failed: ") + std::strerror(error));
+        }
+
+        void write_out(const char *extra, size_t extra_size) {
+            bool ok = mpp_impl::write_fully(_fd, pbase(), pending(), extra, extra_size);
+            int error = errno;
+            reset_put_area();
+            _message_start = 0;
+            if (!ok) {
+                write_failed(error);
+            }
+        }
+
+    protected:
+        int_type overflow(int_type c) override {
+            if (_message_start != 0) {
+                // keep the current print() in one piece: write out what precedes it
+                size_t rest = pending() - _message_start;
+                bool ok = mpp_impl::write_fully(_fd, pbase(), _message_start, nullptr, 0);
+                int error = errno;
+                std::memmove(_data.data(), _data.data() + _message_start, rest);
+                reset_put_area();
+                pbump(static_cast<int>(rest));
+                _message_start = 0;
+                if (!ok) {
+                    write_failed(error);
+                }
+            }
+            if (pptr() == epptr()) {
+                // a single print() longer than the buffer
+                write_out(nullptr, 0);
+            }
+            if (!traits_type::eq_int_type(c, traits_type::eof())) {
+                *pptr() = traits_type::to_char_type(c);
+                pbump(1);
+            }
+            return traits_type::not_eof(c);
+        }
+
+        std::streamsize xsputn(const char *s, std::streamsize n) override {
+            auto size = static_cast<size_t>(n);
+            if (size > _data.size() / 2) {
+                // pass large strings straight to writev() along with the buffer
+                write_out(s, size);
+                return n;
+            }
+            return std::streambuf::xsputn(s, n);
+        }
+
+        int sync() override {
+            if (pending() != 0) {
+                write_out(nullptr, 0);
+            }
+            return 0;
+        }
+
+    public:
+        print_buffer() : _data(_options.buffer_size), _stream(this) {
+            reset_put_area();
+            // let write errors thrown from the stream buffer reach the caller
+            _stream.exceptions(std::ios::badbit);
+        }
+
+        print_buffer(const print_buffer &) = delete;
+        print_buffer &operator=(const print_buffer &) = delete;
+
+        ~print_buffer() override {
+            try {
+                flush();
+            } catch (...) {
+                // nowhere to report it at thread exit
+            }
+        }
+
+        void flush() {
+            if (pending() != 0) {
+                write_out(nullptr, 0);
+            }
+        }
+
+        void configure(const mpp::print_options &options) {
+            flush();
+            _options = options;
+            _data.assign(std::max<size_t>(options.buffer_size, 64), '\0');
+            reset_put_area();
+            _fd = -1;
+        }
+
+        /**
+         * Start a print() to fd, returning the stream to format into.
+         */
+        std::ostream &begin(int fd) {
+            if (fd != _fd) {
+                flush();
+                _fd = fd;
+                _line_buffered = _options.flush == mpp::flush_policy::line
+                                 || (_options.flush == mpp::flush_policy::automatic && is_terminal(fd));
+            }
+            _message_start = pending();
+            // iomanip state leaks from one format() to the next otherwise
+            _stream.clear();
+            _stream.flags(std::ios::dec | std::ios::skipws);
+            _stream.width(0);
+            _stream.precision(6);
+            _stream.fill(' ');
+            return _stream;
+        }
+
+        /**
+         * Finish a print(), flushing as the policy says.
+         */
+        void end() {
+            if (_options.flush == mpp::flush_policy::always) {
+                flush();
+            } else if (_line_buffered && pending() > _message_start
+                       && std::memchr(pbase() + _message_start, '\n', pending() - _message_start) != nullptr) {
+                flush();
+            }
+            _message_start = 0;
+        }
+    };
+
+    inline print_buffer &thread_print_buffer() {
+        static thread_local print_buffer buffer;
+        return buffer;
+    }
+
+    inline int file_descriptor(std::FILE *file) {
+        // what stdio buffered so far goes first
+        std::fflush(file);
+#ifdef MOZART_PLATFORM_UNIX
+        return ::fileno(file);
+#else
+        return ::_fileno(file);
+#endif
+    }
+}
+
+namespace mpp {
+    /**
+     * Format with mpp::format() into a per-thread buffer and write it to a
+     * file descriptor with write()/writev(), without going through
+     * std::cout or stdio.
+     *
+     * Output is batched according to the calling thread's flush policy
+     * (see set_print_options()), and the output of one call is never split
+     * across writes unless it is larger than the buffer. Whatever is still
+     * buffered is written at thread exit; call print_flush() before
+     * handing the fd to other code.
+     *
+     * @param fd
+     * @param fmt
+     * @param args
+     */
+    template <typename ...Args>
+    void print(int fd, const std::string &fmt, Args &&... args) {
+        mpp_impl::print_buffer &buffer = mpp_impl::thread_print_buffer();
+        mpp_impl::format(buffer.begin(fd), fmt, std::forward<Args>(args)...);
+        buffer.end();
+    }
+
+    /**
+     * print() to the descriptor of a stdio stream, after flushing
+     * what stdio has buffered for it.
+     */
+    template <typename ...Args>
+    void print(std::FILE *file, const std::string &fmt, Args &&... args) {
+        print(mpp_impl::file_descriptor(file), fmt, std::forward<Args>(args)...);
+    }
+
+    /**
+     * print() followed by a newline.
+     */
+    template <typename ...Args>
+    void println(int fd, const std::string &fmt, Args &&... args) {
+        mpp_impl::print_buffer &buffer = mpp_impl::thread_print_buffer();
+        std::ostream &out = buffer.begin(fd);
+        mpp_impl::format(out, fmt, std::forward<Args>(args)...);
+        out.put('\n');
+        buffer.end();
+    }
+
+    template <typename ...Args>
+    void println(std::FILE *file, const std::string &fmt, Args &&... args) {
+        println(mpp_impl::file_descriptor(file), fmt, std::forward<Args>(args)...);
+    }
+
+    /**
+     * Write out what the calling thread has buffered.
+     */
+    inline void print_flush() {
+        mpp_impl::thread_print_buffer().flush();
+    }
+
+    /**
+     * Set the flush policy and buffer size of the calling thread,
+     * flushing its buffer first.
+     */
+    inline void set_print_options(const print_options &options) {
+        mpp_impl::thread_print_buffer().configure(options);
+    }
+}
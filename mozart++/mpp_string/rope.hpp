@@ -0,0 +1,497 @@
+/**
+ * Mozart++ Template Library: String
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#pragma once
+
+#include <mozart++/core>
+#include <mozart++/string>
+#include <mozart++/iterator_range>
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mpp_impl {
+    struct rope_node;
+
+    using rope_node_ptr = std::shared_ptr<const rope_node>;
+
+    /**
+     * An immutable rope node, shared between ropes.
+     * A leaf references [offset, offset + length) of a shared buffer,
+     * a concatenation node has both children and height > 0.
+     * Concatenation nodes are kept AVL-balanced by height.
+     */
+    struct rope_node {
+        size_t length = 0;
+        unsigned height = 0;
+
+        std::shared_ptr<const std::string> buffer;
+        size_t offset = 0;
+
+        rope_node_ptr left;
+        rope_node_ptr right;
+
+        bool is_leaf() const { return height == 0; }
+
+        mpp::string_ref leaf_ref() const {
+            return mpp::string_ref{buffer->data() + offset, length};
+        }
+    };
+
+    /**
+     * Adjacent leaves up to this size are merged into one, so that appending
+     * many small pieces does not build a tree of tiny nodes.
+     */
+    static constexpr size_t rope_merge_limit = 512;
+
+    inline unsigned rope_height(const rope_node_ptr &n) {
+        return n ? n->height : 0;
+    }
+
+    inline rope_node_ptr rope_leaf(std::shared_ptr<const std::string> buffer, size_t offset, size_t length) {
+        if (length == 0) {
+            return nullptr;
+        }
+        auto n = std::make_shared<rope_node>();
+        n->length = length;
+        n->buffer = std::move(buffer);
+        n->offset = offset;
+        return n;
+    }
+
+    inline rope_node_ptr rope_concat(rope_node_ptr l, rope_node_ptr r) {
+        if (l->is_leaf() && r->is_leaf() && l->length + r->length <= rope_merge_limit) {
+            std::string merged;
+            merged.reserve(l->length + r->length);
+            mpp::string_ref lr = l->leaf_ref();
+            mpp::string_ref rr = r->leaf_ref();
+            merged.append(lr.data(), lr.size());
+            merged.append(rr.data(), rr.size());
+            size_t length = merged.size();
+            return rope_leaf(std::make_shared<const std::string>(std::move(merged)), 0, length);
+        }
+        auto n = std::make_shared<rope_node>();
+        n->length = l->length + r->length;
+        n->height = std::max(l->height, r->height) + 1;
+        n->left = std::move(l);
+        n->right = std::move(r);
+        return n;
+    }
+
+    // (a, (b, c)) => ((a, b), c)
+    inline rope_node_ptr rope_rotate_left(const rope_node_ptr &n) {
+        return rope_concat(rope_concat(n->left, n->right->left), n->right->right);
+    }
+
+    // ((a, b), c) => (a, (b, c))
+    inline rope_node_ptr rope_rotate_right(const rope_node_ptr &n) {
+        return rope_concat(n->left->left, rope_concat(n->left->right, n->right));
+    }
+
+    inline rope_node_ptr rope_join_right(const rope_node_ptr &l, const rope_node_ptr &r) {
+        const rope_node_ptr &c = l->right;
+        if (rope_height(c) <= rope_height(r) + 1) {
+            rope_node_ptr t = rope_concat(c, r);
+            if (rope_height(t) <= rope_height(l->left) + 1) {
+                return rope_concat(l->left, t);
+            }
+            return rope_rotate_left(rope_concat(l->left, rope_rotate_right(t)));
+        }
+        rope_node_ptr t = rope_join_right(c, r);
+        rope_node_ptr joined = rope_concat(l->left, t);
+        if (rope_height(t) <= rope_height(l->left) + 1) {
+            return joined;
+        }
+        return rope_rotate_left(joined);
+    }
+
+    inline rope_node_ptr rope_join_left(const rope_node_ptr &l, const rope_node_ptr &r) {
+        const rope_node_ptr &c = r->left;
+        if (rope_height(c) <= rope_height(l) + 1) {
+            rope_node_ptr t = rope_concat(l, c);
+            if (rope_height(t) <= rope_height(r->right) + 1) {
+                return rope_concat(t, r->right);
+            }
+            return rope_rotate_right(rope_concat(rope_rotate_left(t), r->right));
+        }
+        rope_node_ptr t = rope_join_left(l, c);
+        rope_node_ptr joined = rope_concat(t, r->right);
+        if (rope_height(t) <= rope_height(r->right) + 1) {
+            return joined;
+        }
+        return rope_rotate_right(joined);
+    }
+
+    inline const rope_node *rope_edge_leaf(const rope_node *n, bool rightmost) {
+        while (!n->is_leaf()) {
+            n = rightmost ? n->right.get() : n->left.get();
+        }
+        return n;
+    }
+
+    /**
+     * Merge a small leaf into the rightmost (or leftmost) leaf of a tree.
+     * Only the spine is rebuilt and every height stays the same.
+     */
+    inline rope_node_ptr rope_merge_edge(const rope_node_ptr &n, const rope_node_ptr &leaf, bool rightmost) {
+        if (n->is_leaf()) {
+            return rightmost ? rope_concat(n, leaf) : rope_concat(leaf, n);
+        }
+        if (rightmost) {
+            return rope_concat(n->left, rope_merge_edge(n->right, leaf, true));
+        }
+        return rope_concat(rope_merge_edge(n->left, leaf, false), n->right);
+    }
+
+    /**
+     * Concatenate two balanced trees, in O(|height(l) - height(r)|).
+     */
+    inline rope_node_ptr rope_join(const rope_node_ptr &l, const rope_node_ptr &r) {
+        if (!l) {
+            return r;
+        }
+        if (!r) {
+            return l;
+        }
+        if (r->is_leaf() && r->length + rope_edge_leaf(l.get(), true)->length <= rope_merge_limit) {
+            return rope_merge_edge(l, r, true);
+        }
+        if (l->is_leaf() && l->length + rope_edge_leaf(r.get(), false)->length <= rope_merge_limit) {
+            return rope_merge_edge(r, l, false);
+        }
+        if (l->height > r->height + 1) {
+            return rope_join_right(l, r);
+        }
+        if (r->height > l->height + 1) {
+            return rope_join_left(l, r);
+        }
+        return rope_concat(l, r);
+    }
+
+    /**
+     * Split a tree into [0, pos) and [pos, length), in O(log n).
+     */
+    inline std::pair<rope_node_ptr, rope_node_ptr> rope_split(const rope_node_ptr &n, size_t pos) {
+        if (!n) {
+            return {nullptr, nullptr};
+        }
+        if (pos == 0) {
+            return {nullptr, n};
+        }
+        if (pos >= n->length) {
+            return {n, nullptr};
+        }
+        if (n->is_leaf()) {
+            return {rope_leaf(n->buffer, n->offset, pos),
+                    rope_leaf(n->buffer, n->offset + pos, n->length - pos)};
+        }
+        size_t left_length = n->left->length;
+        if (pos < left_length) {
+            auto parts = rope_split(n->left, pos);
+            return {parts.first, rope_join(parts.second, n->right)};
+        }
+        auto parts = rope_split(n->right, pos - left_length);
+        return {rope_join(n->left, parts.first), parts.second};
+    }
+}
+
+namespace mpp {
+    /**
+     * A rope: an immutable string stored as a balanced tree of shared chunks.
+     *
+     * Concatenation, substring, insertion and erasure take O(log n) and never
+     * copy the character data (except for merging small neighbouring chunks),
+     * and copying a rope only copies a pointer. The contents can be walked
+     * chunk by chunk as string_refs, e.g. to feed writev().
+     */
+    class rope {
+    public:
+        static constexpr size_t npos = string_ref::npos;
+
+        /**
+         * Forward iterator over the chunks of a rope, in order.
+         * It is valid as long as the rope it came from is alive.
+         */
+        class chunk_iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = string_ref;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const string_ref *;
+            using reference = string_ref;
+
+        private:
+            // the path of right subtrees still to visit
+            std::vector<const mpp_impl::rope_node *> _stack;
+            const mpp_impl::rope_node *_leaf = nullptr;
+
+            void descend(const mpp_impl::rope_node *n) {
+                while (n && !n->is_leaf()) {
+                    _stack.push_back(n->right.get());
+                    n = n->left.get();
+                }
+                _leaf = n;
+            }
+
+        public:
+            chunk_iterator() = default;
+
+            explicit chunk_iterator(const mpp_impl::rope_node *root) {
+                descend(root);
+            }
+
+            string_ref operator*() const { return _leaf->leaf_ref(); }
+
+            chunk_iterator &operator++() {
+                if (_stack.empty()) {
+                    _leaf = nullptr;
+                } else {
+                    const mpp_impl::rope_node *next = _stack.back();
+                    _stack.pop_back();
+                    descend(next);
+                }
+                return *this;
+            }
+
+            chunk_iterator operator++(int) {
+                chunk_iterator old = *this;
+                ++*this;
+                return old;
+            }
+
+            bool operator==(const chunk_iterator &rhs) const { return _leaf == rhs._leaf; }
+
+            bool operator!=(const chunk_iterator &rhs) const { return _leaf != rhs._leaf; }
+        };
+
+    private:
+        mpp_impl::rope_node_ptr _root;
+
+        explicit rope(mpp_impl::rope_node_ptr root) : _root(std::move(root)) {}
+
+    public:
+        rope() = default;
+
+        /**
+         * Copy a string into a new rope.
+         */
+        /*implicit*/ rope(string_ref str)
+                : rope(str.str()) {}
+
+        /*implicit*/ rope(const char *str)
+                : rope(string_ref::with(str)) {}
+
+        /*implicit*/ rope(const std::string &str)
+                : rope(std::string(str)) {}
+
+        /**
+         * Take over a string without copying it.
+         */
+        /*implicit*/ rope(std::string &&str) {
+            size_t length = str.size();
+            _root = mpp_impl::rope_leaf(std::make_shared<const std::string>(std::move(str)), 0, length);
+        }
+
+        size_t size() const { return _root ? _root->length : 0; }
+
+        bool empty() const { return size() == 0; }
+
+        /**
+         * Get the height of the tree, 0 for a single chunk.
+         *
+         * @return height
+         */
+        unsigned depth() const { return mpp_impl::rope_height(_root); }
+
+        chunk_iterator chunks_begin() const { return chunk_iterator(_root.get()); }
+
+        chunk_iterator chunks_end() const { return chunk_iterator(); }
+
+        /**
+         * Iterate over the chunks as string_refs.
+         *
+         * @return range of chunks
+         */
+        mpp::iterator_range<chunk_iterator> chunks() const {
+            return mpp::make_range(chunks_begin(), chunks_end());
+        }
+
+        size_t chunk_count() const {
+            return std::distance(chunks_begin(), chunks_end());
+        }
+
+        /**
+         * Get the character at index, in O(log n).
+         *
+         * @param index
+         * @return char
+         */
+        char at(size_t index) const {
+            if (index >= size()) {
+                mpp::throw_ex<mpp::runtime_error>("rope: invalid index");
+            }
+            const mpp_impl::rope_node *n = _root.get();
+            while (!n->is_leaf()) {
+                if (index < n->left->length) {
+                    n = n->left.get();
+                } else {
+                    index -= n->left->length;
+                    n = n->right.get();
+                }
+            }
+            return n->buffer->data()[n->offset + index];
+        }
+
+        char operator[](size_t index) const { return at(index); }
+
+        rope &append(const rope &other) {
+            _root = mpp_impl::rope_join(_root, other._root);
+            return *this;
+        }
+
+        rope &operator+=(const rope &other) {
+            return append(other);
+        }
+
+        /**
+         * Return the rope of [start_index, start_index + N), sharing the chunks.
+         * Arguments out of range are clamped like string_ref::substr().
+         *
+         * @param start_index
+         * @param N
+         * @return
+         */
+        rope substr(size_t start_index, size_t N = npos) const {
+            start_index = std::min(start_index, size());
+            N = std::min(N, size() - start_index);
+            auto tail = mpp_impl::rope_split(_root, start_index).second;
+            return rope(mpp_impl::rope_split(tail, N).first);
+        }
+
+        /**
+         * Insert another rope before index.
+         *
+         * @param index clamped to the size of this rope
+         * @param other
+         */
+        rope &insert(size_t index, const rope &other) {
+            auto parts = mpp_impl::rope_split(_root, std::min(index, size()));
+            _root = mpp_impl::rope_join(mpp_impl::rope_join(parts.first, other._root), parts.second);
+            return *this;
+        }
+
+        /**
+         * Remove [start_index, start_index + N).
+         *
+         * @param start_index
+         * @param N
+         */
+        rope &erase(size_t start_index, size_t N = npos) {
+            start_index = std::min(start_index, size());
+            N = std::min(N, size() - start_index);
+            auto head = mpp_impl::rope_split(_root, start_index);
+            _root = mpp_impl::rope_join(head.first, mpp_impl::rope_split(head.second, N).second);
+            return *this;
+        }
+
+        /**
+         * Search for a string, matches may span any number of chunks.
+         *
+         * @param str the string to search for
+         * @param start_index
+         * @return index of the first match, or npos if not found
+         */
+        size_t find(string_ref str, size_t start_index = 0) const {
+            size_t N = str.size();
+            if (start_index > size()) {
+                return npos;
+            }
+            if (N == 0) {
+                return start_index;
+            }
+
+            // The last N - 1 bytes (at or after start_index) of the chunks
+            // already seen, for matches that cross into the next chunk.
+            std::string carry;
+            size_t base = 0;
+            for (auto it = chunks_begin(), end = chunks_end(); it != end; ++it) {
+                string_ref chunk = *it;
+                size_t chunk_end = base + chunk.size();
+                if (chunk_end <= start_index) {
+                    base = chunk_end;
+                    continue;
+                }
+
+                if (!carry.empty()) {
+                    std::string window = carry;
+                    string_ref head = chunk.take_front(N - 1);
+                    window.append(head.data(), head.size());
+                    size_t pos = string_ref(window).find(str);
+                    if (pos != npos && pos < carry.size()) {
+                        return base - carry.size() + pos;
+                    }
+                }
+
+                size_t from = start_index > base ? start_index - base : 0;
+                size_t pos = chunk.find(str, from);
+                if (pos != npos) {
+                    return base + pos;
+                }
+
+                string_ref fresh = chunk.substr(from);
+                if (fresh.size() >= N - 1) {
+                    carry = fresh.take_back(N - 1).str();
+                } else {
+                    carry.append(fresh.data(), fresh.size());
+                    if (carry.size() > N - 1) {
+                        carry.erase(0, carry.size() - (N - 1));
+                    }
+                }
+                base = chunk_end;
+            }
+            return npos;
+        }
+
+        bool contains(string_ref str) const {
+            return find(str) != npos;
+        }
+
+        /**
+         * Flatten the rope into a contiguous string.
+         *
+         * @return
+         */
+        std::string str() const {
+            std::string result;
+            result.reserve(size());
+            for (string_ref chunk : chunks()) {
+                result.append(chunk.data(), chunk.size());
+            }
+            return result;
+        }
+
+        bool equals(string_ref rhs) const {
+            if (rhs.size() != size()) {
+                return false;
+            }
+            for (string_ref chunk : chunks()) {
+                if (!rhs.startswith(chunk)) {
+                    return false;
+                }
+                rhs = rhs.drop_front(chunk.size());
+            }
+            return true;
+        }
+    };
+
+    inline rope operator+(rope lhs, const rope &rhs) {
+        return lhs.append(rhs);
+    }
+}
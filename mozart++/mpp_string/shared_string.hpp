@@ -0,0 +1,342 @@
+/**
+ * Mozart++ Template Library: String
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#pragma once
+
+#include <mozart++/core>
+#include <mozart++/string>
+#include <atomic>
+#include <cstring>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mpp_impl {
+    /**
+     * Header of a shared string buffer, the characters follow it
+     * in the same allocation.
+     */
+    struct shared_string_buffer {
+        std::atomic<size_t> refs;
+        size_t size;
+
+        char *data() { return reinterpret_cast<char *>(this + 1); }
+
+        static shared_string_buffer *create(const char *str, size_t size) {
+            void *memory = ::operator new(sizeof(shared_string_buffer) + size + 1);
+            auto *buffer = new(memory) shared_string_buffer;
+            buffer->refs.store(1, std::memory_order_relaxed);
+            buffer->size = size;
+            if (size != 0) {
+                std::memcpy(buffer->data(), str, size);
+            }
+            buffer->data()[size] = '\0';
+            return buffer;
+        }
+
+        void retain() {
+            refs.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void release() {
+            if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                this->~shared_string_buffer();
+                ::operator delete(this);
+            }
+        }
+    };
+}
+
+namespace mpp {
+    /**
+     * An immutable string that shares its buffer by atomic reference counting.
+     *
+     * Unlike a string_ref, a shared_string is safe to store: substrings,
+     * slices and split results are views of the same buffer that keep it
+     * alive, so tokens can outlive the object they were cut from without
+     * being copied. Copying a shared_string only bumps the reference count,
+     * and the buffer may be shared between threads.
+     *
+     * The query and slicing API mirrors string_ref.
+     */
+    class shared_string {
+    public:
+        static constexpr size_t npos = string_ref::npos;
+        using iterator = const char *;
+        using const_iterator = const char *;
+        using size_type = size_t;
+
+    private:
+        mpp_impl::shared_string_buffer *_buffer = nullptr;
+        string_ref _view;
+
+        shared_string(mpp_impl::shared_string_buffer *buffer, string_ref view)
+                : _buffer(buffer), _view(view) {
+            if (_buffer != nullptr) {
+                _buffer->retain();
+            }
+        }
+
+        shared_string share(string_ref view) const {
+            return shared_string(view.empty() ? nullptr : _buffer, view);
+        }
+
+    public:
+        shared_string() = default;
+
+        /**
+         * Copy a string into a new shared buffer.
+         */
+        /*implicit*/ shared_string(string_ref str) {
+            if (!str.empty()) {
+                _buffer = mpp_impl::shared_string_buffer::create(str.data(), str.size());
+                _view = string_ref{_buffer->data(), str.size()};
+            }
+        }
+
+        /*implicit*/ shared_string(const char *str)
+                : shared_string(string_ref::with(str)) {}
+
+        /*implicit*/ shared_string(const std::string &str)
+                : shared_string(string_ref(str)) {}
+
+        shared_string(const shared_string &other)
+                : shared_string(other._buffer, other._view) {}
+
+        shared_string(shared_string &&other) noexcept
+                : _buffer(other._buffer), _view(other._view) {
+            other._buffer = nullptr;
+            other._view = string_ref();
+        }
+
+        ~shared_string() {
+            if (_buffer != nullptr) {
+                _buffer->release();
+            }
+        }
+
+        shared_string &operator=(shared_string other) noexcept {
+            std::swap(_buffer, other._buffer);
+            std::swap(_view, other._view);
+            return *this;
+        }
+
+        /**
+         * Get a shared_string for a piece of this string, e.g. a token
+         * found by string_ref algorithms on ref().
+         *
+         * @param piece a string_ref inside ref()
+         * @return a view of piece sharing this buffer
+         */
+        shared_string share_piece(string_ref piece) const {
+            if (!piece.empty() && (piece.data() < _view.data()
+                                   || piece.data() + piece.size() > _view.data() + _view.size())) {
+                mpp::throw_ex<mpp::runtime_error>("shared_string: piece outside of the string");
+            }
+            return share(piece);
+        }
+
+        /**
+         * Get the number of shared_strings sharing the buffer.
+         *
+         * @return 0 for an empty string
+         */
+        size_t use_count() const {
+            return _buffer != nullptr ? _buffer->refs.load(std::memory_order_relaxed) : 0;
+        }
+
+        /**
+         * Check whether this string views the whole buffer, so that data()
+         * is null-terminated.
+         */
+        bool is_whole() const {
+            return _buffer == nullptr || _view.size() == _buffer->size;
+        }
+
+        string_ref ref() const { return _view; }
+
+        /*implicit*/ operator string_ref() const { return _view; }
+
+        const char *data() const { return _view.data(); }
+
+        size_t size() const { return _view.size(); }
+
+        bool empty() const { return _view.empty(); }
+
+        iterator begin() const { return _view.begin(); }
+
+        iterator end() const { return _view.end(); }
+
+        char operator[](size_t index) const { return _view[index]; }
+
+        char front() const { return _view.front(); }
+
+        char back() const { return _view.back(); }
+
+        std::string str() const { return _view.str(); }
+
+        template <typename Alloc>
+        alloc_string<Alloc> str(const Alloc &alloc) const { return _view.str(alloc); }
+
+        bool equals(string_ref rhs) const { return _view.equals(rhs); }
+
+        bool equals_ignore_case(string_ref rhs) const { return _view.equals_ignore_case(rhs); }
+
+        int compare(string_ref rhs) const { return _view.compare(rhs); }
+
+        int compare_ignore_case(string_ref rhs) const { return _view.compare_ignore_case(rhs); }
+
+        int compare_numeric(string_ref rhs) const { return _view.compare_numeric(rhs); }
+
+        int compare_numeric_ignore_case(string_ref rhs) const { return _view.compare_numeric_ignore_case(rhs); }
+
+        std::uint64_t hash() const { return _view.hash(); }
+
+        bool startswith(string_ref prefix) const { return _view.startswith(prefix); }
+
+        bool startswith_ignore_case(string_ref prefix) const { return _view.startswith_ignore_case(prefix); }
+
+        bool endswith(string_ref suffix) const { return _view.endswith(suffix); }
+
+        bool endswith_ignore_case(string_ref suffix) const { return _view.endswith_ignore_case(suffix); }
+
+        size_t find(char c, size_t start_index = 0) const { return _view.find(c, start_index); }
+
+        size_t find(string_ref str, size_t start_index = 0) const { return _view.find(str, start_index); }
+
+        size_t find_ignore_case(char c, size_t start_index = 0) const {
+            return _view.find_ignore_case(c, start_index);
+        }
+
+        size_t find_ignore_case(string_ref str, size_t start_index = 0) const {
+            return _view.find_ignore_case(str, start_index);
+        }
+
+        size_t find_if(const mpp::function<bool(char)> &f, size_t start_index = 0) const {
+            return _view.find_if(f, start_index);
+        }
+
+        size_t find_if_not(const mpp::function<bool(char)> &f, size_t start_index = 0) const {
+            return _view.find_if_not(f, start_index);
+        }
+
+        size_t rfind(char c, size_t start_index = npos) const { return _view.rfind(c, start_index); }
+
+        size_t rfind(string_ref str) const { return _view.rfind(str); }
+
+        size_t find_first_of(string_ref chars, size_t start_index = 0) const {
+            return _view.find_first_of(chars, start_index);
+        }
+
+        size_t find_first_not_of(string_ref chars, size_t start_index = 0) const {
+            return _view.find_first_not_of(chars, start_index);
+        }
+
+        size_t find_last_of(string_ref chars, size_t start_index = npos) const {
+            return _view.find_last_of(chars, start_index);
+        }
+
+        size_t find_last_not_of(string_ref chars, size_t start_index = npos) const {
+            return _view.find_last_not_of(chars, start_index);
+        }
+
+        bool contains(string_ref other) const { return _view.contains(other); }
+
+        bool contains_ignore_case(string_ref other) const { return _view.contains_ignore_case(other); }
+
+        size_t count(char c) const { return _view.count(c); }
+
+        size_t count(string_ref str) const { return _view.count(str); }
+
+        std::string lower() const { return _view.lower(); }
+
+        std::string upper() const { return _view.upper(); }
+
+        template <typename Alloc>
+        alloc_string<Alloc> lower(const Alloc &alloc) const { return _view.lower(alloc); }
+
+        template <typename Alloc>
+        alloc_string<Alloc> upper(const Alloc &alloc) const { return _view.upper(alloc); }
+
+        shared_string substr(size_t start_index, size_t N = npos) const {
+            return share(_view.substr(start_index, N));
+        }
+
+        shared_string slice(size_t start, size_t end) const {
+            return share(_view.slice(start, end));
+        }
+
+        shared_string take_front(size_t N = 1) const { return share(_view.take_front(N)); }
+
+        shared_string take_back(size_t N = 1) const { return share(_view.take_back(N)); }
+
+        shared_string take_while(const mpp::function<bool(char)> &f) const { return share(_view.take_while(f)); }
+
+        shared_string take_until(const mpp::function<bool(char)> &f) const { return share(_view.take_until(f)); }
+
+        shared_string drop_front(size_t N = 1) const { return share(_view.drop_front(N)); }
+
+        shared_string drop_back(size_t N = 1) const { return share(_view.drop_back(N)); }
+
+        shared_string drop_while(const mpp::function<bool(char)> &f) const { return share(_view.drop_while(f)); }
+
+        shared_string drop_until(const mpp::function<bool(char)> &f) const { return share(_view.drop_until(f)); }
+
+        shared_string ltrim(string_ref chars = " \t\n\v\f\r") const { return share(_view.ltrim(chars)); }
+
+        shared_string rtrim(string_ref chars = " \t\n\v\f\r") const { return share(_view.rtrim(chars)); }
+
+        shared_string trim(string_ref chars = " \t\n\v\f\r") const { return share(_view.trim(chars)); }
+
+        std::pair<shared_string, shared_string> split(char separator) const {
+            auto parts = _view.split(separator);
+            return std::make_pair(share(parts.first), share(parts.second));
+        }
+
+        std::pair<shared_string, shared_string> split(string_ref separator) const {
+            auto parts = _view.split(separator);
+            return std::make_pair(share(parts.first), share(parts.second));
+        }
+
+        std::pair<shared_string, shared_string> rsplit(char separator) const {
+            auto parts = _view.rsplit(separator);
+            return std::make_pair(share(parts.first), share(parts.second));
+        }
+
+        std::pair<shared_string, shared_string> rsplit(string_ref separator) const {
+            auto parts = _view.rsplit(separator);
+            return std::make_pair(share(parts.first), share(parts.second));
+        }
+
+        /**
+         * Split around a separator like string_ref::split(), every
+         * piece shares this buffer.
+         */
+        void split(std::vector<shared_string> &result, string_ref separator,
+                   int max_split = -1, bool keep_empty = true) const {
+            std::vector<string_ref> pieces;
+            _view.split(pieces, separator, max_split, keep_empty);
+            result.reserve(result.size() + pieces.size());
+            for (string_ref piece : pieces) {
+                result.push_back(share(piece));
+            }
+        }
+
+        void split(std::vector<shared_string> &result, char separator,
+                   int max_split = -1, bool keep_empty = true) const {
+            split(result, string_ref(&separator, 1), max_split, keep_empty);
+        }
+
+        bool operator==(string_ref rhs) const { return _view.equals(rhs); }
+
+        bool operator!=(string_ref rhs) const { return !_view.equals(rhs); }
+
+        bool operator<(string_ref rhs) const { return _view.compare(rhs) < 0; }
+    };
+}
@@ -0,0 +1,193 @@
+/**
+ * Mozart++ Template Library: String
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MOZART_STRING_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+/**
+ * SSSE3 kernels are compiled with a target attribute and picked at runtime,
+ * so they are available without building the whole program for SSSE3.
+ */
+#if defined(MOZART_STRING_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define MOZART_STRING_SSSE3
+#define MOZART_STRING_TARGET_SSSE3 __attribute__((target("ssse3")))
+#include <tmmintrin.h>
+#endif
+
+/**
+ * Block primitives shared by the scanning algorithms.
+ * Every mask function inspects simd_block bytes starting at p (which need
+ * not be aligned) and returns a bit mask whose bit i is set when byte i
+ * matches. A portable scalar version is used when SSE2 is unavailable.
+ */
+namespace mpp_impl {
+    static constexpr size_t simd_block = 16;
+
+    inline unsigned popcount32(std::uint32_t x) {
+#if defined(__POPCNT__)
+        return static_cast<unsigned>(__builtin_popcount(x));
+#else
+        // Without the popcnt instruction the builtin becomes a library call.
+        x = x - ((x >> 1) & 0x55555555u);
+        x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+        x = (x + (x >> 4)) & 0x0F0F0F0Fu;
+        return (x * 0x01010101u) >> 24;
+#endif
+    }
+
+    /**
+     * Index of the lowest set bit, x must not be zero.
+     */
+    inline unsigned ctz32(std::uint32_t x) {
+#if defined(_MSC_VER) && !defined(__clang__)
+        unsigned long index = 0;
+        _BitScanForward(&index, x);
+        return static_cast<unsigned>(index);
+#else
+        return static_cast<unsigned>(__builtin_ctz(x));
+#endif
+    }
+
+    /**
+     * Index of the highest set bit, x must not be zero.
+     */
+    inline unsigned msb32(std::uint32_t x) {
+#if defined(_MSC_VER) && !defined(__clang__)
+        unsigned long index = 0;
+        _BitScanReverse(&index, x);
+        return static_cast<unsigned>(index);
+#else
+        return 31u - static_cast<unsigned>(__builtin_clz(x));
+#endif
+    }
+
+    inline unsigned popcount64(std::uint64_t x) {
+        return popcount32(static_cast<std::uint32_t>(x)) + popcount32(static_cast<std::uint32_t>(x >> 32));
+    }
+
+    /**
+     * Hint that the memory at p is about to be read.
+     */
+    inline void prefetch(const void *p) {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(p);
+#elif defined(MOZART_STRING_SSE2)
+        _mm_prefetch(static_cast<const char *>(p), _MM_HINT_T0);
+#endif
+    }
+
+#ifdef MOZART_STRING_SSSE3
+    inline bool cpu_has_ssse3() {
+#ifdef __SSSE3__
+        return true;
+#else
+        static const bool has_ssse3 = __builtin_cpu_supports("ssse3");
+        return has_ssse3;
+#endif
+    }
+#endif
+
+#ifdef MOZART_STRING_SSE2
+    inline __m128i simd_load(const void *p) {
+        return _mm_loadu_si128(static_cast<const __m128i *>(p));
+    }
+
+    inline std::uint32_t simd_movemask(__m128i v) {
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(v));
+    }
+
+    inline std::uint32_t simd_mask_eq(const void *p, char c) {
+        return simd_movemask(_mm_cmpeq_epi8(simd_load(p), _mm_set1_epi8(c)));
+    }
+
+    inline std::uint32_t simd_mask_high(const void *p) {
+        return simd_movemask(simd_load(p));
+    }
+
+    inline __m128i simd_in_range(__m128i v, std::uint8_t lo, std::uint8_t hi) {
+        __m128i ge = _mm_cmpeq_epi8(_mm_max_epu8(v, _mm_set1_epi8(static_cast<char>(lo))), v);
+        __m128i le = _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(static_cast<char>(hi))), v);
+        return _mm_and_si128(ge, le);
+    }
+
+    inline std::uint32_t simd_mask_range(const void *p, std::uint8_t lo, std::uint8_t hi) {
+        return simd_movemask(simd_in_range(simd_load(p), lo, hi));
+    }
+
+    /**
+     * Count the bytes of [p, e) in the range [lo, hi].
+     * Matches are summed in byte lanes and folded every 255 blocks.
+     */
+    inline size_t simd_count_range(const unsigned char *p, const unsigned char *e,
+                                   std::uint8_t lo, std::uint8_t hi) {
+        size_t count = 0;
+        while (static_cast<size_t>(e - p) >= simd_block) {
+            size_t rounds = std::min<size_t>((e - p) / simd_block, 255);
+            __m128i acc = _mm_setzero_si128();
+            for (size_t i = 0; i < rounds; ++i, p += simd_block) {
+                acc = _mm_sub_epi8(acc, simd_in_range(simd_load(p), lo, hi));
+            }
+            __m128i sums = _mm_sad_epu8(acc, _mm_setzero_si128());
+            count += static_cast<size_t>(_mm_cvtsi128_si32(sums))
+                     + static_cast<size_t>(_mm_cvtsi128_si32(_mm_srli_si128(sums, 8)));
+        }
+        for (; p < e; ++p) {
+            count += *p >= lo && *p <= hi;
+        }
+        return count;
+    }
+#else
+    inline std::uint32_t simd_mask_eq(const void *p, char c) {
+        const char *s = static_cast<const char *>(p);
+        std::uint32_t mask = 0;
+        for (size_t i = 0; i < simd_block; ++i) {
+            mask |= static_cast<std::uint32_t>(s[i] == c) << i;
+        }
+        return mask;
+    }
+
+    inline std::uint32_t simd_mask_high(const void *p) {
+        const unsigned char *s = static_cast<const unsigned char *>(p);
+        std::uint32_t mask = 0;
+        for (size_t i = 0; i < simd_block; ++i) {
+            mask |= static_cast<std::uint32_t>(s[i] >> 7) << i;
+        }
+        return mask;
+    }
+
+    inline std::uint32_t simd_mask_range(const void *p, std::uint8_t lo, std::uint8_t hi) {
+        const unsigned char *s = static_cast<const unsigned char *>(p);
+        std::uint32_t mask = 0;
+        for (size_t i = 0; i < simd_block; ++i) {
+            mask |= static_cast<std::uint32_t>(s[i] >= lo && s[i] <= hi) << i;
+        }
+        return mask;
+    }
+
+    inline size_t simd_count_range(const unsigned char *p, const unsigned char *e,
+                                   std::uint8_t lo, std::uint8_t hi) {
+        size_t count = 0;
+        for (; p < e; ++p) {
+            count += *p >= lo && *p <= hi;
+        }
+        return count;
+    }
+#endif
+}
@@ -0,0 +1,411 @@
+/**
+ * Mozart++ Template Library: String
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#pragma once
+
+#include <mozart++/core>
+#include <mozart++/string>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+namespace mpp {
+    /**
+     * A fixed-capacity string stored entirely inline, it never allocates.
+     * Appending past the capacity is an error.
+     *
+     * @tparam N capacity, not counting the terminating null
+     */
+    template <size_t N>
+    class inline_string {
+        static_assert(N < 256 * 256 * 256, "inline_string: capacity too large");
+
+    public:
+        using iterator = char *;
+        using const_iterator = const char *;
+        using size_type = size_t;
+
+    private:
+        char _data[N + 1] = {0};
+        size_t _size = 0;
+
+        void check_room(size_t n) const {
+            if (n > N) {
+                mpp::throw_ex<mpp::runtime_error>("inline_string: capacity exceeded");
+            }
+        }
+
+    public:
+        inline_string() = default;
+
+        /*implicit*/ inline_string(string_ref str) {
+            assign(str);
+        }
+
+        /*implicit*/ inline_string(const char *str)
+                : inline_string(string_ref::with(str)) {}
+
+        inline_string &operator=(string_ref str) {
+            assign(str);
+            return *this;
+        }
+
+        void assign(string_ref str) {
+            check_room(str.size());
+            if (!str.empty()) {
+                std::memmove(_data, str.data(), str.size());
+            }
+            _size = str.size();
+            _data[_size] = '\0';
+        }
+
+        void append(string_ref str) {
+            check_room(_size + str.size());
+            if (!str.empty()) {
+                std::memcpy(_data + _size, str.data(), str.size());
+            }
+            _size += str.size();
+            _data[_size] = '\0';
+        }
+
+        void push_back(char c) {
+            check_room(_size + 1);
+            _data[_size++] = c;
+            _data[_size] = '\0';
+        }
+
+        inline_string &operator+=(string_ref str) {
+            append(str);
+            return *this;
+        }
+
+        void clear() {
+            _size = 0;
+            _data[0] = '\0';
+        }
+
+        const char *data() const { return _data; }
+
+        char *data() { return _data; }
+
+        const char *c_str() const { return _data; }
+
+        size_t size() const { return _size; }
+
+        bool empty() const { return _size == 0; }
+
+        static constexpr size_t capacity() { return N; }
+
+        char operator[](size_t index) const { return _data[index]; }
+
+        char &operator[](size_t index) { return _data[index]; }
+
+        iterator begin() { return _data; }
+
+        iterator end() { return _data + _size; }
+
+        const_iterator begin() const { return _data; }
+
+        const_iterator end() const { return _data + _size; }
+
+        /*implicit*/ operator string_ref() const { return string_ref{_data, _size}; }
+
+        string_ref ref() const { return string_ref{_data, _size}; }
+
+        std::string str() const { return std::string(_data, _size); }
+    };
+
+    /**
+     * An owning string with N bytes of inline storage, falling back to the
+     * allocator only when the contents outgrow it.
+     *
+     * A small_string converts implicitly to a string_ref, so all string_ref
+     * algorithms apply to it without copying.
+     *
+     * @tparam N inline capacity, not counting the terminating null
+     * @tparam Allocator allocator of the heap storage
+     */
+    template <size_t N = 23, typename Allocator = std::allocator<char>>
+    class small_string {
+    public:
+        using allocator_type = typename std::allocator_traits<Allocator>::template rebind_alloc<char>;
+        using iterator = char *;
+        using const_iterator = const char *;
+        using size_type = size_t;
+
+    private:
+        using alloc_traits = std::allocator_traits<allocator_type>;
+
+        struct heap_storage {
+            char *ptr;
+            size_t capacity;
+        };
+
+        union storage {
+            char buffer[N + 1];
+            heap_storage heap;
+        };
+
+        /**
+         * Holds the allocator next to the data, so that empty allocators
+         * take no room.
+         */
+        struct impl : public allocator_type {
+            storage data;
+            size_t size = 0;
+            bool on_heap = false;
+
+            explicit impl(const allocator_type &alloc) : allocator_type(alloc) {
+                data.buffer[0] = '\0';
+            }
+        };
+
+        impl _impl;
+
+        allocator_type &alloc() { return _impl; }
+
+        char *ptr() { return _impl.on_heap ? _impl.data.heap.ptr : _impl.data.buffer; }
+
+        const char *ptr() const { return _impl.on_heap ? _impl.data.heap.ptr : _impl.data.buffer; }
+
+        void release() {
+            if (_impl.on_heap) {
+                alloc_traits::deallocate(alloc(), _impl.data.heap.ptr, _impl.data.heap.capacity + 1);
+                _impl.on_heap = false;
+            }
+        }
+
+        /**
+         * Grow the capacity to at least n, keeping the contents.
+         */
+        void grow(size_t n) {
+            size_t new_capacity = std::max(n, capacity() * 2);
+            char *buffer = alloc_traits::allocate(alloc(), new_capacity + 1);
+            std::memcpy(buffer, ptr(), _impl.size + 1);
+            release();
+            _impl.data.heap.ptr = buffer;
+            _impl.data.heap.capacity = new_capacity;
+            _impl.on_heap = true;
+        }
+
+        void steal(small_string &other) {
+            _impl.data = other._impl.data;
+            _impl.size = other._impl.size;
+            _impl.on_heap = other._impl.on_heap;
+            other._impl.on_heap = false;
+            other._impl.size = 0;
+            other._impl.data.buffer[0] = '\0';
+        }
+
+        void move_assign(small_string &other, std::true_type) {
+            release();
+            alloc() = static_cast<allocator_type &&>(other.alloc());
+            steal(other);
+        }
+
+        void move_assign(small_string &other, std::false_type) {
+            if (alloc() == other.alloc() || !other._impl.on_heap) {
+                release();
+                steal(other);
+            } else {
+                // the memory cannot change hands, copy it
+                assign(other);
+            }
+        }
+
+    public:
+        small_string() : _impl(allocator_type()) {}
+
+        explicit small_string(const allocator_type &alloc) : _impl(alloc) {}
+
+        /*implicit*/ small_string(string_ref str, const allocator_type &alloc = allocator_type())
+                : _impl(alloc) {
+            assign(str);
+        }
+
+        /*implicit*/ small_string(const char *str, const allocator_type &alloc = allocator_type())
+                : small_string(string_ref::with(str), alloc) {}
+
+        /*implicit*/ small_string(const std::string &str, const allocator_type &alloc = allocator_type())
+                : small_string(string_ref(str), alloc) {}
+
+        small_string(const small_string &other)
+                : _impl(alloc_traits::select_on_container_copy_construction(other._impl)) {
+            assign(other);
+        }
+
+        small_string(small_string &&other) noexcept
+                : _impl(static_cast<allocator_type &&>(other._impl)) {
+            steal(other);
+        }
+
+        ~small_string() {
+            release();
+        }
+
+        small_string &operator=(const small_string &other) {
+            if (this != &other) {
+                assign(other);
+            }
+            return *this;
+        }
+
+        /**
+         * Move the contents over. Only an allocator that propagates on move
+         * assignment guarantees no allocation: otherwise heap contents are
+         * copied when the allocators differ, which may throw.
+         */
+        small_string &operator=(small_string &&other)
+                noexcept(alloc_traits::propagate_on_container_move_assignment::value) {
+            if (this != &other) {
+                move_assign(other, typename alloc_traits::propagate_on_container_move_assignment());
+            }
+            return *this;
+        }
+
+        small_string &operator=(string_ref str) {
+            assign(str);
+            return *this;
+        }
+
+        small_string &operator=(const char *str) {
+            assign(string_ref::with(str));
+            return *this;
+        }
+
+        void assign(string_ref str) {
+            if (str.size() > capacity()) {
+                // str cannot alias our own storage, it would fit otherwise
+                _impl.size = 0;
+                grow(str.size());
+            }
+            if (!str.empty()) {
+                std::memmove(ptr(), str.data(), str.size());
+            }
+            _impl.size = str.size();
+            ptr()[_impl.size] = '\0';
+        }
+
+        void reserve(size_t n) {
+            if (n > capacity()) {
+                grow(n);
+            }
+        }
+
+        void append(string_ref str) {
+            size_t n = _impl.size + str.size();
+            if (n > capacity()) {
+                // str may point into ourselves, keep it alive while growing
+                if (str.data() >= ptr() && str.data() < ptr() + _impl.size) {
+                    size_t offset = str.data() - ptr();
+                    grow(n);
+                    str = string_ref{ptr() + offset, str.size()};
+                } else {
+                    grow(n);
+                }
+            }
+            if (!str.empty()) {
+                std::memmove(ptr() + _impl.size, str.data(), str.size());
+            }
+            _impl.size = n;
+            ptr()[n] = '\0';
+        }
+
+        void push_back(char c) {
+            if (_impl.size == capacity()) {
+                grow(_impl.size + 1);
+            }
+            char *p = ptr();
+            p[_impl.size++] = c;
+            p[_impl.size] = '\0';
+        }
+
+        small_string &operator+=(string_ref str) {
+            append(str);
+            return *this;
+        }
+
+        small_string &operator+=(char c) {
+            push_back(c);
+            return *this;
+        }
+
+        void resize(size_t n, char c = '\0') {
+            reserve(n);
+            if (n > _impl.size) {
+                std::memset(ptr() + _impl.size, c, n - _impl.size);
+            }
+            _impl.size = n;
+            ptr()[n] = '\0';
+        }
+
+        void clear() {
+            _impl.size = 0;
+            ptr()[0] = '\0';
+        }
+
+        /**
+         * Give the heap storage back if the contents fit inline again.
+         */
+        void shrink_to_fit() {
+            if (_impl.on_heap && _impl.size <= N) {
+                char *heap = _impl.data.heap.ptr;
+                size_t heap_capacity = _impl.data.heap.capacity;
+                std::memcpy(_impl.data.buffer, heap, _impl.size + 1);
+                alloc_traits::deallocate(alloc(), heap, heap_capacity + 1);
+                _impl.on_heap = false;
+            }
+        }
+
+        const char *data() const { return ptr(); }
+
+        char *data() { return ptr(); }
+
+        const char *c_str() const { return ptr(); }
+
+        size_t size() const { return _impl.size; }
+
+        bool empty() const { return _impl.size == 0; }
+
+        size_t capacity() const { return _impl.on_heap ? _impl.data.heap.capacity : N; }
+
+        /**
+         * Check whether the contents live in the inline buffer.
+         *
+         * @return is inline?
+         */
+        bool is_inline() const { return !_impl.on_heap; }
+
+        allocator_type get_allocator() const { return _impl; }
+
+        char operator[](size_t index) const { return ptr()[index]; }
+
+        char &operator[](size_t index) { return ptr()[index]; }
+
+        iterator begin() { return ptr(); }
+
+        iterator end() { return ptr() + _impl.size; }
+
+        const_iterator begin() const { return ptr(); }
+
+        const_iterator end() const { return ptr() + _impl.size; }
+
+        /*implicit*/ operator string_ref() const { return string_ref{ptr(), _impl.size}; }
+
+        string_ref ref() const { return string_ref{ptr(), _impl.size}; }
+
+        std::string str() const { return std::string(ptr(), _impl.size); }
+
+        bool operator==(string_ref rhs) const { return ref().equals(rhs); }
+
+        bool operator!=(string_ref rhs) const { return !ref().equals(rhs); }
+
+        bool operator<(string_ref rhs) const { return ref().compare(rhs) < 0; }
+    };
+}
@@ -0,0 +1,249 @@
+/**
+ * Mozart++ Template Library: String
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#pragma once
+
+#include <mozart++/core>
+#include <mozart++/string>
+#include <cstdint>
+
+namespace mpp_impl {
+    /**
+     * hash_bytes() of the string with its ASCII upper case letters folded
+     * to lower case, so keys equal ignoring case hash the same and no
+     * others do.
+     */
+    constexpr std::uint64_t hash_bytes_folded(const char *data, size_t length) {
+        constexpr std::uint64_t k = 0x9E3779B97F4A7C15ull;
+        std::uint64_t h = length * k;
+        for (; length >= 8; data += 8, length -= 8) {
+            h = (h ^ fold_word(load_word(data, 8))) * k;
+            h ^= h >> 29;
+        }
+        if (length != 0) {
+            h = (h ^ fold_word(load_tail(data, length))) * k;
+            h ^= h >> 29;
+        }
+        h *= k;
+        return h ^ (h >> 32);
+    }
+
+    /**
+     * Displacements tried for a bucket before giving up on the keys.
+     */
+    static constexpr std::uint32_t perfect_hash_max_displacement = 1u << 20;
+
+    /**
+     * Rehash a key hash with a bucket displacement.
+     */
+    constexpr std::uint64_t perfect_hash_mix(std::uint64_t h, std::uint64_t displacement) {
+        h ^= displacement * 0x9E3779B97F4A7C15ull;
+        h ^= h >> 31;
+        h *= 0xBF58476D1CE4E5B9ull;
+        return h ^ (h >> 29);
+    }
+}
+
+namespace mpp {
+    template <typename V>
+    struct static_string_entry {
+        string_ref key;
+        V value;
+    };
+
+    /**
+     * An immutable map from a fixed set of strings to values, built at
+     * compile time with a minimal perfect hash (hash and displace).
+     *
+     * A lookup hashes the key once, reads the displacement of its bucket,
+     * and compares the key against the single candidate entry (after
+     * its stored hash, which rejects most misses).
+     * Use make_static_string_map() to build one:
+     *
+     *     constexpr auto commands = mpp::make_static_string_map<int>({
+     *         {"run", 1}, {"sum", 2}, {"quit", 3}
+     *     });
+     *     const int *id = commands.find(input);
+     *
+     * @tparam V a literal, default constructible value type
+     * @tparam N number of keys
+     * @tparam IgnoreCase compare keys ASCII case insensitively
+     */
+    template <typename V, size_t N, bool IgnoreCase = false>
+    class static_string_map {
+        static_assert(N > 0, "static_string_map: no keys");
+
+    public:
+        using entry = static_string_entry<V>;
+        using const_iterator = const entry *;
+
+    private:
+        entry _entries[N] = {};
+        std::uint64_t _hashes[N] = {};
+        std::uint32_t _displacements[N] = {};
+
+        static constexpr std::uint64_t hash_of(string_ref key) {
+            return IgnoreCase ? mpp_impl::hash_bytes_folded(key.data(), key.size()) : key.hash();
+        }
+
+        // map 32 hash bits onto [0, N) with a multiplication instead of a division
+        static constexpr size_t bucket_of(std::uint64_t h) {
+            return static_cast<size_t>(((h >> 32) * N) >> 32);
+        }
+
+        static constexpr size_t slot_of(std::uint64_t h, std::uint32_t displacement) {
+            return static_cast<size_t>(((mpp_impl::perfect_hash_mix(h, displacement) & 0xFFFFFFFFu) * N) >> 32);
+        }
+
+        static constexpr bool same_key(string_ref lhs, string_ref rhs) {
+            return IgnoreCase ? lhs.equals_ignore_case(rhs) : lhs.equals(rhs);
+        }
+
+    public:
+        /**
+         * Build the perfect hash, failing compilation (or throwing at runtime)
+         * on duplicate keys.
+         * Each bucket tries displacements until its keys land on free slots.
+         * Distinct hashes make that likely within a few tries per key, but
+         * not certain: the search gives up (and fails the same way) after
+         * perfect_hash_max_displacement tries.
+         *
+         * @param entries
+         */
+        constexpr explicit static_string_map(const entry (&entries)[N]) {
+            std::uint64_t hashes[N] = {};
+            for (size_t i = 0; i < N; ++i) {
+                hashes[i] = hash_of(entries[i].key);
+                for (size_t j = 0; j < i; ++j) {
+                    if (hashes[j] == hashes[i]) {
+                        mpp::throw_ex<mpp::runtime_error>(same_key(entries[i].key, entries[j].key)
+                                                          ? "static_string_map: duplicate key"
+                                                          : "static_string_map: hash collision");
+                    }
+                }
+            }
+
+            // group the keys by bucket
+            size_t bucket_start[N + 1] = {};
+            for (size_t i = 0; i < N; ++i) {
+                ++bucket_start[bucket_of(hashes[i]) + 1];
+            }
+            size_t max_bucket = 0;
+            for (size_t b = 0; b < N; ++b) {
+                max_bucket = bucket_start[b + 1] > max_bucket ? bucket_start[b + 1] : max_bucket;
+                bucket_start[b + 1] += bucket_start[b];
+            }
+            size_t members[N] = {};
+            size_t filled[N] = {};
+            for (size_t i = 0; i < N; ++i) {
+                size_t b = bucket_of(hashes[i]);
+                members[bucket_start[b] + filled[b]++] = i;
+            }
+
+            // place the largest buckets first, while the table is empty
+            bool used[N] = {};
+            for (size_t size = max_bucket; size > 0; --size) {
+                for (size_t b = 0; b < N; ++b) {
+                    if (bucket_start[b + 1] - bucket_start[b] != size) {
+                        continue;
+                    }
+                    for (std::uint32_t displacement = 1;; ++displacement) {
+                        if (displacement > mpp_impl::perfect_hash_max_displacement) {
+                            mpp::throw_ex<mpp::runtime_error>("static_string_map: no perfect hash found");
+                        }
+                        // try to put every key of the bucket into a free slot
+                        size_t slots[N] = {};
+                        bool fits = true;
+                        for (size_t k = 0; k < size && fits; ++k) {
+                            slots[k] = slot_of(hashes[members[bucket_start[b] + k]], displacement);
+                            fits = !used[slots[k]];
+                            for (size_t j = 0; j < k && fits; ++j) {
+                                fits = slots[j] != slots[k];
+                            }
+                        }
+                        if (!fits) {
+                            continue;
+                        }
+                        for (size_t k = 0; k < size; ++k) {
+                            used[slots[k]] = true;
+                            _entries[slots[k]] = entries[members[bucket_start[b] + k]];
+                            _hashes[slots[k]] = hashes[members[bucket_start[b] + k]];
+                        }
+                        _displacements[b] = displacement;
+                        break;
+                    }
+                }
+            }
+        }
+
+        /**
+         * Look up a key.
+         *
+         * @param key
+         * @return the value, or nullptr if key is not in the map
+         */
+        constexpr const V *find(string_ref key) const {
+            std::uint64_t h = hash_of(key);
+            size_t slot = slot_of(h, _displacements[bucket_of(h)]);
+            // most misses are told apart by the stored hash alone
+            return _hashes[slot] == h && same_key(_entries[slot].key, key) ? &_entries[slot].value : nullptr;
+        }
+
+        constexpr bool contains(string_ref key) const {
+            return find(key) != nullptr;
+        }
+
+        /**
+         * Look up a key, with a fallback.
+         *
+         * @param key
+         * @param fallback returned if key is not in the map
+         * @return
+         */
+        constexpr V get(string_ref key, V fallback) const {
+            const V *value = find(key);
+            return value ? *value : fallback;
+        }
+
+        const V &at(string_ref key) const {
+            const V *value = find(key);
+            if (value == nullptr) {
+                mpp::throw_ex<mpp::runtime_error>("static_string_map: no such key");
+            }
+            return *value;
+        }
+
+        static constexpr size_t size() { return N; }
+
+        /**
+         * Iterate over the entries, in hash order.
+         */
+        constexpr const_iterator begin() const { return _entries; }
+
+        constexpr const_iterator end() const { return _entries + N; }
+    };
+
+    /**
+     * Build a static_string_map, at compile time when used in a
+     * constant expression.
+     */
+    template <typename V, size_t N>
+    constexpr static_string_map<V, N> make_static_string_map(const static_string_entry<V> (&entries)[N]) {
+        return static_string_map<V, N>(entries);
+    }
+
+    /**
+     * Build a static_string_map whose keys are matched ASCII case
+     * insensitively.
+     */
+    template <typename V, size_t N>
+    constexpr static_string_map<V, N, true>
+    make_static_string_map_ignore_case(const static_string_entry<V> (&entries)[N]) {
+        return static_string_map<V, N, true>(entries);
+    }
+}
@@ -13,13 +13,283 @@
 #include <mozart++/iterator_range>
 #include <algorithm>
 #include <climits>
+#include <cstdint>
 #include <cstring>
+#include <memory>
 #include <string>
 #include <vector>
 #include <bitset>
 #include <cstdio>
+#include "instrument.hpp"
+
+/**
+ * Detect support for telling constant evaluation apart from runtime,
+ * which lets constexpr algorithms use library and SIMD code at runtime.
+ */
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_is_constant_evaluated)
+#define MOZART_STRING_HAS_CONSTANT_EVALUATED
+#endif
+#endif
+#if !defined(MOZART_STRING_HAS_CONSTANT_EVALUATED) \
+    && ((defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 9) || (defined(_MSC_VER) && _MSC_VER >= 1925))
+#define MOZART_STRING_HAS_CONSTANT_EVALUATED
+#endif
+
+#if (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) || defined(_MSC_VER)
+#define MOZART_STRING_LITTLE_ENDIAN
+#endif
+
+namespace mpp_impl {
+    /**
+     * Check whether the caller runs outside of constant evaluation.
+     * Without compiler support this is always false, so constexpr
+     * algorithms take their plain loops everywhere.
+     */
+    constexpr bool is_runtime() noexcept {
+#ifdef MOZART_STRING_HAS_CONSTANT_EVALUATED
+        return !__builtin_is_constant_evaluated();
+#else
+        return false;
+#endif
+    }
+
+    constexpr size_t c_string_length(const char *str) {
+        if (is_runtime()) {
+            return std::strlen(str);
+        }
+        size_t length = 0;
+        while (str[length] != '\0') {
+            ++length;
+        }
+        return length;
+    }
+
+    /**
+     * The runtime paths of compare_bytes() and find_byte(), outside of
+     * constexpr functions so that they can be instrumented.
+     */
+    inline int compare_bytes_runtime(const char *lhs, const char *rhs, size_t length) {
+        MOZART_STRING_PROBE(compare, length);
+        return std::memcmp(lhs, rhs, length);
+    }
+
+    inline const char *find_byte_runtime(const char *data, char c, size_t length) {
+        MOZART_STRING_PROBE(find, length);
+        return static_cast<const char *>(std::memchr(data, c, length));
+    }
+
+    /**
+     * memcmp() usable in constant expressions, and with null pointers
+     * when length is 0.
+     */
+    constexpr int compare_bytes(const char *lhs, const char *rhs, size_t length) {
+        if (length == 0) {
+            return 0;
+        }
+        if (is_runtime()) {
+            return compare_bytes_runtime(lhs, rhs, length);
+        }
+        for (size_t i = 0; i < length; ++i) {
+            if (lhs[i] != rhs[i]) {
+                return static_cast<unsigned char>(lhs[i]) < static_cast<unsigned char>(rhs[i]) ? -1 : 1;
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * memchr() usable in constant expressions.
+     */
+    constexpr const char *find_byte(const char *data, char c, size_t length) {
+        if (is_runtime()) {
+            return find_byte_runtime(data, c, length);
+        }
+        for (size_t i = 0; i < length; ++i) {
+            if (data[i] == c) {
+                return data + i;
+            }
+        }
+        return nullptr;
+    }
+
+    constexpr char ascii_fold(char c) {
+        return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    /**
+     * Fold the ASCII upper case letters among 8 bytes to lower case at
+     * once, leaving every other byte alone.
+     */
+    constexpr std::uint64_t fold_word(std::uint64_t w) {
+        constexpr std::uint64_t ones = 0x0101010101010101ull;
+        std::uint64_t low7 = w & (0x7F * ones);
+        // the high bit of each byte is set where the byte is above 'Z', or at least 'A'
+        std::uint64_t above_z = low7 + (0x7F - 'Z') * ones;
+        std::uint64_t from_a = low7 + (0x80 - 'A') * ones;
+        std::uint64_t upper = from_a & ~above_z & ~w & (0x80 * ones);
+        return w | (upper >> 2);
+    }
+
+    /**
+     * Load up to 8 bytes as a little-endian word, the same at compile
+     * time and at runtime.
+     */
+    constexpr std::uint64_t load_word(const char *data, size_t length) {
+#ifdef MOZART_STRING_LITTLE_ENDIAN
+        if (is_runtime()) {
+            std::uint64_t w = 0;
+            std::memcpy(&w, data, length);
+            return w;
+        }
+#endif
+        std::uint64_t w = 0;
+        for (size_t i = 0; i < length; ++i) {
+            w |= std::uint64_t(static_cast<unsigned char>(data[i])) << (8 * i);
+        }
+        return w;
+    }
+
+    /**
+     * Gather the last 1 to 7 bytes of a string into a word without a
+     * variable-length copy: two overlapping 4-byte loads, or the first,
+     * middle and last byte.
+     */
+    constexpr std::uint64_t load_tail(const char *data, size_t length) {
+        if (length >= 4) {
+            return load_word(data, 4) | (load_word(data + length - 4, 4) << 32);
+        }
+        return std::uint64_t(static_cast<unsigned char>(data[0]))
+               | std::uint64_t(static_cast<unsigned char>(data[length / 2])) << 8
+               | std::uint64_t(static_cast<unsigned char>(data[length - 1])) << 16;
+    }
+
+    /**
+     * A fast non-cryptographic hash, reading 8 bytes per step.
+     *
+     * @param data
+     * @param length
+     * @param seed
+     * @return 64-bit hash value
+     */
+    constexpr std::uint64_t hash_bytes(const char *data, size_t length, std::uint64_t seed = 0) {
+        constexpr std::uint64_t k = 0x9E3779B97F4A7C15ull;
+        std::uint64_t h = seed ^ (length * k);
+        for (; length >= 8; data += 8, length -= 8) {
+            h = (h ^ load_word(data, 8)) * k;
+            h ^= h >> 29;
+        }
+        if (length != 0) {
+            h = (h ^ load_tail(data, length)) * k;
+            h ^= h >> 29;
+        }
+        h *= k;
+        return h ^ (h >> 32);
+    }
+
+    constexpr bool is_ascii_digit(char c) {
+        return static_cast<unsigned>(c - '0') < 10;
+    }
+
+    /**
+     * Get the index of the first byte where two strings differ,
+     * comparing 8 bytes at a time with memcmp().
+     */
+    inline size_t mismatch_bytes(const char *lhs, const char *rhs, size_t length) {
+        size_t i = 0;
+        while (i + 8 <= length && std::memcmp(lhs + i, rhs + i, 8) == 0) {
+            i += 8;
+        }
+        while (i < length && lhs[i] == rhs[i]) {
+            ++i;
+        }
+        return i;
+    }
+
+    /**
+     * Compare two strings in natural order: runs of digits compare by
+     * their numeric value (of any length, never parsed into an integer),
+     * everything else byte by byte. Numbers that differ only in leading
+     * zeros are ordered by the count of zeros, as a last resort.
+     *
+     * @param fold compare ASCII letters case insensitively
+     * @return -1, 0 or 1
+     */
+    inline int natural_compare(const char *lhs, size_t lhs_length, const char *rhs, size_t rhs_length, bool fold) {
+        size_t i = 0;
+        size_t j = 0;
+        if (!fold && lhs_length != 0 && rhs_length != 0) {
+            // skip the common prefix, except for the digits of a number running into the mismatch
+            i = mismatch_bytes(lhs, rhs, std::min(lhs_length, rhs_length));
+            while (i > 0 && is_ascii_digit(lhs[i - 1])) {
+                --i;
+            }
+            j = i;
+        }
+
+        int zeros = 0;
+        while (i < lhs_length && j < rhs_length) {
+            if (is_ascii_digit(lhs[i]) && is_ascii_digit(rhs[j])) {
+                size_t lhs_start = i;
+                size_t rhs_start = j;
+                while (i < lhs_length && lhs[i] == '0') {
+                    ++i;
+                }
+                while (j < rhs_length && rhs[j] == '0') {
+                    ++j;
+                }
+                size_t lhs_zeros = i - lhs_start;
+                size_t rhs_zeros = j - rhs_start;
+                lhs_start = i;
+                rhs_start = j;
+                while (i < lhs_length && is_ascii_digit(lhs[i])) {
+                    ++i;
+                }
+                while (j < rhs_length && is_ascii_digit(rhs[j])) {
+                    ++j;
+                }
+                // without leading zeros, the longer number is larger
+                if (i - lhs_start != j - rhs_start) {
+                    return i - lhs_start < j - rhs_start ? -1 : 1;
+                }
+                int r = std::memcmp(lhs + lhs_start, rhs + rhs_start, i - lhs_start);
+                if (r != 0) {
+                    return r < 0 ? -1 : 1;
+                }
+                if (zeros == 0 && lhs_zeros != rhs_zeros) {
+                    zeros = lhs_zeros < rhs_zeros ? -1 : 1;
+                }
+                continue;
+            }
+
+            char l = fold ? ascii_fold(lhs[i]) : lhs[i];
+            char r = fold ? ascii_fold(rhs[j]) : rhs[j];
+            if (l != r) {
+                return static_cast<unsigned char>(l) < static_cast<unsigned char>(r) ? -1 : 1;
+            }
+            ++i;
+            ++j;
+        }
+
+        if (i < lhs_length) {
+            return 1;
+        }
+        if (j < rhs_length) {
+            return -1;
+        }
+        return zeros;
+    }
+}
 
 namespace mpp {
+    /**
+     * The std::basic_string of CharT that allocates with Alloc, rebound to
+     * CharT, so that one allocator serves narrow and wide results alike.
+     */
+    template <typename Alloc, typename CharT = char>
+    using alloc_string = std::basic_string<CharT, std::char_traits<CharT>,
+            typename std::allocator_traits<Alloc>::template rebind_alloc<CharT>>;
+
     /**
      * Represent a constant reference to a string, i.e. a character
      * array and a length, which need not be null terminated.
@@ -57,19 +327,28 @@ namespace mpp {
          * @param length
          * @return
          */
-        static int safe_memcmp(const char *lhs, const char *rhs, size_t length) {
-            if (length == 0) { return 0; }
-            return ::memcmp(lhs, rhs, length);
+        static constexpr int safe_memcmp(const char *lhs, const char *rhs, size_t length) {
+            return mpp_impl::compare_bytes(lhs, rhs, length);
         }
 
         /**
          * Constexpr version of std::strlen.
          */
-        static size_t string_length(const char *str) {
-            return std::char_traits<char>::length(str);
+        static constexpr size_t string_length(const char *str) {
+            return mpp_impl::c_string_length(str);
         }
 
-        static int ascii_strncasecmp(const char *lhs, const char *rhs, size_t length) {
+        static constexpr int ascii_strncasecmp(const char *lhs, const char *rhs, size_t length) {
+            if (!mpp_impl::is_runtime()) {
+                for (size_t index = 0; index < length; ++index) {
+                    char lw = mpp_impl::ascii_fold(lhs[index]);
+                    char rw = mpp_impl::ascii_fold(rhs[index]);
+                    if (lw != rw) {
+                        return static_cast<unsigned char>(lw) < static_cast<unsigned char>(rw) ? -1 : 1;
+                    }
+                }
+                return 0;
+            }
             for (size_t index = 0; index < length; ++index) {
                 unsigned char lw = std::tolower(lhs[index]);
                 unsigned char rw = std::tolower(rhs[index]);
@@ -93,7 +372,7 @@ namespace mpp {
         }
 
     public:
-        char operator[](size_t index) const {
+        constexpr char operator[](size_t index) const {
             // TODO: replace with exception handling system.
             if (index >= _length) {
                 mpp::throw_ex<mpp::runtime_error>("stringref: invalid index");
@@ -131,9 +410,13 @@ namespace mpp {
         /*implicit*/ string_ref(const std::string &str)
                 : _data(str.data()), _length(str.length()) {}
 
-        iterator begin() const { return _data; }
+        template <typename Alloc>
+        /*implicit*/ string_ref(const std::basic_string<char, std::char_traits<char>, Alloc> &str)
+                : _data(str.data()), _length(str.length()) {}
+
+        constexpr iterator begin() const { return _data; }
 
-        iterator end() const { return _data + _length; }
+        constexpr iterator end() const { return _data + _length; }
 
         const unsigned char *bytes_begin() const {
             return reinterpret_cast<const unsigned char *>(begin());
@@ -153,28 +436,28 @@ namespace mpp {
          *
          * @return char array
          */
-        const char *data() const { return _data; }
+        constexpr const char *data() const { return _data; }
 
         /**
          * Check if the string is empty.
          *
          * @return is empty?
          */
-        bool empty() const { return _length == 0; }
+        constexpr bool empty() const { return _length == 0; }
 
         /**
          * Get the length of the string.
          *
          * @return length
          */
-        size_t size() const { return _length; }
+        constexpr size_t size() const { return _length; }
 
         /**
          * Get the first character in the string.
          *
          * @return the first char
          */
-        char front() const {
+        constexpr char front() const {
             if (empty()) {
                 mpp::throw_ex<mpp::runtime_error>("string_ref: front() on empty string");
             }
@@ -186,7 +469,7 @@ namespace mpp {
          *
          * @return the last char
          */
-        char back() const {
+        constexpr char back() const {
             if (empty()) {
                 mpp::throw_ex<mpp::runtime_error>("string_ref: back() on empty string");
             }
@@ -215,7 +498,7 @@ namespace mpp {
          * @param rhs the other string
          * @return is equal?
          */
-        bool equals(string_ref rhs) const {
+        constexpr bool equals(string_ref rhs) const {
             return (_length == rhs._length &&
                     safe_memcmp(_data, rhs._data, rhs._length) == 0);
         }
@@ -226,10 +509,19 @@ namespace mpp {
          * @param rhs
          * @return is equal case insensitively?
          */
-        bool equals_ignore_case(string_ref rhs) const {
+        constexpr bool equals_ignore_case(string_ref rhs) const {
             return _length == rhs._length && compare_ignore_case(rhs) == 0;
         }
 
+        /**
+         * Hash the contents of the string.
+         *
+         * @return hash value
+         */
+        constexpr std::uint64_t hash() const {
+            return mpp_impl::hash_bytes(_data, _length);
+        }
+
         /**
          * Compare two strings.
          * The result is -1, 0, or 1 if this string is lexicographically
@@ -238,7 +530,7 @@ namespace mpp {
          * @param rhs
          * @return -1, 0 or 1
          */
-        int compare(string_ref rhs) const {
+        constexpr int compare(string_ref rhs) const {
             // Check the prefix for a mismatch.
             int r = safe_memcmp(_data, rhs._data, std::min(_length, rhs._length));
             if (r) {
@@ -257,7 +549,7 @@ namespace mpp {
          * @param rhs
          * @return {@see string_ref::compare(string_ref)}
          */
-        int compare_ignore_case(string_ref rhs) const {
+        constexpr int compare_ignore_case(string_ref rhs) const {
             int r = ascii_strncasecmp(_data, rhs._data, std::min(_length, rhs._length));
             if (r) {
                 return r;
@@ -270,47 +562,25 @@ namespace mpp {
         }
 
         /**
-         * Compare two strings, treating sequences of digits as numbers.
+         * Compare two strings, treating sequences of digits as numbers,
+         * so that "file9" sorts before "file10".
+         * Numbers may have any length, and equal numbers written with
+         * different leading zeros are ordered by the count of zeros only
+         * if the strings are otherwise equal.
          * @param rhs
-         * @return
+         * @return -1, 0 or 1
          */
         int compare_numeric(string_ref rhs) const {
-            for (size_t i = 0, end = std::min(_length, rhs._length); i != end; ++i) {
-                // Check for sequences of digits.
-                if (std::isdigit(_data[i]) && std::isdigit(rhs._data[i])) {
-                    // The longer sequence of numbers is considered larger.
-                    // This doesn't really handle prefixed zeros well.
-                    size_t j = 0;
-                    for (j = i + 1; j != end + 1; ++j) {
-                        bool ld = j < _length && std::isdigit(_data[j]);
-                        bool rd = j < rhs._length && std::isdigit(rhs._data[j]);
-                        if (ld != rd) {
-                            return rd ? -1 : 1;
-                        }
-                        if (!rd) {
-                            break;
-                        }
-                    }
-
-                    // The two number sequences have the same length (j-i), just memcmp them.
-                    int r = safe_memcmp(_data + i, rhs._data + i, j - i);
-                    if (r) {
-                        return r < 0 ? -1 : 1;
-                    }
-                    // Identical number sequences, continue search after the numbers.
-                    i = j - 1;
-                    continue;
-                }
-
-                if (_data[i] != rhs._data[i]) {
-                    return (unsigned char) _data[i] < (unsigned char) rhs._data[i] ? -1 : 1;
-                }
-            }
+            return mpp_impl::natural_compare(_data, _length, rhs._data, rhs._length, false);
+        }
 
-            if (_length == rhs._length) {
-                return 0;
-            }
-            return _length < rhs._length ? -1 : 1;
+        /**
+         * Compare two strings like compare_numeric(), case insensitively.
+         * @param rhs
+         * @return -1, 0 or 1
+         */
+        int compare_numeric_ignore_case(string_ref rhs) const {
+            return mpp_impl::natural_compare(_data, _length, rhs._data, rhs._length, true);
         }
 
         /**
@@ -318,8 +588,22 @@ namespace mpp {
          * @return
          */
         std::string str() const {
-            if (!_data) { return std::string(); }
-            return std::string(_data, _length);
+            return str(std::allocator<char>());
+        }
+
+        /**
+         * Get the contents as a string allocated by alloc.
+         * @param alloc
+         * @return
+         */
+        template <typename Alloc>
+        alloc_string<Alloc> str(const Alloc &alloc) const {
+            using string_type = alloc_string<Alloc>;
+            if (!_data) { return string_type(typename string_type::allocator_type(alloc)); }
+            MOZART_STRING_PROBE(copy, _length);
+            string_type result(_data, _length, typename string_type::allocator_type(alloc));
+            MOZART_STRING_COUNT_ALLOCATIONS(copy, mpp_impl::heap_allocated(result));
+            return result;
         }
 
         /**
@@ -327,7 +611,7 @@ namespace mpp {
          * @param prefix
          * @return
          */
-        bool startswith(string_ref prefix) const {
+        constexpr bool startswith(string_ref prefix) const {
             return _length >= prefix._length &&
                    safe_memcmp(_data, prefix._data, prefix._length) == 0;
         }
@@ -337,7 +621,7 @@ namespace mpp {
          * @param prefix
          * @return
          */
-        bool startswith_ignore_case(string_ref prefix) const {
+        constexpr bool startswith_ignore_case(string_ref prefix) const {
             return _length >= prefix._length &&
                    ascii_strncasecmp(_data, prefix._data, prefix._length) == 0;
         }
@@ -347,7 +631,7 @@ namespace mpp {
          * @param suffix
          * @return
          */
-        bool endswith(string_ref suffix) const {
+        constexpr bool endswith(string_ref suffix) const {
             return _length >= suffix._length &&
                    safe_memcmp(end() - suffix._length, suffix._data, suffix._length) == 0;
         }
@@ -357,7 +641,7 @@ namespace mpp {
          * @param prefix
          * @return
          */
-        bool endswith_ignore_case(string_ref suffix) const {
+        constexpr bool endswith_ignore_case(string_ref suffix) const {
             return _length >= suffix._length &&
                    ascii_strncasecmp(end() - suffix._length, suffix._data, suffix._length) == 0;
         }
@@ -368,13 +652,13 @@ namespace mpp {
          * @param start_index
          * @return index of the first c, or npos if not found
          */
-        size_t find(char c, size_t start_index = 0) const {
+        constexpr size_t find(char c, size_t start_index = 0) const {
             size_t pos = std::min(start_index, _length);
             if (pos < _length) {
                 // Avoid calling memchr with nullptr.
                 // Just forward to memchr, which is faster than a hand-rolled loop.
-                if (const void *s = ::memchr(_data + pos, c, _length - pos)) {
-                    return static_cast<const char *>(s) - _data;
+                if (const char *s = mpp_impl::find_byte(_data + pos, c, _length - pos)) {
+                    return s - _data;
                 }
             }
             return npos;
@@ -424,10 +708,27 @@ namespace mpp {
             );
         }
 
-        size_t find(string_ref str, size_t start_index = 0) const {
+        constexpr size_t find(string_ref str, size_t start_index = 0) const {
+            if (mpp_impl::is_runtime()) {
+                return find_bytes(str, start_index);
+            }
+            if (start_index > _length) {
+                return npos;
+            }
+            for (size_t i = start_index; str.size() <= _length - i; ++i) {
+                if (substr(i, str.size()).equals(str)) {
+                    return i;
+                }
+            }
+            return npos;
+        }
+
+    private:
+        size_t find_bytes(string_ref str, size_t start_index) const {
             if (start_index > _length) {
                 return npos;
             }
+            MOZART_STRING_PROBE(find, _length - start_index);
 
             const char *start = _data + start_index;
             size_t size = _length - start_index;
@@ -479,6 +780,7 @@ namespace mpp {
             return npos;
         }
 
+    public:
         size_t find_ignore_case(string_ref str, size_t start_index = 0) const {
             string_ref _this = substr(start_index);
             while (_this.size() >= str.size()) {
@@ -491,7 +793,7 @@ namespace mpp {
             return npos;
         }
 
-        size_t rfind(char c, size_t start_index = npos) const {
+        constexpr size_t rfind(char c, size_t start_index = npos) const {
             start_index = std::min(start_index, _length);
             size_t i = start_index;
             while (i != 0) {
@@ -515,7 +817,7 @@ namespace mpp {
             return npos;
         }
 
-        size_t rfind(string_ref str) const {
+        constexpr size_t rfind(string_ref str) const {
             size_t N = str.size();
             if (N > _length) {
                 return npos;
@@ -543,11 +845,19 @@ namespace mpp {
             return npos;
         }
 
-        size_t find_first_of(char C, size_t From = 0) const {
+        constexpr size_t find_first_of(char C, size_t From = 0) const {
             return find(C, From);
         }
 
-        size_t find_first_of(string_ref chars, size_t start_index = 0) const {
+        constexpr size_t find_first_of(string_ref chars, size_t start_index = 0) const {
+            if (!mpp_impl::is_runtime()) {
+                for (size_type i = std::min(start_index, _length); i != _length; ++i) {
+                    if (chars.find(_data[i]) != npos) {
+                        return i;
+                    }
+                }
+                return npos;
+            }
             std::bitset<1 << CHAR_BIT> char_bits;
             for (size_type i = 0; i != chars.size(); ++i) {
                 char_bits.set((unsigned char) chars[i]);
@@ -561,7 +871,7 @@ namespace mpp {
             return npos;
         }
 
-        size_t find_first_not_of(char c, size_t start_index = 0) const {
+        constexpr size_t find_first_not_of(char c, size_t start_index = 0) const {
             for (size_type i = std::min(start_index, _length); i != _length; ++i) {
                 if (_data[i] != c) {
                     return i;
@@ -570,7 +880,15 @@ namespace mpp {
             return npos;
         }
 
-        size_t find_first_not_of(string_ref chars, size_t start_index = 0) const {
+        constexpr size_t find_first_not_of(string_ref chars, size_t start_index = 0) const {
+            if (!mpp_impl::is_runtime()) {
+                for (size_type i = std::min(start_index, _length); i != _length; ++i) {
+                    if (chars.find(_data[i]) == npos) {
+                        return i;
+                    }
+                }
+                return npos;
+            }
             std::bitset<1 << CHAR_BIT> char_bits;
             for (size_type i = 0; i != chars.size(); ++i) {
                 char_bits.set((unsigned char) chars[i]);
@@ -584,11 +902,19 @@ namespace mpp {
             return npos;
         }
 
-        size_t find_last_of(char c, size_t start_index = npos) const {
+        constexpr size_t find_last_of(char c, size_t start_index = npos) const {
             return rfind(c, start_index);
         }
 
-        size_t find_last_of(string_ref chars, size_t start_index = npos) const {
+        constexpr size_t find_last_of(string_ref chars, size_t start_index = npos) const {
+            if (!mpp_impl::is_runtime()) {
+                for (size_type i = std::min(start_index, _length) - 1; i != npos; --i) {
+                    if (chars.find(_data[i]) != npos) {
+                        return i;
+                    }
+                }
+                return npos;
+            }
             std::bitset<1 << CHAR_BIT> char_bits;
             for (size_type i = 0; i != chars.size(); ++i) {
                 char_bits.set((unsigned char) chars[i]);
@@ -602,7 +928,7 @@ namespace mpp {
             return npos;
         }
 
-        size_t find_last_not_of(char c, size_t start_index = npos) const {
+        constexpr size_t find_last_not_of(char c, size_t start_index = npos) const {
             for (size_type i = std::min(start_index, _length) - 1; i != -1; --i) {
                 if (_data[i] != c) {
                     return i;
@@ -611,7 +937,15 @@ namespace mpp {
             return npos;
         }
 
-        size_t find_last_not_of(string_ref chars, size_t start_index = npos) const {
+        constexpr size_t find_last_not_of(string_ref chars, size_t start_index = npos) const {
+            if (!mpp_impl::is_runtime()) {
+                for (size_type i = std::min(start_index, _length) - 1; i != npos; --i) {
+                    if (chars.find(_data[i]) == npos) {
+                        return i;
+                    }
+                }
+                return npos;
+            }
             std::bitset<1 << CHAR_BIT> char_bits;
             for (size_type i = 0, e = chars.size(); i != e; ++i) {
                 char_bits.set((unsigned char) chars[i]);
@@ -625,9 +959,9 @@ namespace mpp {
             return npos;
         }
 
-        bool contains(string_ref other) const { return find(other) != npos; }
+        constexpr bool contains(string_ref other) const { return find(other) != npos; }
 
-        bool contains(char c) const { return find_first_of(c) != npos; }
+        constexpr bool contains(char c) const { return find_first_of(c) != npos; }
 
         bool contains_ignore_case(string_ref other) const {
             return find_ignore_case(other) != npos;
@@ -635,7 +969,7 @@ namespace mpp {
 
         bool contains_ignore_case(char c) const { return find_ignore_case(c) != npos; }
 
-        size_t count(char c) const {
+        constexpr size_t count(char c) const {
             size_t count = 0;
             for (size_t i = 0; i != _length; ++i) {
                 if (_data[i] == c) {
@@ -645,7 +979,7 @@ namespace mpp {
             return count;
         }
 
-        size_t count(string_ref str) const {
+        constexpr size_t count(string_ref str) const {
             size_t count = 0;
             size_t N = str.size();
             if (N > _length) {
@@ -661,7 +995,16 @@ namespace mpp {
 
         // Convert the given ASCII string to lowercase.
         std::string lower() const {
-            std::string result(size(), char());
+            return lower(std::allocator<char>());
+        }
+
+        // Convert the given ASCII string to lowercase, allocated by alloc.
+        template <typename Alloc>
+        alloc_string<Alloc> lower(const Alloc &alloc) const {
+            using string_type = alloc_string<Alloc>;
+            MOZART_STRING_PROBE(case_convert, _length);
+            string_type result(size(), char(), typename string_type::allocator_type(alloc));
+            MOZART_STRING_COUNT_ALLOCATIONS(case_convert, mpp_impl::heap_allocated(result));
             for (size_type i = 0, e = size(); i != e; ++i) {
                 result[i] = std::tolower(_data[i]);
             }
@@ -670,7 +1013,16 @@ namespace mpp {
 
         /// Convert the given ASCII string to uppercase.
         std::string upper() const {
-            std::string result(size(), char());
+            return upper(std::allocator<char>());
+        }
+
+        /// Convert the given ASCII string to uppercase, allocated by alloc.
+        template <typename Alloc>
+        alloc_string<Alloc> upper(const Alloc &alloc) const {
+            using string_type = alloc_string<Alloc>;
+            MOZART_STRING_PROBE(case_convert, _length);
+            string_type result(size(), char(), typename string_type::allocator_type(alloc));
+            MOZART_STRING_COUNT_ALLOCATIONS(case_convert, mpp_impl::heap_allocated(result));
             for (size_type i = 0, e = size(); i != e; ++i) {
                 result[i] = std::toupper(_data[i]);
             }
@@ -689,7 +1041,7 @@ namespace mpp {
          *
          * @return
          */
-        string_ref substr(size_t start_index, size_t N = npos) const {
+        constexpr string_ref substr(size_t start_index, size_t N = npos) const {
             start_index = std::min(start_index, _length);
             return string_ref{_data + start_index,
                               std::min(N, _length - start_index)};
@@ -703,7 +1055,7 @@ namespace mpp {
          * @param N
          * @return
          */
-        string_ref take_front(size_t N = 1) const {
+        constexpr string_ref take_front(size_t N = 1) const {
             if (N >= size())
                 return *this;
             return drop_back(size() - N);
@@ -717,7 +1069,7 @@ namespace mpp {
          * @param N
          * @return
          */
-        string_ref take_back(size_t N = 1) const {
+        constexpr string_ref take_back(size_t N = 1) const {
             if (N >= size())
                 return *this;
             return drop_front(size() - N);
@@ -752,7 +1104,7 @@ namespace mpp {
          * @param N
          * @return
          */
-        string_ref drop_front(size_t N = 1) const {
+        constexpr string_ref drop_front(size_t N = 1) const {
             if (size() < N) {
                 mpp::throw_ex<mpp::runtime_error>(
                         "string_ref: Dropping more elements than exist");
@@ -767,7 +1119,7 @@ namespace mpp {
          * @param N
          * @return
          */
-        string_ref drop_back(size_t N = 1) const {
+        constexpr string_ref drop_back(size_t N = 1) const {
             if (size() < N) {
                 mpp::throw_ex<mpp::runtime_error>(
                         "string_ref: Dropping more elements than exist");
@@ -811,7 +1163,7 @@ namespace mpp {
          *
          * @return
          */
-        string_ref slice(size_t start, size_t end) const {
+        constexpr string_ref slice(size_t start, size_t end) const {
             start = std::min(start, _length);
             end = std::min(std::max(start, end), _length);
             return string_ref{_data + start, end - start};
@@ -829,11 +1181,11 @@ namespace mpp {
          * @param separator
          * @return
          */
-        std::pair<string_ref, string_ref> split(char separator) const {
+        constexpr std::pair<string_ref, string_ref> split(char separator) const {
             return split(string_ref(&separator, 1));
         }
 
-        std::pair<string_ref, string_ref> split(string_ref separator) const {
+        constexpr std::pair<string_ref, string_ref> split(string_ref separator) const {
             size_t index = find(separator);
             if (index == npos) {
                 return std::make_pair(*this, string_ref());
@@ -854,11 +1206,11 @@ namespace mpp {
          * @param separator
          * @return
          */
-        std::pair<string_ref, string_ref> rsplit(char separator) const {
+        constexpr std::pair<string_ref, string_ref> rsplit(char separator) const {
             return rsplit(string_ref(&separator, 1));
         }
 
-        std::pair<string_ref, string_ref> rsplit(string_ref separator) const {
+        constexpr std::pair<string_ref, string_ref> rsplit(string_ref separator) const {
             size_t index = rfind(separator);
             if (index == npos) {
                 return std::make_pair(*this, string_ref());
@@ -878,14 +1230,17 @@ namespace mpp {
          * An useful invariant is that
          * separator.join(result) == *this if max_split == -1 and keep_empty == true
          *
-         * @param result Where to put the substrings.
+         * @param result Where to put the substrings, a vector with any allocator.
          * @param separator The string to split on.
          * @param max_split  The maximum number of times the string is split.
          * @param keep_empty True if empty substring should be added.
          */
-        void split(std::vector<string_ref> &result,
+        template <typename Alloc>
+        void split(std::vector<string_ref, Alloc> &result,
                    string_ref separator, int max_split = -1,
                    bool keep_empty = true) const {
+            MOZART_STRING_PROBE(split, _length);
+            MOZART_STRING_WATCH_CAPACITY(split, result);
             string_ref str = *this;
 
             while (max_split-- != 0) {
@@ -908,8 +1263,11 @@ namespace mpp {
             }
         }
 
-        void split(std::vector<string_ref> &result, char separator, int max_split = -1,
+        template <typename Alloc>
+        void split(std::vector<string_ref, Alloc> &result, char separator, int max_split = -1,
                    bool keep_empty = true) const {
+            MOZART_STRING_PROBE(split, _length);
+            MOZART_STRING_WATCH_CAPACITY(split, result);
             string_ref str = *this;
 
             while (max_split-- != 0) {
@@ -933,27 +1291,27 @@ namespace mpp {
             }
         }
 
-        string_ref ltrim(char chars) const {
+        constexpr string_ref ltrim(char chars) const {
             return drop_front(std::min(_length, find_first_not_of(chars)));
         }
 
-        string_ref ltrim(string_ref chars = " \t\n\v\f\r") const {
+        constexpr string_ref ltrim(string_ref chars = " \t\n\v\f\r") const {
             return drop_front(std::min(_length, find_first_not_of(chars)));
         }
 
-        string_ref rtrim(char chars) const {
+        constexpr string_ref rtrim(char chars) const {
             return drop_back(_length - std::min(_length, find_last_not_of(chars) + 1));
         }
 
-        string_ref rtrim(string_ref chars = " \t\n\v\f\r") const {
+        constexpr string_ref rtrim(string_ref chars = " \t\n\v\f\r") const {
             return drop_back(_length - std::min(_length, find_last_not_of(chars) + 1));
         }
 
-        string_ref trim(char chars) const {
+        constexpr string_ref trim(char chars) const {
             return ltrim(chars).rtrim(chars);
         }
 
-        string_ref trim(string_ref chars = " \t\n\v\f\r") const {
+        constexpr string_ref trim(string_ref chars = " \t\n\v\f\r") const {
             return ltrim(chars).rtrim(chars);
         }
 
@@ -0,0 +1,627 @@
+/**
+ * Mozart++ Template Library: String
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#pragma once
+
+#include <mozart++/core>
+#include <mozart++/string>
+#include <mozart++/format>
+#include <mozart++/string_pool>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#ifdef MOZART_PLATFORM_UNIX
+#include <sys/uio.h>
+#endif
+
+namespace mpp_impl {
+    static constexpr char digit_pairs[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+    /**
+     * Buffer size enough for any integer or double written below.
+     */
+    static constexpr size_t number_buffer_size = 32;
+
+    /**
+     * Geometric growth of string_builder chunks stops here.
+     */
+    static constexpr size_t builder_max_chunk_size = 16 * 1024 * 1024;
+
+    /**
+     * Write the decimal digits of value so that they end at end,
+     * two digits per step.
+     *
+     * @return the first digit
+     */
+    inline char *write_uint(char *end, std::uint64_t value) {
+        while (value >= 100) {
+            unsigned pair = static_cast<unsigned>(value % 100) * 2;
+            value /= 100;
+            *--end = digit_pairs[pair + 1];
+            *--end = digit_pairs[pair];
+        }
+        if (value >= 10) {
+            unsigned pair = static_cast<unsigned>(value) * 2;
+            *--end = digit_pairs[pair + 1];
+            *--end = digit_pairs[pair];
+        } else {
+            *--end = static_cast<char>('0' + value);
+        }
+        return end;
+    }
+
+    inline char *write_int(char *end, std::int64_t value) {
+        if (value >= 0) {
+            return write_uint(end, static_cast<std::uint64_t>(value));
+        }
+        // negate in unsigned arithmetic, INT64_MIN has no positive counterpart
+        char *begin = write_uint(end, ~static_cast<std::uint64_t>(value) + 1);
+        *--begin = '-';
+        return begin;
+    }
+
+    /**
+     * A floating point number f * 2^e with a 64-bit significand, what the
+     * Grisu digit generation below computes with.
+     */
+    struct diy_fp {
+        std::uint64_t f;
+        int e;
+    };
+
+    /**
+     * The product of two diy_fps, rounded to the upper 64 bits.
+     */
+    inline diy_fp diy_fp_multiply(diy_fp x, diy_fp y) {
+        constexpr std::uint64_t low32 = 0xFFFFFFFFu;
+        std::uint64_t a = x.f >> 32, b = x.f & low32;
+        std::uint64_t c = y.f >> 32, d = y.f & low32;
+        std::uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+        std::uint64_t middle = (bd >> 32) + (ad & low32) + (bc & low32) + (std::uint64_t(1) << 31);
+        return diy_fp{ac + (ad >> 32) + (bc >> 32) + (middle >> 32), x.e + y.e + 64};
+    }
+
+    inline diy_fp diy_fp_normalize(diy_fp x) {
+        while ((x.f & (std::uint64_t(1) << 63)) == 0) {
+            x.f <<= 1;
+            --x.e;
+        }
+        return x;
+    }
+
+    /**
+     * 10^k for k = -348, -340, ... 340 as f * 2^e, rounded to nearest.
+     */
+    struct cached_power {
+        std::uint64_t f;
+        int e;
+        int k;
+    };
+
+    inline const cached_power &cached_power_for(int min_exponent) {
+        static constexpr cached_power powers[] = {
+            {0xfa8fd5a0081c0288ull, -1220, -348}, {0xbaaee17fa23ebf76ull, -1193, -340},
+            {0x8b16fb203055ac76ull, -1166, -332}, {0xcf42894a5dce35eaull, -1140, -324},
+            {0x9a6bb0aa55653b2dull, -1113, -316}, {0xe61acf033d1a45dfull, -1087, -308},
+            {0xab70fe17c79ac6caull, -1060, -300}, {0xff77b1fcbebcdc4full, -1034, -292},
+            {0xbe5691ef416bd60cull, -1007, -284}, {0x8dd01fad907ffc3cull, -980, -276},
+            {0xd3515c2831559a83ull, -954, -268}, {0x9d71ac8fada6c9b5ull, -927, -260},
+            {0xea9c227723ee8bcbull, -901, -252}, {0xaecc49914078536dull, -874, -244},
+            {0x823c12795db6ce57ull, -847, -236}, {0xc21094364dfb5637ull, -821, -228},
+            {0x9096ea6f3848984full, -794, -220}, {0xd77485cb25823ac7ull, -768, -212},
+            {0xa086cfcd97bf97f4ull, -741, -204}, {0xef340a98172aace5ull, -715, -196},
+            {0xb23867fb2a35b28eull, -688, -188}, {0x84c8d4dfd2c63f3bull, -661, -180},
+            {0xc5dd44271ad3cdbaull, -635, -172}, {0x936b9fcebb25c996ull, -608, -164},
+            {0xdbac6c247d62a584ull, -582, -156}, {0xa3ab66580d5fdaf6ull, -555, -148},
+            {0xf3e2f893dec3f126ull, -529, -140}, {0xb5b5ada8aaff80b8ull, -502, -132},
+            {0x87625f056c7c4a8bull, -475, -124}, {0xc9bcff6034c13053ull, -449, -116},
+            {0x964e858c91ba2655ull, -422, -108}, {0xdff9772470297ebdull, -396, -100},
+            {0xa6dfbd9fb8e5b88full, -369, -92}, {0xf8a95fcf88747d94ull, -343, -84},
+            {0xb94470938fa89bcfull, -316, -76}, {0x8a08f0f8bf0f156bull, -289, -68},
+            {0xcdb02555653131b6ull, -263, -60}, {0x993fe2c6d07b7facull, -236, -52},
+            {0xe45c10c42a2b3b06ull, -210, -44}, {0xaa242499697392d3ull, -183, -36},
+            {0xfd87b5f28300ca0eull, -157, -28}, {0xbce5086492111aebull, -130, -20},
+            {0x8cbccc096f5088ccull, -103, -12}, {0xd1b71758e219652cull, -77, -4},
+            {0x9c40000000000000ull, -50, 4}, {0xe8d4a51000000000ull, -24, 12},
+            {0xad78ebc5ac620000ull, 3, 20}, {0x813f3978f8940984ull, 30, 28},
+            {0xc097ce7bc90715b3ull, 56, 36}, {0x8f7e32ce7bea5c70ull, 83, 44},
+            {0xd5d238a4abe98068ull, 109, 52}, {0x9f4f2726179a2245ull, 136, 60},
+            {0xed63a231d4c4fb27ull, 162, 68}, {0xb0de65388cc8ada8ull, 189, 76},
+            {0x83c7088e1aab65dbull, 216, 84}, {0xc45d1df942711d9aull, 242, 92},
+            {0x924d692ca61be758ull, 269, 100}, {0xda01ee641a708deaull, 295, 108},
+            {0xa26da3999aef774aull, 322, 116}, {0xf209787bb47d6b85ull, 348, 124},
+            {0xb454e4a179dd1877ull, 375, 132}, {0x865b86925b9bc5c2ull, 402, 140},
+            {0xc83553c5c8965d3dull, 428, 148}, {0x952ab45cfa97a0b3ull, 455, 156},
+            {0xde469fbd99a05fe3ull, 481, 164}, {0xa59bc234db398c25ull, 508, 172},
+            {0xf6c69a72a3989f5cull, 534, 180}, {0xb7dcbf5354e9beceull, 561, 188},
+            {0x88fcf317f22241e2ull, 588, 196}, {0xcc20ce9bd35c78a5ull, 614, 204},
+            {0x98165af37b2153dfull, 641, 212}, {0xe2a0b5dc971f303aull, 667, 220},
+            {0xa8d9d1535ce3b396ull, 694, 228}, {0xfb9b7cd9a4a7443cull, 720, 236},
+            {0xbb764c4ca7a44410ull, 747, 244}, {0x8bab8eefb6409c1aull, 774, 252},
+            {0xd01fef10a657842cull, 800, 260}, {0x9b10a4e5e9913129ull, 827, 268},
+            {0xe7109bfba19c0c9dull, 853, 276}, {0xac2820d9623bf429ull, 880, 284},
+            {0x80444b5e7aa7cf85ull, 907, 292}, {0xbf21e44003acdd2dull, 933, 300},
+            {0x8e679c2f5e44ff8full, 960, 308}, {0xd433179d9c8cb841ull, 986, 316},
+            {0x9e19db92b4e31ba9ull, 1013, 324}, {0xeb96bf6ebadf77d9ull, 1039, 332},
+            {0xaf87023b9bf0ee6bull, 1066, 340},
+        };
+        // the first power whose binary exponent is at least min_exponent
+        auto k = static_cast<int>(std::ceil((min_exponent + 63) * 0.30102999566398114));
+        return powers[(348 + k - 1) / 8 + 1];
+    }
+
+    /**
+     * Give up on the last digit unless it is the closest to the scaled
+     * value and safely inside the rounding interval (Grisu3's round_weed).
+     */
+    inline bool grisu_round_weed(char *digits, int length, std::uint64_t distance_too_high_w,
+                                 std::uint64_t unsafe_interval, std::uint64_t rest, std::uint64_t ten_kappa,
+                                 std::uint64_t unit) {
+        std::uint64_t small_distance = distance_too_high_w - unit;
+        std::uint64_t big_distance = distance_too_high_w + unit;
+        while (rest < small_distance && unsafe_interval - rest >= ten_kappa
+               && (rest + ten_kappa < small_distance || small_distance - rest >= rest + ten_kappa - small_distance)) {
+            --digits[length - 1];
+            rest += ten_kappa;
+        }
+        if (rest < big_distance && unsafe_interval - rest >= ten_kappa
+            && (rest + ten_kappa < big_distance || big_distance - rest > rest + ten_kappa - big_distance)) {
+            return false;
+        }
+        return 2 * unit <= rest && rest <= unsafe_interval - 4 * unit;
+    }
+
+    /**
+     * Grisu3: the shortest digits of a positive finite double, from 64-bit
+     * integer arithmetic alone, or false in the rare cases it cannot
+     * prove them shortest and correctly rounded.
+     *
+     * @param digits at least 17 chars
+     * @param length number of digits written
+     * @param exponent value is digits * 10^exponent
+     */
+    inline bool grisu3(double value, char *digits, int &length, int &exponent) {
+        std::uint64_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(bits));
+        constexpr std::uint64_t hidden_bit = std::uint64_t(1) << 52;
+        std::uint64_t fraction = bits & (hidden_bit - 1);
+        auto biased = static_cast<int>(bits >> 52);
+        diy_fp v = biased == 0 ? diy_fp{fraction, -1074} : diy_fp{fraction + hidden_bit, biased - 1075};
+
+        // the halfway points to the neighbouring doubles
+        diy_fp plus = diy_fp_normalize(diy_fp{(v.f << 1) + 1, v.e - 1});
+        diy_fp minus = fraction == 0 && biased > 1 ? diy_fp{(v.f << 2) - 1, v.e - 2} : diy_fp{(v.f << 1) - 1, v.e - 1};
+        minus.f <<= minus.e - plus.e;
+        minus.e = plus.e;
+        diy_fp w = diy_fp_normalize(v);
+
+        // scale into [2^-60, 2^-32) binary exponents
+        const cached_power &power = cached_power_for(-60 - (w.e + 64));
+        diy_fp ten_k{power.f, power.e};
+        w = diy_fp_multiply(w, ten_k);
+        diy_fp low = diy_fp_multiply(minus, ten_k);
+        diy_fp high = diy_fp_multiply(plus, ten_k);
+
+        std::uint64_t unit = 1;
+        std::uint64_t too_low = low.f - unit;
+        std::uint64_t too_high = high.f + unit;
+        std::uint64_t unsafe_interval = too_high - too_low;
+        int shift = -w.e;
+        std::uint64_t one = std::uint64_t(1) << shift;
+        auto integrals = static_cast<std::uint32_t>(too_high >> shift);
+        std::uint64_t fractionals = too_high & (one - 1);
+
+        std::uint32_t divisor = 1;
+        int kappa = 0;
+        if (integrals != 0) {
+            for (kappa = 1; integrals / divisor >= 10; ++kappa) {
+                divisor *= 10;
+            }
+        }
+        length = 0;
+        while (kappa > 0) {
+            digits[length++] = static_cast<char>('0' + integrals / divisor);
+            integrals %= divisor;
+            --kappa;
+            std::uint64_t rest = (static_cast<std::uint64_t>(integrals) << shift) + fractionals;
+            if (rest < unsafe_interval) {
+                exponent = kappa - power.k;
+                return grisu_round_weed(digits, length, too_high - w.f, unsafe_interval, rest,
+                                        static_cast<std::uint64_t>(divisor) << shift, unit);
+            }
+            divisor /= 10;
+        }
+        for (;;) {
+            fractionals *= 10;
+            unit *= 10;
+            unsafe_interval *= 10;
+            digits[length++] = static_cast<char>('0' + (fractionals >> shift));
+            fractionals &= one - 1;
+            --kappa;
+            if (fractionals < unsafe_interval) {
+                exponent = kappa - power.k;
+                return grisu_round_weed(digits, length, (too_high - w.f) * unit, unsafe_interval, fractionals,
+                                        one, unit);
+            }
+        }
+    }
+
+    /**
+     * The shortest digits of a positive finite double that read back
+     * exactly: Grisu3, falling back to printf() for the few values it
+     * rejects (digits and exponent only, so the locale does not matter).
+     *
+     * @param digits at least 17 chars
+     * @param point the decimal exponent of the first digit
+     * @return the number of digits
+     */
+    inline int shortest_digits(double value, char *digits, int &point) {
+        int length = 0;
+        int exponent = 0;
+        if (grisu3(value, digits, length, exponent)) {
+            point = exponent + length - 1;
+            return length;
+        }
+        char text[number_buffer_size];
+        for (int precision = 15; precision <= 17; ++precision) {
+            std::snprintf(text, sizeof(text), "%.*e", precision - 1, value);
+            if (precision == 17 || std::strtod(text, nullptr) == value) {
+                break;
+            }
+        }
+        const char *p = text;
+        for (length = 0; *p != 'e'; ++p) {
+            if (*p >= '0' && *p <= '9') {
+                digits[length++] = *p;
+            }
+        }
+        point = std::atoi(p + 1);
+        while (length > 1 && digits[length - 1] == '0') {
+            --length;
+        }
+        return length;
+    }
+
+    /**
+     * Write the shortest form of value that reads back exactly, laid out
+     * as printf("%g") would with just enough precision: plain notation
+     * for decimal exponents from -4 below the precision, scientific
+     * otherwise. Unlike printf() the decimal point is always '.'.
+     *
+     * @return the number of chars written to buf
+     */
+    inline size_t write_double(char *buf, double value) {
+        char *p = buf;
+        if (std::signbit(value)) {
+            *p++ = '-';
+            value = -value;
+        }
+        if (value == 0 || !(value <= std::numeric_limits<double>::max())) {
+            const char *text = value == 0 ? "0" : value != value ? "nan" : "inf";
+            size_t n = std::strlen(text);
+            std::memcpy(p, text, n);
+            return static_cast<size_t>(p - buf) + n;
+        }
+
+        char digits[20];
+        int point = 0;
+        int length = shortest_digits(value, digits, point);
+        if (point < -4 || point >= std::max(length, 15)) {
+            *p++ = digits[0];
+            if (length > 1) {
+                *p++ = '.';
+                std::memcpy(p, digits + 1, static_cast<size_t>(length - 1));
+                p += length - 1;
+            }
+            *p++ = 'e';
+            *p++ = point < 0 ? '-' : '+';
+            // at least two exponent digits, like printf()
+            auto magnitude = static_cast<unsigned>(point < 0 ? -point : point);
+            if (magnitude < 10) {
+                *p++ = '0';
+            }
+            char exponent[4];
+            char *end = exponent + sizeof(exponent);
+            char *begin = write_uint(end, magnitude);
+            std::memcpy(p, begin, static_cast<size_t>(end - begin));
+            p += end - begin;
+        } else if (point < 0) {
+            *p++ = '0';
+            *p++ = '.';
+            std::memset(p, '0', static_cast<size_t>(-point - 1));
+            p += -point - 1;
+            std::memcpy(p, digits, static_cast<size_t>(length));
+            p += length;
+        } else if (length <= point + 1) {
+            std::memcpy(p, digits, static_cast<size_t>(length));
+            p += length;
+            std::memset(p, '0', static_cast<size_t>(point + 1 - length));
+            p += point + 1 - length;
+        } else {
+            std::memcpy(p, digits, static_cast<size_t>(point + 1));
+            p += point + 1;
+            *p++ = '.';
+            std::memcpy(p, digits + point + 1, static_cast<size_t>(length - point - 1));
+            p += length - point - 1;
+        }
+        return static_cast<size_t>(p - buf);
+    }
+}
+
+namespace mpp {
+    /**
+     * An append-only string buffer made of geometrically growing chunks.
+     *
+     * Appending never moves data that has already been written: when the
+     * current chunk is full a new, larger one is started. A builder that
+     * stayed within its first chunk hands the chunk over to take() without
+     * copying, otherwise the chunks are joined with exactly one copy, or
+     * can be written out in place with writev() through iovecs().
+     */
+    class string_builder {
+    private:
+        // A chunk is a string reserved to its capacity and appended to,
+        // so its bytes are only written once, by the append.
+        std::vector<std::string> _chunks;
+        size_t _size = 0;
+        size_t _next_capacity;
+
+        std::string &current() { return _chunks.back(); }
+
+        size_t available() const {
+            return _chunks.empty() ? 0 : _chunks.back().capacity() - _chunks.back().size();
+        }
+
+        void add_chunk(size_t n) {
+            size_t capacity = std::max(n, _next_capacity);
+            _next_capacity = std::min(capacity * 2, std::max(mpp_impl::builder_max_chunk_size, capacity));
+            _chunks.emplace_back();
+            current().reserve(capacity);
+        }
+
+        /**
+         * Make room for n contiguous chars.
+         */
+        std::string &prepare(size_t n) {
+            if (available() < n) {
+                add_chunk(n);
+            }
+            _size += n;
+            return current();
+        }
+
+    public:
+        /**
+         * @param initial_capacity size of the first chunk
+         */
+        explicit string_builder(size_t initial_capacity = 256)
+                : _next_capacity(std::max<size_t>(initial_capacity, 16)) {}
+
+        /**
+         * Make sure the next estimate chars fit in the current chunk,
+         * so that they end up contiguous.
+         *
+         * @param estimate
+         */
+        void reserve(size_t estimate) {
+            if (available() < estimate) {
+                add_chunk(estimate);
+            }
+        }
+
+        string_builder &append(string_ref str) {
+            size_t n = str.size();
+            size_t room = available();
+            if (n > room) {
+                // fill up the current chunk before starting a new one
+                if (room != 0) {
+                    prepare(room).append(str.data(), room);
+                    str = str.drop_front(room);
+                    n -= room;
+                }
+                add_chunk(n);
+            }
+            if (n != 0) {
+                prepare(n).append(str.data(), n);
+            }
+            return *this;
+        }
+
+        string_builder &append(char c) {
+            prepare(1).push_back(c);
+            return *this;
+        }
+
+        string_builder &append(size_t count, char c) {
+            prepare(count).append(count, c);
+            return *this;
+        }
+
+        /**
+         * Append an integer in decimal.
+         */
+        template <typename T, typename std::enable_if<std::is_integral<T>::value
+                                                      && !std::is_same<T, char>::value
+                                                      && !std::is_same<T, bool>::value, int>::type = 0>
+        string_builder &append(T value) {
+            char buf[mpp_impl::number_buffer_size];
+            char *end = buf + sizeof(buf);
+            char *begin = std::is_signed<T>::value
+                          ? mpp_impl::write_int(end, static_cast<std::int64_t>(value))
+                          : mpp_impl::write_uint(end, static_cast<std::uint64_t>(value));
+            return append(string_ref{begin, static_cast<size_t>(end - begin)});
+        }
+
+        /**
+         * Append a floating point number in its shortest round-trip form.
+         */
+        template <typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+        string_builder &append(T value) {
+            char buf[mpp_impl::number_buffer_size];
+            size_t n = mpp_impl::write_double(buf, static_cast<double>(value));
+            return append(string_ref{buf, n});
+        }
+
+        string_builder &append(bool value) {
+            return append(value ? string_ref("true") : string_ref("false"));
+        }
+
+        /**
+         * Append the output of mpp::format(fmt, args...).
+         * The fragment is formatted through a reused thread-local stream.
+         */
+        template <typename ...Args>
+        string_builder &append_format(const std::string &fmt, Args &&... args) {
+            static thread_local std::stringstream out;
+            out.str(std::string());
+            out.clear();
+            mpp_impl::format(out, fmt, std::forward<Args>(args)...);
+            return append(out.str());
+        }
+
+        template <typename T>
+        string_builder &operator<<(T &&value) {
+            return append(std::forward<T>(value));
+        }
+
+        string_builder &operator<<(const char *str) {
+            return append(string_ref::with(str));
+        }
+
+        string_builder &operator<<(const std::string &str) {
+            return append(string_ref(str));
+        }
+
+        size_t size() const { return _size; }
+
+        bool empty() const { return _size == 0; }
+
+        size_t chunk_count() const { return _chunks.size(); }
+
+        /**
+         * Drop the contents, keeping the first chunk for reuse.
+         */
+        void clear() {
+            if (_chunks.size() > 1) {
+                _chunks.resize(1);
+            }
+            if (!_chunks.empty()) {
+                current().clear();
+            }
+            _size = 0;
+        }
+
+        /**
+         * Get the written pieces in order, valid until the builder changes.
+         *
+         * @return one string_ref per chunk
+         */
+        std::vector<string_ref> pieces() const {
+            std::vector<string_ref> result;
+            result.reserve(_chunks.size());
+            for (const auto &c : _chunks) {
+                if (!c.empty()) {
+                    result.emplace_back(c.data(), c.size());
+                }
+            }
+            return result;
+        }
+
+#ifdef MOZART_PLATFORM_UNIX
+        /**
+         * Get the written pieces as an iovec array for writev(),
+         * valid until the builder changes.
+         *
+         * @return one iovec per chunk
+         */
+        std::vector<struct iovec> iovecs() const {
+            std::vector<struct iovec> result;
+            result.reserve(_chunks.size());
+            for (const auto &c : _chunks) {
+                if (!c.empty()) {
+                    struct iovec vec;
+                    vec.iov_base = const_cast<char *>(c.data());
+                    vec.iov_len = c.size();
+                    result.push_back(vec);
+                }
+            }
+            return result;
+        }
+#endif
+
+        /**
+         * Copy the contents into a new string.
+         *
+         * @return
+         */
+        std::string str() const {
+            std::string result;
+            result.reserve(_size);
+            for (const auto &c : _chunks) {
+                result.append(c);
+            }
+            return result;
+        }
+
+        /**
+         * Move the contents out, leaving the builder empty.
+         * A single chunk is handed over without copying.
+         *
+         * @return
+         */
+        std::string take() {
+            std::string result;
+            if (_chunks.size() == 1) {
+                result = std::move(current());
+            } else {
+                result = str();
+            }
+            _chunks.clear();
+            _size = 0;
+            return result;
+        }
+
+        /**
+         * Copy the contents into arena memory as one contiguous string.
+         *
+         * @param arena
+         * @return the copy, valid until the arena is cleared
+         */
+        string_ref str(string_arena &arena) const {
+            char *buffer = arena.allocate<char>(_size + 1);
+            char *p = buffer;
+            for (const auto &c : _chunks) {
+                if (!c.empty()) {
+                    std::memcpy(p, c.data(), c.size());
+                    p += c.size();
+                }
+            }
+            *p = '\0';
+            return string_ref{buffer, _size};
+        }
+    };
+}
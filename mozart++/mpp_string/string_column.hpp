@@ -0,0 +1,381 @@
+/**
+ * Mozart++ Template Library: String
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#pragma once
+
+#include <mozart++/core>
+#include <mozart++/string>
+#include "batch.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace mpp {
+    enum class column_encoding {
+        /**
+         * Every row stores its own bytes.
+         */
+        plain,
+        /**
+         * Every distinct value is stored once, rows are indices into them.
+         */
+        dictionary,
+    };
+
+    /**
+     * Strings stored one after another in a single buffer, in the layout
+     * of an Apache Arrow utf8 array: an int32 offsets array of size() + 1
+     * entries starting at 0, row i spanning [offsets[i], offsets[i + 1])
+     * of the data. A column of short strings costs 4 bytes per row plus
+     * the bytes themselves, against 16 for a string_ref to a separate
+     * buffer, and scans read memory in order.
+     *
+     * A dictionary encoded column (an Arrow dictionary array) keeps each
+     * distinct value once in that layout, and an int32 index per row:
+     * scans then test every distinct value once, and map the result
+     * through the indices.
+     *
+     * Rows are appended only. The string_refs handed out stay valid until
+     * the next append.
+     */
+    class string_column {
+    private:
+        using offset_type = std::int32_t;
+
+        column_encoding _encoding;
+        // the values, of the rows or of the dictionary
+        std::vector<offset_type> _offsets{0};
+        std::string _data;
+        // dictionary: the value of every row
+        std::vector<offset_type> _indices;
+        // dictionary: open addressing table from value hash to index + 1
+        std::vector<std::uint32_t> _slots;
+
+        string_ref value(size_t index) const {
+            return string_ref(_data.data() + _offsets[index],
+                              static_cast<size_t>(_offsets[index + 1] - _offsets[index]));
+        }
+
+        size_t value_count() const {
+            return _offsets.size() - 1;
+        }
+
+        void append_value(string_ref str) {
+            if (str.size() > static_cast<size_t>(std::numeric_limits<offset_type>::max()) - _data.size()) {
+                mpp::throw_ex<mpp::runtime_error>("string_column: more than 2 GiB of data");
+            }
+            _data.append(str.data(), str.size());
+            _offsets.push_back(static_cast<offset_type>(_data.size()));
+        }
+
+        void rehash(size_t capacity) {
+            _slots.assign(capacity, 0);
+            for (size_t id = 0; id < value_count(); ++id) {
+                size_t mask = capacity - 1;
+                size_t slot = value(id).hash() & mask;
+                while (_slots[slot] != 0) {
+                    slot = (slot + 1) & mask;
+                }
+                _slots[slot] = static_cast<std::uint32_t>(id + 1);
+            }
+        }
+
+        /**
+         * Find the index of a dictionary value.
+         *
+         * @return the index, or npos
+         */
+        size_t find_value(string_ref str) const {
+            if (_slots.empty()) {
+                return npos;
+            }
+            size_t mask = _slots.size() - 1;
+            for (size_t slot = str.hash() & mask;; slot = (slot + 1) & mask) {
+                std::uint32_t entry = _slots[slot];
+                if (entry == 0) {
+                    return npos;
+                }
+                if (value(entry - 1).equals(str)) {
+                    return entry - 1;
+                }
+            }
+        }
+
+        /**
+         * Find the index of a dictionary value, adding it if new.
+         */
+        size_t insert_value(string_ref str) {
+            if ((value_count() + 1) * 2 > _slots.size()) {
+                rehash(std::max<size_t>(16, _slots.size() * 2));
+            }
+            size_t mask = _slots.size() - 1;
+            for (size_t slot = str.hash() & mask;; slot = (slot + 1) & mask) {
+                std::uint32_t entry = _slots[slot];
+                if (entry == 0) {
+                    append_value(str);
+                    _slots[slot] = static_cast<std::uint32_t>(value_count());
+                    return value_count() - 1;
+                }
+                if (value(entry - 1).equals(str)) {
+                    return entry - 1;
+                }
+            }
+        }
+
+        /**
+         * Run a predicate over the values. Plain columns are done then,
+         * dictionary columns expand the selection of values to the rows.
+         */
+        template <typename Matcher>
+        size_t select(selection_bitmap &out, const Matcher &match) const {
+            selection_bitmap dictionary;
+            selection_bitmap &values = _encoding == column_encoding::plain ? out : dictionary;
+            values.resize(value_count());
+            std::uint64_t *bits = values.words();
+            for (size_t base = 0; base < value_count(); base += 64) {
+                size_t rows = std::min<size_t>(64, value_count() - base);
+                std::uint64_t word = 0;
+                for (size_t j = 0; j < rows; ++j) {
+                    word |= std::uint64_t(match(value(base + j))) << j;
+                }
+                bits[base / 64] = word;
+            }
+            return _encoding == column_encoding::plain ? values.count() : expand(values, out);
+        }
+
+        size_t expand(const selection_bitmap &values, selection_bitmap &out) const {
+            out.resize(_indices.size());
+            std::uint64_t *bits = out.words();
+            const std::uint64_t *value_bits = values.words();
+            size_t selected = 0;
+            for (size_t base = 0; base < _indices.size(); base += 64) {
+                size_t rows = std::min<size_t>(64, _indices.size() - base);
+                std::uint64_t word = 0;
+                for (size_t j = 0; j < rows; ++j) {
+                    auto index = static_cast<size_t>(_indices[base + j]);
+                    word |= ((value_bits[index / 64] >> (index % 64)) & 1) << j;
+                }
+                bits[base / 64] = word;
+                selected += mpp_impl::popcount64(word);
+            }
+            return selected;
+        }
+
+    public:
+        static constexpr size_t npos = string_ref::npos;
+
+        explicit string_column(column_encoding encoding = column_encoding::plain)
+                : _encoding(encoding) {}
+
+        template <typename Iter>
+        string_column(Iter first, Iter last, column_encoding encoding = column_encoding::plain)
+                : _encoding(encoding) {
+            for (; first != last; ++first) {
+                push_back(*first);
+            }
+        }
+
+        /**
+         * Append a row.
+         *
+         * @param str
+         */
+        void push_back(string_ref str) {
+            if (_encoding == column_encoding::plain) {
+                append_value(str);
+            } else {
+                _indices.push_back(static_cast<offset_type>(insert_value(str)));
+            }
+        }
+
+        /**
+         * Reserve room for rows and bytes of data, to append without reallocating.
+         */
+        void reserve(size_t rows, size_t bytes) {
+            if (_encoding == column_encoding::plain) {
+                _offsets.reserve(rows + 1);
+            } else {
+                _indices.reserve(rows);
+            }
+            _data.reserve(bytes);
+        }
+
+        size_t size() const {
+            return _encoding == column_encoding::plain ? value_count() : _indices.size();
+        }
+
+        bool empty() const { return size() == 0; }
+
+        string_ref operator[](size_t row) const {
+            return _encoding == column_encoding::plain ? value(row) : value(static_cast<size_t>(_indices[row]));
+        }
+
+        string_ref at(size_t row) const {
+            if (row >= size()) {
+                mpp::throw_ex<mpp::runtime_error>("string_column: row out of range");
+            }
+            return (*this)[row];
+        }
+
+        /**
+         * A string_ref to every row, for the APIs taking arrays of them.
+         */
+        std::vector<string_ref> refs() const {
+            std::vector<string_ref> result;
+            result.reserve(size());
+            for (size_t row = 0; row < size(); ++row) {
+                result.push_back((*this)[row]);
+            }
+            return result;
+        }
+
+        column_encoding encoding() const { return _encoding; }
+
+        /**
+         * Switch to dictionary encoding, worth it when the values repeat.
+         */
+        void encode_dictionary() {
+            if (_encoding == column_encoding::dictionary) {
+                return;
+            }
+            string_column encoded(column_encoding::dictionary);
+            encoded._indices.reserve(size());
+            for (size_t row = 0; row < size(); ++row) {
+                encoded.push_back(value(row));
+            }
+            *this = std::move(encoded);
+        }
+
+        /**
+         * Switch to plain encoding.
+         */
+        void decode_dictionary() {
+            if (_encoding == column_encoding::plain) {
+                return;
+            }
+            string_column decoded(column_encoding::plain);
+            size_t bytes = 0;
+            for (offset_type index : _indices) {
+                bytes += static_cast<size_t>(_offsets[index + 1] - _offsets[index]);
+            }
+            decoded.reserve(size(), bytes);
+            for (size_t row = 0; row < size(); ++row) {
+                decoded.push_back((*this)[row]);
+            }
+            *this = std::move(decoded);
+        }
+
+        /**
+         * The Arrow offsets buffer of the values: of the rows, or of the
+         * dictionary when encoded.
+         */
+        const offset_type *offsets() const { return _offsets.data(); }
+
+        /**
+         * The Arrow data buffer of the values.
+         */
+        const char *data() const { return _data.data(); }
+
+        size_t data_size() const { return _data.size(); }
+
+        /**
+         * The Arrow indices buffer of a dictionary encoded column, one per row.
+         */
+        const offset_type *indices() const { return _indices.data(); }
+
+        /**
+         * The number of distinct values of a dictionary encoded column.
+         */
+        size_t dictionary_size() const {
+            return _encoding == column_encoding::dictionary ? value_count() : 0;
+        }
+
+        string_ref dictionary_value(size_t index) const { return value(index); }
+
+        /**
+         * Bytes held by the buffers.
+         */
+        size_t memory_usage() const {
+            return _offsets.capacity() * sizeof(offset_type) + _data.capacity()
+                   + _indices.capacity() * sizeof(offset_type) + _slots.capacity() * sizeof(std::uint32_t);
+        }
+
+        /**
+         * Select the rows equal to needle.
+         *
+         * @param needle
+         * @param out bit i set if row i matches
+         * @return the number of rows selected
+         */
+        size_t equals(string_ref needle, selection_bitmap &out) const {
+            if (_encoding == column_encoding::plain) {
+                return select(out, mpp_impl::equal_matcher<false>(needle));
+            }
+            // one lookup, then a compare of the indices
+            out.resize(_indices.size());
+            size_t found = find_value(needle);
+            if (found == npos) {
+                std::fill(out.words(), out.words() + out.word_count(), 0);
+                return 0;
+            }
+            auto target = static_cast<offset_type>(found);
+            std::uint64_t *bits = out.words();
+            size_t selected = 0;
+            for (size_t base = 0; base < _indices.size(); base += 64) {
+                size_t rows = std::min<size_t>(64, _indices.size() - base);
+                std::uint64_t word = 0;
+                for (size_t j = 0; j < rows; ++j) {
+                    word |= std::uint64_t(_indices[base + j] == target) << j;
+                }
+                bits[base / 64] = word;
+                selected += mpp_impl::popcount64(word);
+            }
+            return selected;
+        }
+
+        /**
+         * Select the rows starting with prefix.
+         */
+        size_t starts_with(string_ref prefix, selection_bitmap &out) const {
+            return select(out, mpp_impl::prefix_matcher(prefix));
+        }
+
+        /**
+         * Select the rows containing needle.
+         *
+         * A plain column is searched as one buffer with string_ref::find(),
+         * each match being mapped back to its row through the offsets,
+         * rather than row by row.
+         */
+        size_t find(string_ref needle, selection_bitmap &out) const {
+            if (_encoding == column_encoding::dictionary || needle.empty()) {
+                return select(out, mpp_impl::contains_matcher(needle));
+            }
+            out.resize(size());
+            std::fill(out.words(), out.words() + out.word_count(), 0);
+            string_ref data(_data);
+            size_t selected = 0;
+            size_t row = 0;
+            for (size_t pos = data.find(needle); pos != npos; pos = data.find(needle, pos)) {
+                // the row the match starts in
+                row = static_cast<size_t>(std::upper_bound(_offsets.begin() + row + 1, _offsets.end(),
+                                                           static_cast<offset_type>(pos)) - _offsets.begin()) - 1;
+                if (pos + needle.size() <= static_cast<size_t>(_offsets[row + 1])) {
+                    out.set(row);
+                    ++selected;
+                }
+                // go on with the next row: after a match spanning two rows,
+                // every later one starting in this row spans them too
+                pos = static_cast<size_t>(_offsets[row + 1]);
+            }
+            return selected;
+        }
+    };
+}
@@ -0,0 +1,538 @@
+/**
+ * Mozart++ Template Library: String
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#pragma once
+
+#include <mozart++/core>
+#include <mozart++/string>
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace mpp {
+    /**
+     * A bump allocator handing out memory from large chunks.
+     * Memory is only released all at once, by clear() or destruction,
+     * so everything allocated here stays put for the lifetime of the arena.
+     *
+     * This is the Allocator expected by string_ref::copy(), and behind
+     * arena_allocator for the standard containers.
+     */
+    class string_arena {
+    private:
+        std::vector<std::unique_ptr<char[]>> _chunks;
+        // the caller's buffer used before any chunk, if any
+        char *_initial = nullptr;
+        size_t _initial_size = 0;
+        char *_cursor = nullptr;
+        size_t _available = 0;
+        size_t _chunk_size;
+        size_t _bytes_used = 0;
+        size_t _bytes_reserved = 0;
+
+        char *allocate_bytes(size_t size, size_t align) {
+            size_t padding = (align - reinterpret_cast<std::uintptr_t>(_cursor) % align) % align;
+            if (size + padding > _available) {
+                // Oversized requests get a chunk of their own.
+                size_t chunk = std::max(_chunk_size, size + align);
+                _chunks.emplace_back(new char[chunk]);
+                _cursor = _chunks.back().get();
+                _available = chunk;
+                _bytes_reserved += chunk;
+                padding = (align - reinterpret_cast<std::uintptr_t>(_cursor) % align) % align;
+            }
+            char *result = _cursor + padding;
+            _cursor += padding + size;
+            _available -= padding + size;
+            _bytes_used += size;
+            return result;
+        }
+
+        /**
+         * Take everything other holds, leaving it empty: the source of a
+         * move must not hand out the same memory again.
+         */
+        void take(string_arena &other) {
+            _chunks = std::move(other._chunks);
+            other._chunks.clear();
+            _initial = other._initial;
+            _initial_size = other._initial_size;
+            _cursor = other._cursor;
+            _available = other._available;
+            _chunk_size = other._chunk_size;
+            _bytes_used = other._bytes_used;
+            _bytes_reserved = other._bytes_reserved;
+            other._initial = nullptr;
+            other._initial_size = 0;
+            other._cursor = nullptr;
+            other._available = 0;
+            other._bytes_used = 0;
+            other._bytes_reserved = 0;
+        }
+
+    public:
+        explicit string_arena(size_t chunk_size = 64 * 1024)
+                : _chunk_size(chunk_size) {}
+
+        /**
+         * An arena that hands out buffer first, and only then allocates
+         * chunks from the heap: with a buffer large enough for the job,
+         * e.g. on the stack, the heap is never touched.
+         *
+         * @param buffer memory owned by the caller, outliving the arena
+         * @param size
+         * @param chunk_size
+         */
+        string_arena(char *buffer, size_t size, size_t chunk_size = 64 * 1024)
+                : _initial(buffer), _initial_size(size), _cursor(buffer), _available(size),
+                  _chunk_size(chunk_size) {}
+
+        string_arena(string_arena &&other) noexcept
+                : _chunk_size(other._chunk_size) {
+            take(other);
+        }
+
+        string_arena &operator=(string_arena &&other) noexcept {
+            if (this != &other) {
+                take(other);
+            }
+            return *this;
+        }
+
+        string_arena(const string_arena &) = delete;
+        string_arena &operator=(const string_arena &) = delete;
+
+        /**
+         * Allocate uninitialized room for n objects of type T.
+         *
+         * @tparam T a trivially destructible type
+         * @param n number of objects
+         * @return pointer to the memory, valid until clear()
+         */
+        template <typename T>
+        T *allocate(size_t n) {
+            return reinterpret_cast<T *>(allocate_bytes(n * sizeof(T), alignof(T)));
+        }
+
+        /**
+         * Release every chunk, invalidating all memory handed out.
+         * The initial buffer, if any, is reused.
+         */
+        void clear() {
+            _chunks.clear();
+            _cursor = _initial;
+            _available = _initial_size;
+            _bytes_used = 0;
+            _bytes_reserved = 0;
+        }
+
+        size_t bytes_used() const { return _bytes_used; }
+
+        size_t bytes_reserved() const { return _bytes_reserved; }
+
+        size_t chunk_count() const { return _chunks.size(); }
+    };
+
+    /**
+     * A standard allocator drawing from a string_arena, for containers and
+     * strings that live no longer than the arena, e.g. the results of
+     * string_ref::str(alloc), split() or mpp::format(std::allocator_arg, ...).
+     * Deallocation does nothing, the memory comes back on clear().
+     */
+    template <typename T>
+    class arena_allocator {
+    private:
+        string_arena *_arena;
+
+    public:
+        using value_type = T;
+
+        /*implicit*/ arena_allocator(string_arena &arena) : _arena(&arena) {}
+
+        template <typename U>
+        /*implicit*/ arena_allocator(const arena_allocator<U> &other) : _arena(other.arena()) {}
+
+        T *allocate(size_t n) {
+            return _arena->allocate<T>(n);
+        }
+
+        void deallocate(T *, size_t) {}
+
+        string_arena *arena() const { return _arena; }
+
+        template <typename U>
+        bool operator==(const arena_allocator<U> &rhs) const { return _arena == rhs.arena(); }
+
+        template <typename U>
+        bool operator!=(const arena_allocator<U> &rhs) const { return _arena != rhs.arena(); }
+    };
+
+    /**
+     * Memory and traffic figures of a string pool.
+     */
+    struct string_pool_stats {
+        size_t strings = 0;
+        size_t lookups = 0;
+        size_t hits = 0;
+        size_t arena_bytes_used = 0;
+        size_t arena_bytes_reserved = 0;
+        size_t index_bytes = 0;
+
+        string_pool_stats &operator+=(const string_pool_stats &rhs) {
+            strings += rhs.strings;
+            lookups += rhs.lookups;
+            hits += rhs.hits;
+            arena_bytes_used += rhs.arena_bytes_used;
+            arena_bytes_reserved += rhs.arena_bytes_reserved;
+            index_bytes += rhs.index_bytes;
+            return *this;
+        }
+    };
+
+    /**
+     * An interning pool: every distinct string is copied into an arena
+     * once and identified by a compact 32-bit id.
+     *
+     * Interning the same contents twice gives the same id and the same
+     * string_ref (with the same data pointer), so interned strings from one
+     * pool compare equal in O(1) by id. The string_refs stay valid until the
+     * pool is cleared or destroyed.
+     *
+     * Strings are deduplicated by an open-addressing table of (id, hash tag)
+     * slots with linear probing, so most probes never touch the string data.
+     */
+    class string_pool {
+    public:
+        using id_type = std::uint32_t;
+        static constexpr id_type invalid_id = ~id_type(0);
+
+    private:
+        struct slot {
+            id_type id;
+            std::uint32_t tag;
+        };
+
+        string_arena _arena;
+        std::vector<string_ref> _strings;
+        std::vector<slot> _slots;
+        size_t _mask = 0;
+        size_t _lookups = 0;
+        size_t _hits = 0;
+        id_type _max_id;
+
+        /**
+         * Leave a moved-from pool empty. The index is rebuilt by the
+         * next intern_id().
+         */
+        void release() {
+            _strings.clear();
+            _slots.clear();
+            _mask = 0;
+            _lookups = 0;
+            _hits = 0;
+        }
+
+        static std::uint32_t tag_of(std::uint64_t hash) {
+            return static_cast<std::uint32_t>(hash >> 32);
+        }
+
+        void rehash(size_t capacity) {
+            std::vector<slot> slots(capacity, slot{invalid_id, 0});
+            size_t mask = capacity - 1;
+            for (id_type id = 0; id < _strings.size(); ++id) {
+                std::uint64_t hash = _strings[id].hash();
+                size_t i = static_cast<size_t>(hash) & mask;
+                while (slots[i].id != invalid_id) {
+                    i = (i + 1) & mask;
+                }
+                slots[i] = slot{id, tag_of(hash)};
+            }
+            _slots.swap(slots);
+            _mask = mask;
+        }
+
+        /**
+         * Probe for str, returns the slot holding it or the empty slot
+         * where it belongs.
+         */
+        size_t probe(string_ref str, std::uint64_t hash) const {
+            std::uint32_t tag = tag_of(hash);
+            size_t i = static_cast<size_t>(hash) & _mask;
+            while (_slots[i].id != invalid_id) {
+                if (_slots[i].tag == tag && _strings[_slots[i].id].equals(str)) {
+                    return i;
+                }
+                i = (i + 1) & _mask;
+            }
+            return i;
+        }
+
+    public:
+        /**
+         * @param chunk_size size of the arena chunks
+         * @param max_id ids are allocated in [0, max_id), the concurrent
+         * pool uses this to leave room for the shard index.
+         */
+        explicit string_pool(size_t chunk_size = 64 * 1024, id_type max_id = invalid_id)
+                : _arena(chunk_size), _max_id(max_id) {
+            rehash(64);
+        }
+
+        string_pool(string_pool &&other) noexcept
+                : _arena(std::move(other._arena)), _strings(std::move(other._strings)),
+                  _slots(std::move(other._slots)), _mask(other._mask), _lookups(other._lookups),
+                  _hits(other._hits), _max_id(other._max_id) {
+            other.release();
+        }
+
+        string_pool &operator=(string_pool &&other) noexcept {
+            if (this != &other) {
+                _arena = std::move(other._arena);
+                _strings = std::move(other._strings);
+                _slots = std::move(other._slots);
+                _mask = other._mask;
+                _lookups = other._lookups;
+                _hits = other._hits;
+                _max_id = other._max_id;
+                other.release();
+            }
+            return *this;
+        }
+
+        string_pool(const string_pool &) = delete;
+        string_pool &operator=(const string_pool &) = delete;
+
+        /**
+         * Intern a string with a hash computed by string_ref::hash().
+         *
+         * @param str
+         * @param hash str.hash()
+         * @return the id of the string
+         */
+        id_type intern_id(string_ref str, std::uint64_t hash) {
+            ++_lookups;
+            if (_slots.empty()) {
+                rehash(64);
+            }
+            size_t i = probe(str, hash);
+            if (_slots[i].id != invalid_id) {
+                ++_hits;
+                return _slots[i].id;
+            }
+
+            if (_strings.size() >= _max_id) {
+                mpp::throw_ex<mpp::runtime_error>("string_pool: too many strings");
+            }
+            id_type id = static_cast<id_type>(_strings.size());
+            _strings.push_back(str.copy(_arena));
+            _slots[i] = slot{id, tag_of(hash)};
+
+            // keep the load factor below 3/4
+            if (_strings.size() * 4 > _slots.size() * 3) {
+                rehash(_slots.size() * 2);
+            }
+            return id;
+        }
+
+        /**
+         * Intern a string.
+         *
+         * @param str
+         * @return the id of the string
+         */
+        id_type intern_id(string_ref str) {
+            return intern_id(str, str.hash());
+        }
+
+        /**
+         * Intern a string.
+         *
+         * @param str
+         * @return the pooled copy of the string
+         */
+        string_ref intern(string_ref str) {
+            return _strings[intern_id(str)];
+        }
+
+        /**
+         * Find the id of a string without interning it.
+         *
+         * @param str
+         * @return the id, or invalid_id if the string is not in the pool
+         */
+        id_type find(string_ref str) const {
+            return find(str, str.hash());
+        }
+
+        id_type find(string_ref str, std::uint64_t hash) const {
+            if (_slots.empty()) {
+                return invalid_id;
+            }
+            return _slots[probe(str, hash)].id;
+        }
+
+        /**
+         * Get the string behind an id.
+         *
+         * @param id an id returned by this pool
+         * @return the pooled string
+         */
+        string_ref lookup(id_type id) const {
+            if (id >= _strings.size()) {
+                mpp::throw_ex<mpp::runtime_error>("string_pool: invalid id");
+            }
+            return _strings[id];
+        }
+
+        string_ref operator[](id_type id) const {
+            return lookup(id);
+        }
+
+        /**
+         * Get the number of distinct strings.
+         *
+         * @return size
+         */
+        size_t size() const { return _strings.size(); }
+
+        bool empty() const { return _strings.empty(); }
+
+        string_pool_stats stats() const {
+            string_pool_stats stats;
+            stats.strings = _strings.size();
+            stats.lookups = _lookups;
+            stats.hits = _hits;
+            stats.arena_bytes_used = _arena.bytes_used();
+            stats.arena_bytes_reserved = _arena.bytes_reserved();
+            stats.index_bytes = _strings.capacity() * sizeof(string_ref) + _slots.capacity() * sizeof(slot);
+            return stats;
+        }
+
+        /**
+         * Drop every string, invalidating all ids and string_refs.
+         */
+        void clear() {
+            _arena.clear();
+            _strings.clear();
+            _lookups = 0;
+            _hits = 0;
+            rehash(64);
+        }
+    };
+
+    /**
+     * Get the string pool of the calling thread.
+     * Ids and string_refs are only meaningful within the thread that
+     * interned them, and live until the thread exits.
+     *
+     * @return the thread-local pool
+     */
+    inline string_pool &local_string_pool() {
+        static thread_local string_pool pool;
+        return pool;
+    }
+
+    /**
+     * A string pool safe to share between threads.
+     *
+     * Strings are spread over 2^shard_bits independently locked shards by
+     * their hash, so threads interning different strings rarely contend.
+     * The low bits of an id name the shard, so ids are still unique 32-bit
+     * values and compare in O(1).
+     */
+    class concurrent_string_pool {
+    public:
+        using id_type = string_pool::id_type;
+        static constexpr id_type invalid_id = string_pool::invalid_id;
+
+    private:
+        struct shard {
+            std::mutex lock;
+            string_pool pool;
+
+            shard(size_t chunk_size, id_type max_id) : pool(chunk_size, max_id) {}
+        };
+
+        std::vector<std::unique_ptr<shard>> _shards;
+        unsigned _shard_bits;
+        id_type _shard_mask;
+
+        shard &shard_of(std::uint64_t hash) const {
+            // the low bits already pick the slot inside the shard
+            return *_shards[static_cast<size_t>(hash >> (64 - _shard_bits)) & _shard_mask];
+        }
+
+    public:
+        /**
+         * @param shard_bits log2 of the number of shards, at most 8
+         * @param chunk_size size of the arena chunks of every shard
+         */
+        explicit concurrent_string_pool(unsigned shard_bits = 4, size_t chunk_size = 64 * 1024)
+                : _shard_bits(std::max(1u, std::min(shard_bits, 8u))),
+                  _shard_mask((id_type(1) << _shard_bits) - 1) {
+            id_type max_id = invalid_id >> _shard_bits;
+            for (size_t i = 0; i <= _shard_mask; ++i) {
+                _shards.emplace_back(new shard(chunk_size, max_id));
+            }
+        }
+
+        id_type intern_id(string_ref str) {
+            std::uint64_t hash = str.hash();
+            size_t index = static_cast<size_t>(hash >> (64 - _shard_bits)) & _shard_mask;
+            shard &s = *_shards[index];
+            std::lock_guard<std::mutex> guard(s.lock);
+            return (s.pool.intern_id(str, hash) << _shard_bits) | static_cast<id_type>(index);
+        }
+
+        string_ref intern(string_ref str) {
+            std::uint64_t hash = str.hash();
+            shard &s = shard_of(hash);
+            std::lock_guard<std::mutex> guard(s.lock);
+            return s.pool.lookup(s.pool.intern_id(str, hash));
+        }
+
+        id_type find(string_ref str) const {
+            std::uint64_t hash = str.hash();
+            size_t index = static_cast<size_t>(hash >> (64 - _shard_bits)) & _shard_mask;
+            shard &s = *_shards[index];
+            std::lock_guard<std::mutex> guard(s.lock);
+            id_type id = s.pool.find(str, hash);
+            return id == invalid_id ? invalid_id : (id << _shard_bits) | static_cast<id_type>(index);
+        }
+
+        string_ref lookup(id_type id) const {
+            shard &s = *_shards[id & _shard_mask];
+            std::lock_guard<std::mutex> guard(s.lock);
+            return s.pool.lookup(id >> _shard_bits);
+        }
+
+        string_ref operator[](id_type id) const {
+            return lookup(id);
+        }
+
+        size_t size() const {
+            return stats().strings;
+        }
+
+        /**
+         * Collect the statistics of every shard.
+         *
+         * @return the sum over all shards
+         */
+        string_pool_stats stats() const {
+            string_pool_stats total;
+            for (auto &s : _shards) {
+                std::lock_guard<std::mutex> guard(s->lock);
+                total += s->pool.stats();
+            }
+            return total;
+        }
+    };
+}
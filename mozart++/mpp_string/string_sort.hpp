@@ -0,0 +1,255 @@
+/**
+ * Mozart++ Template Library: String
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#pragma once
+
+#include <mozart++/core>
+#include <mozart++/string>
+#include "parallel.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace mpp_impl {
+    /**
+     * Ranges this small are insertion sorted on the strings themselves.
+     */
+    static constexpr size_t string_sort_insertion_threshold = 16;
+
+    /**
+     * Below this size the parallel sorts run sequentially.
+     */
+    static constexpr size_t string_sort_parallel_threshold = 1 << 15;
+
+    /**
+     * Samples taken per bucket to choose the splitters of a parallel sort.
+     */
+    static constexpr size_t string_sort_oversampling = 16;
+
+    /**
+     * Load up to 8 bytes as a big-endian word, so that integer order is
+     * byte order, padding with zero bytes.
+     */
+    inline std::uint64_t load_big_endian(const char *data, size_t length) {
+#if defined(MOZART_STRING_LITTLE_ENDIAN) && (defined(__GNUC__) || defined(__clang__))
+        if (length == 8) {
+            return __builtin_bswap64(load_word(data, 8));
+        }
+#endif
+        std::uint64_t w = 0;
+        for (size_t i = 0; i < 8; ++i) {
+            w = (w << 8) | (i < length ? static_cast<unsigned char>(data[i]) : 0u);
+        }
+        return w;
+    }
+
+    /**
+     * A string with 8 of its bytes cached, so that most comparisons are
+     * between integers next to each other instead of through pointers
+     * into separate buffers.
+     */
+    struct sort_item {
+        std::uint64_t key;
+        mpp::string_ref str;
+    };
+
+    inline std::uint64_t sort_key(mpp::string_ref str, size_t depth) {
+        if (str.size() <= depth) {
+            return 0;
+        }
+        return load_big_endian(str.data() + depth, std::min<size_t>(str.size() - depth, 8));
+    }
+
+    /**
+     * Sort strings whose first depth bytes are equal.
+     *
+     * An MSD sort over 8-byte digits: the range is ordered by the digit at
+     * depth, then every run of equal digits is sorted on the next digit.
+     * Strings ending inside the digit are prefixes of the rest of their
+     * run and go first, shortest first.
+     */
+    template <bool Stable>
+    void sort_items(sort_item *first, sort_item *last, size_t depth) {
+        // The largest run is sorted by the loop and the others recursively,
+        // each at most half the range: the stack stays O(log n) deep
+        // however long the common prefixes are.
+        for (;;) {
+            if (static_cast<size_t>(last - first) <= string_sort_insertion_threshold) {
+                for (sort_item *i = first + 1; i < last; ++i) {
+                    sort_item item = *i;
+                    mpp::string_ref suffix = item.str.substr(depth);
+                    sort_item *j = i;
+                    for (; j != first && suffix.compare((j - 1)->str.substr(depth)) < 0; --j) {
+                        *j = *(j - 1);
+                    }
+                    *j = item;
+                }
+                return;
+            }
+
+            for (sort_item *i = first; i != last; ++i) {
+                i->key = sort_key(i->str, depth);
+            }
+            auto by_key = [](const sort_item &lhs, const sort_item &rhs) { return lhs.key < rhs.key; };
+            auto by_length = [](const sort_item &lhs, const sort_item &rhs) { return lhs.str.size() < rhs.str.size(); };
+            auto ends = [depth](const sort_item &item) { return item.str.size() <= depth + 8; };
+            if (Stable) {
+                std::stable_sort(first, last, by_key);
+            } else {
+                std::sort(first, last, by_key);
+            }
+
+            sort_item *largest_first = first;
+            sort_item *largest_last = first;
+            for (sort_item *run = first; run != last;) {
+                sort_item *run_end = run + 1;
+                while (run_end != last && run_end->key == run->key) {
+                    ++run_end;
+                }
+                if (run_end - run > 1) {
+                    sort_item *rest;
+                    if (Stable) {
+                        rest = std::stable_partition(run, run_end, ends);
+                        std::stable_sort(run, rest, by_length);
+                    } else {
+                        rest = std::partition(run, run_end, ends);
+                        std::sort(run, rest, by_length);
+                    }
+                    if (run_end - rest > largest_last - largest_first) {
+                        sort_items<Stable>(largest_first, largest_last, depth + 8);
+                        largest_first = rest;
+                        largest_last = run_end;
+                    } else {
+                        sort_items<Stable>(rest, run_end, depth + 8);
+                    }
+                }
+                run = run_end;
+            }
+            if (largest_last - largest_first < 2) {
+                return;
+            }
+            first = largest_first;
+            last = largest_last;
+            depth += 8;
+        }
+    }
+
+    /**
+     * Sort on all threads: partition the strings into buckets of
+     * consecutive ranks around splitters picked from a sample, then sort
+     * the buckets independently.
+     */
+    template <bool Stable>
+    void parallel_sort_items(std::vector<sort_item> &items, const std::vector<mpp::string_ref> &strings,
+                             const mpp::parallel_options &options) {
+        size_t count = strings.size();
+        size_t buckets = parallel_threads(options, count / string_sort_parallel_threshold + 1) * 4;
+
+        std::vector<mpp::string_ref> sample;
+        size_t samples = buckets * string_sort_oversampling;
+        sample.reserve(samples);
+        for (size_t i = 0; i < samples; ++i) {
+            sample.push_back(strings[i * count / samples]);
+        }
+        auto less = [](mpp::string_ref lhs, mpp::string_ref rhs) { return lhs.compare(rhs) < 0; };
+        std::sort(sample.begin(), sample.end(), less);
+        std::vector<mpp::string_ref> splitters;
+        for (size_t b = 1; b < buckets; ++b) {
+            splitters.push_back(sample[b * string_sort_oversampling]);
+        }
+
+        // a string goes to the bucket of the first splitter not less than it,
+        // so equal strings share a bucket
+        std::vector<std::uint32_t> bucket_of(count);
+        mpp::parallel_options classify = options;
+        classify.chunk_size = string_sort_parallel_threshold;
+        mpp_impl::parallel_for_chunks(parallel_chunk_count(count, classify), classify, [&](size_t chunk) {
+            size_t end = std::min(count, (chunk + 1) * classify.chunk_size);
+            for (size_t i = chunk * classify.chunk_size; i < end; ++i) {
+                bucket_of[i] = static_cast<std::uint32_t>(
+                        std::lower_bound(splitters.begin(), splitters.end(), strings[i], less) - splitters.begin());
+            }
+        });
+
+        std::vector<size_t> start(buckets + 1);
+        for (std::uint32_t b : bucket_of) {
+            ++start[b + 1];
+        }
+        for (size_t b = 0; b < buckets; ++b) {
+            start[b + 1] += start[b];
+        }
+        std::vector<size_t> next(start.begin(), start.end() - 1);
+        for (size_t i = 0; i < count; ++i) {
+            items[next[bucket_of[i]]++].str = strings[i];
+        }
+
+        mpp_impl::parallel_for_chunks(buckets, options, [&](size_t b) {
+            sort_items<Stable>(items.data() + start[b], items.data() + start[b + 1], 0);
+        });
+    }
+
+    template <bool Stable>
+    void sort_strings(std::vector<mpp::string_ref> &strings, const mpp::parallel_options *options) {
+        if (strings.size() < 2) {
+            return;
+        }
+        std::vector<sort_item> items(strings.size());
+        if (options != nullptr && strings.size() >= string_sort_parallel_threshold
+            && parallel_threads(*options, strings.size()) > 1) {
+            parallel_sort_items<Stable>(items, strings, *options);
+        } else {
+            for (size_t i = 0; i < strings.size(); ++i) {
+                items[i].str = strings[i];
+            }
+            sort_items<Stable>(items.data(), items.data() + items.size(), 0);
+        }
+        for (size_t i = 0; i < strings.size(); ++i) {
+            strings[i] = items[i].str;
+        }
+    }
+}
+
+namespace mpp {
+    /**
+     * Sort strings in byte order (as string_ref::compare()), faster than
+     * std::sort() on large arrays: the sort mostly compares 8-byte
+     * prefixes cached next to each string instead of dereferencing the
+     * strings.
+     *
+     * @param strings
+     */
+    inline void sort_strings(std::vector<string_ref> &strings) {
+        mpp_impl::sort_strings<false>(strings, nullptr);
+    }
+
+    /**
+     * Sort strings in byte order, partitioning large arrays into
+     * buckets sorted on separate threads.
+     *
+     * @param strings
+     * @param options concurrency is used, chunk_size is not
+     */
+    inline void sort_strings(std::vector<string_ref> &strings, const parallel_options &options) {
+        mpp_impl::sort_strings<false>(strings, &options);
+    }
+
+    /**
+     * Sort strings in byte order, keeping equal strings (which may
+     * point to different buffers) in their original order.
+     *
+     * @param strings
+     */
+    inline void stable_sort_strings(std::vector<string_ref> &strings) {
+        mpp_impl::sort_strings<true>(strings, nullptr);
+    }
+
+    inline void stable_sort_strings(std::vector<string_ref> &strings, const parallel_options &options) {
+        mpp_impl::sort_strings<true>(strings, &options);
+    }
+}
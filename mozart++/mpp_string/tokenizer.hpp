@@ -0,0 +1,243 @@
+/**
+ * Mozart++ Template Library: String
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#pragma once
+
+#include <mozart++/core>
+#include <mozart++/string>
+#include "simd.hpp"
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace mpp {
+    struct tokenizer_options {
+        /**
+         * Field separator.
+         */
+        char delimiter = ',';
+        /**
+         * CSV mode: separators and newlines between double quotes belong to
+         * the field, and the quotes around a field are removed.
+         */
+        bool quoted = false;
+        /**
+         * Drop the '\r' of "\r\n" line endings.
+         */
+        bool trim_cr = true;
+    };
+
+    /**
+     * Rows of fields produced by tokenize(), stored as flat arrays of
+     * field offsets and lengths into the source text (structure of
+     * arrays) instead of a vector per row.
+     *
+     * A field_table can be reused: clear() keeps the memory, so
+     * tokenizing chunk after chunk allocates nothing once warm.
+     */
+    class field_table {
+        friend class field_tokenizer;
+
+    public:
+        /**
+         * The fields of a row.
+         */
+        class row_ref {
+        private:
+            const field_table *_table;
+            size_t _first;
+            size_t _size;
+
+        public:
+            row_ref(const field_table *table, size_t first, size_t size)
+                    : _table(table), _first(first), _size(size) {}
+
+            size_t size() const { return _size; }
+
+            bool empty() const { return _size == 0; }
+
+            string_ref operator[](size_t column) const { return _table->field(_first + column); }
+        };
+
+    private:
+        string_ref _source;
+        std::vector<size_t> _offsets;
+        std::vector<size_t> _lengths;
+        // index of the first field of every row, plus the end
+        std::vector<size_t> _rows{0};
+
+    public:
+        void clear() {
+            _source = string_ref();
+            _offsets.clear();
+            _lengths.clear();
+            _rows.resize(1);
+        }
+
+        /**
+         * Get the text the fields point into.
+         */
+        string_ref source() const { return _source; }
+
+        size_t row_count() const { return _rows.size() - 1; }
+
+        size_t field_count() const { return _offsets.size(); }
+
+        /**
+         * Get a field by its index over all rows.
+         */
+        string_ref field(size_t index) const {
+            return string_ref{_source.data() + _offsets[index], _lengths[index]};
+        }
+
+        string_ref field(size_t row, size_t column) const {
+            return field(_rows[row] + column);
+        }
+
+        row_ref row(size_t row) const {
+            return row_ref(this, _rows[row], _rows[row + 1] - _rows[row]);
+        }
+
+        row_ref operator[](size_t row) const { return this->row(row); }
+
+        const std::vector<size_t> &offsets() const { return _offsets; }
+
+        const std::vector<size_t> &lengths() const { return _lengths; }
+
+        /**
+         * Get the index of the first field of every row, followed by
+         * field_count().
+         */
+        const std::vector<size_t> &row_offsets() const { return _rows; }
+    };
+
+    /**
+     * The single-pass scanner behind tokenize().
+     *
+     * Every 16-byte block is turned into bit masks of newlines, separators
+     * and (in CSV mode) quotes. A prefix XOR over the quote mask marks the
+     * bytes inside quotes, carried from block to block, and the remaining
+     * separator and newline bits end the fields.
+     */
+    class field_tokenizer {
+    private:
+        const char *_data;
+        size_t _size;
+        tokenizer_options _options;
+        field_table &_out;
+        size_t _field_start = 0;
+
+        void emit_field(size_t end, bool row_end) {
+            size_t begin = _field_start;
+            if (row_end && _options.trim_cr && end > begin && _data[end - 1] == '\r') {
+                --end;
+            }
+            if (_options.quoted && end - begin >= 2 && _data[begin] == '"' && _data[end - 1] == '"') {
+                ++begin;
+                --end;
+            }
+            _out._offsets.push_back(begin);
+            _out._lengths.push_back(end - begin);
+        }
+
+        void end_row() {
+            _out._rows.push_back(_out._offsets.size());
+        }
+
+        static std::uint32_t prefix_xor(std::uint32_t x) {
+            x ^= x << 1;
+            x ^= x << 2;
+            x ^= x << 4;
+            x ^= x << 8;
+            return x;
+        }
+
+        void scan_block(const char *block, size_t base, std::uint32_t valid, std::uint32_t &inside) {
+            std::uint32_t newlines = mpp_impl::simd_mask_eq(block, '\n');
+            std::uint32_t separators = newlines | mpp_impl::simd_mask_eq(block, _options.delimiter);
+            if (_options.quoted) {
+                std::uint32_t quotes = mpp_impl::simd_mask_eq(block, '"') & valid;
+                std::uint32_t quoted = (prefix_xor(quotes) ^ inside) & 0xFFFFu;
+                inside = (quoted >> 15) ? 0xFFFFu : 0;
+                separators &= ~quoted;
+            }
+            separators &= valid;
+            while (separators != 0) {
+                unsigned i = mpp_impl::ctz32(separators);
+                separators &= separators - 1;
+                bool row_end = (newlines >> i) & 1;
+                emit_field(base + i, row_end);
+                if (row_end) {
+                    end_row();
+                }
+                _field_start = base + i + 1;
+            }
+        }
+
+    public:
+        field_tokenizer(string_ref text, field_table &out, const tokenizer_options &options)
+                : _data(text.data()), _size(text.size()), _options(options), _out(out) {}
+
+        void run() {
+            _out.clear();
+            _out._source = string_ref{_data, _size};
+
+            std::uint32_t inside = 0;
+            size_t base = 0;
+            for (; base + mpp_impl::simd_block <= _size; base += mpp_impl::simd_block) {
+                scan_block(_data + base, base, 0xFFFFu, inside);
+            }
+            if (base < _size) {
+                char tail[mpp_impl::simd_block] = {0};
+                std::memcpy(tail, _data + base, _size - base);
+                scan_block(tail, base, (1u << (_size - base)) - 1, inside);
+            }
+
+            // the last row may lack a newline
+            if (_field_start < _size || _out._offsets.size() != _out._rows.back()) {
+                emit_field(_size, true);
+                end_row();
+            }
+        }
+    };
+
+    /**
+     * Split text into rows at '\n' and rows into fields at a separator,
+     * in one pass.
+     *
+     * Fields point into text, which must outlive the table. A trailing
+     * newline does not start another row; in CSV mode a quoted field is
+     * returned without its quotes, see csv_unescape() for doubled quotes.
+     *
+     * @param text
+     * @param out cleared and filled with the fields
+     * @param options
+     */
+    inline void tokenize(string_ref text, field_table &out, const tokenizer_options &options = tokenizer_options()) {
+        field_tokenizer(text, out, options).run();
+    }
+
+    /**
+     * Collapse the doubled quotes of a quoted CSV field.
+     *
+     * @param field a field returned by tokenize() in CSV mode
+     * @return the field value
+     */
+    inline std::string csv_unescape(string_ref field) {
+        std::string result;
+        result.reserve(field.size());
+        for (size_t i = 0; i < field.size(); ++i) {
+            result.push_back(field[i]);
+            if (field[i] == '"' && i + 1 < field.size() && field[i + 1] == '"') {
+                ++i;
+            }
+        }
+        return result;
+    }
+}
@@ -0,0 +1,799 @@
+/**
+ * Mozart++ Template Library: String
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#pragma once
+
+#include <mozart++/core>
+#include <mozart++/string>
+#include "simd.hpp"
+#include "xid_tables.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <string>
+
+namespace mpp_impl {
+    static constexpr std::uint32_t unicode_max = 0x10FFFF;
+    static constexpr char32_t unicode_replacement = 0xFFFD;
+
+    static constexpr std::uint8_t xid_continue_bit = 1;
+    static constexpr std::uint8_t xid_start_bit = 2;
+
+    /**
+     * Look up the XID bits of a code point in the three-stage table.
+     * Values beyond U+10FFFF are folded to U+0000, which has no bits set.
+     *
+     * @param ch code point
+     * @return combination of xid_start_bit and xid_continue_bit
+     */
+    inline std::uint8_t xid_lookup(char32_t ch) {
+        std::uint32_t cp = ch <= unicode_max ? ch : 0;
+        std::uint32_t mid = xid_top[cp >> (xid_leaf_bits + xid_mid_bits)];
+        std::uint32_t leaf = xid_mid[(mid << xid_mid_bits)
+                                     | ((cp >> xid_leaf_bits) & ((1u << xid_mid_bits) - 1))];
+        std::uint8_t packed = xid_leaf[(leaf << (xid_leaf_bits - 2))
+                                       | ((cp & ((1u << xid_leaf_bits) - 1)) >> 2)];
+        return (packed >> ((cp & 3) << 1)) & 3;
+    }
+
+    /**
+     * Length of a UTF-8 sequence by its lead byte, 0 for bytes which
+     * can never start a well-formed sequence (continuations, C0, C1, F5-FF).
+     */
+    static constexpr std::uint8_t utf8_sequence_length[256] = {
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+        3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    };
+
+    /**
+     * Decode one well-formed UTF-8 sequence (Unicode Table 3-7), rejecting
+     * overlong forms, surrogates and values beyond U+10FFFF.
+     *
+     * @param p start of the sequence, must be less than e
+     * @param e end of the buffer
+     * @param ch the decoded code point
+     * @return bytes consumed, or 0 if the sequence is ill-formed or truncated
+     */
+    inline size_t utf8_decode(const unsigned char *p, const unsigned char *e, char32_t &ch) {
+        std::uint32_t b0 = p[0];
+        if (b0 < 0x80) {
+            ch = b0;
+            return 1;
+        }
+
+        size_t n = utf8_sequence_length[b0];
+        if (n == 0 || static_cast<size_t>(e - p) < n) {
+            return 0;
+        }
+
+        // Only the second byte has a lead-dependent range.
+        std::uint32_t b1 = p[1];
+        std::uint32_t lo = b0 == 0xE0 ? 0xA0 : (b0 == 0xF0 ? 0x90 : 0x80);
+        std::uint32_t hi = b0 == 0xED ? 0x9F : (b0 == 0xF4 ? 0x8F : 0xBF);
+        if (b1 < lo || b1 > hi) {
+            return 0;
+        }
+
+        std::uint32_t cp = b0 & (0x7F >> n);
+        cp = (cp << 6) | (b1 & 0x3F);
+        for (size_t i = 2; i < n; ++i) {
+            std::uint32_t b = p[i];
+            if ((b & 0xC0) != 0x80) {
+                return 0;
+            }
+            cp = (cp << 6) | (b & 0x3F);
+        }
+        ch = cp;
+        return n;
+    }
+
+    /**
+     * Length of the maximal subpart of an ill-formed sequence, that is the
+     * number of bytes that should be replaced by a single U+FFFD
+     * (Unicode 3.9, "U+FFFD Substitution of Maximal Subparts").
+     *
+     * @param p start of a sequence rejected by utf8_decode()
+     * @param e end of the buffer
+     * @return bytes to skip, at least 1
+     */
+    inline size_t utf8_invalid_length(const unsigned char *p, const unsigned char *e) {
+        std::uint32_t b0 = p[0];
+        size_t n = utf8_sequence_length[b0];
+        if (n < 2 || e - p < 2) {
+            return 1;
+        }
+
+        std::uint32_t b1 = p[1];
+        std::uint32_t lo = b0 == 0xE0 ? 0xA0 : (b0 == 0xF0 ? 0x90 : 0x80);
+        std::uint32_t hi = b0 == 0xED ? 0x9F : (b0 == 0xF4 ? 0x8F : 0xBF);
+        if (b1 < lo || b1 > hi) {
+            return 1;
+        }
+
+        size_t i = 2;
+        while (i < n && p + i < e && (p[i] & 0xC0) == 0x80) {
+            ++i;
+        }
+        return i;
+    }
+
+    /**
+     * Encode a code point as UTF-8. Surrogates and values beyond U+10FFFF
+     * must be filtered out by the caller.
+     *
+     * @param ch code point
+     * @param out room for at least 4 bytes
+     * @return bytes written
+     */
+    inline size_t utf8_encode(char32_t ch, char *out) {
+        if (ch < 0x80) {
+            out[0] = static_cast<char>(ch);
+            return 1;
+        }
+        if (ch < 0x800) {
+            out[0] = static_cast<char>(0xC0 | (ch >> 6));
+            out[1] = static_cast<char>(0x80 | (ch & 0x3F));
+            return 2;
+        }
+        if (ch < 0x10000) {
+            out[0] = static_cast<char>(0xE0 | (ch >> 12));
+            out[1] = static_cast<char>(0x80 | ((ch >> 6) & 0x3F));
+            out[2] = static_cast<char>(0x80 | (ch & 0x3F));
+            return 3;
+        }
+        out[0] = static_cast<char>(0xF0 | (ch >> 18));
+        out[1] = static_cast<char>(0x80 | ((ch >> 12) & 0x3F));
+        out[2] = static_cast<char>(0x80 | ((ch >> 6) & 0x3F));
+        out[3] = static_cast<char>(0x80 | (ch & 0x3F));
+        return 4;
+    }
+
+    /**
+     * A shift-based DFA accepting well-formed UTF-8.
+     * States are multiples of 6, and row[byte] packs the next state of every
+     * state at bit offset (state), so a step is a single load and shift:
+     *     state = row[byte] >> (state & 63)
+     */
+    struct utf8_dfa {
+        static constexpr unsigned accept = 0;
+        static constexpr unsigned error = 6;
+        // the states from 12 on are waiting for continuation bytes
+        static constexpr unsigned pending = 12;
+
+        std::uint64_t row[256];
+    };
+
+    /**
+     * Transition of utf8_dfa, states are numbered as in Unicode Table 3-7:
+     * 0 accept, 1 error, 2 one more 80-BF, 3 two more 80-BF,
+     * 4 after E0, 5 after ED, 6 three more 80-BF, 7 after F0, 8 after F4.
+     */
+    constexpr unsigned utf8_dfa_next(unsigned state, unsigned b) {
+        return state == 0 ? (b < 0x80 ? 0 : b < 0xC2 ? 1 : b < 0xE0 ? 2 : b == 0xE0 ? 4 : b == 0xED ? 5 :
+                                                                            b < 0xF0 ? 3 : b == 0xF0 ? 7 : b < 0xF4 ? 6 :
+                                                                                                           b == 0xF4 ? 8 : 1)
+                           : state == 2 ? (b >= 0x80 && b <= 0xBF ? 0 : 1)
+                           : state == 3 ? (b >= 0x80 && b <= 0xBF ? 2 : 1)
+                           : state == 4 ? (b >= 0xA0 && b <= 0xBF ? 2 : 1)
+                           : state == 5 ? (b >= 0x80 && b <= 0x9F ? 2 : 1)
+                           : state == 6 ? (b >= 0x80 && b <= 0xBF ? 3 : 1)
+                           : state == 7 ? (b >= 0x90 && b <= 0xBF ? 3 : 1)
+                           : state == 8 ? (b >= 0x80 && b <= 0x8F ? 3 : 1)
+                           : 1;
+    }
+
+    constexpr utf8_dfa make_utf8_dfa() {
+        utf8_dfa dfa{};
+        for (unsigned b = 0; b < 256; ++b) {
+            for (unsigned state = 0; state < 9; ++state) {
+                dfa.row[b] |= static_cast<std::uint64_t>(utf8_dfa_next(state, b) * 6) << (state * 6);
+            }
+        }
+        return dfa;
+    }
+
+    static constexpr utf8_dfa utf8_dfa_table = make_utf8_dfa();
+
+#ifdef MOZART_STRING_SSSE3
+    /**
+     * Classify 16 bytes at once by table lookups on nibbles
+     * (Keiser and Lemire, "Validating UTF-8 In Less Than One Instruction Per Byte").
+     * Each table marks which error classes the nibble is compatible with,
+     * a byte pair is bad when all three lookups agree on some class.
+     *
+     * @param input the current block
+     * @param prev the previous block, zeros at the start
+     * @return non-zero lanes where an error ends
+     */
+    MOZART_STRING_TARGET_SSSE3
+    inline __m128i utf8_block_errors(__m128i input, __m128i prev) {
+        constexpr char too_short = 1 << 0;
+        constexpr char too_long = 1 << 1;
+        constexpr char overlong_3 = 1 << 2;
+        constexpr char too_large = 1 << 3;
+        constexpr char surrogate = 1 << 4;
+        constexpr char overlong_2 = 1 << 5;
+        constexpr char too_large_1000 = 1 << 6;
+        constexpr char overlong_4 = 1 << 6;
+        constexpr char two_conts = static_cast<char>(1 << 7);
+        constexpr char carry = too_short | too_long | two_conts;
+
+        const __m128i low_nibble = _mm_set1_epi8(0x0F);
+        __m128i prev1 = _mm_alignr_epi8(input, prev, 15);
+
+        __m128i byte_1_high = _mm_shuffle_epi8(_mm_setr_epi8(
+                too_long, too_long, too_long, too_long,
+                too_long, too_long, too_long, too_long,
+                two_conts, two_conts, two_conts, two_conts,
+                too_short | overlong_2,
+                too_short,
+                too_short | overlong_3 | surrogate,
+                too_short | too_large | too_large_1000 | overlong_4
+        ), _mm_and_si128(_mm_srli_epi16(prev1, 4), low_nibble));
+
+        __m128i byte_1_low = _mm_shuffle_epi8(_mm_setr_epi8(
+                carry | overlong_3 | overlong_2 | overlong_4,
+                carry | overlong_2,
+                carry,
+                carry,
+                carry | too_large,
+                carry | too_large | too_large_1000,
+                carry | too_large | too_large_1000,
+                carry | too_large | too_large_1000,
+                carry | too_large | too_large_1000,
+                carry | too_large | too_large_1000,
+                carry | too_large | too_large_1000,
+                carry | too_large | too_large_1000,
+                carry | too_large | too_large_1000,
+                carry | too_large | too_large_1000 | surrogate,
+                carry | too_large | too_large_1000,
+                carry | too_large | too_large_1000
+        ), _mm_and_si128(prev1, low_nibble));
+
+        __m128i byte_2_high = _mm_shuffle_epi8(_mm_setr_epi8(
+                too_short, too_short, too_short, too_short,
+                too_short, too_short, too_short, too_short,
+                too_long | overlong_2 | two_conts | overlong_3 | too_large_1000 | overlong_4,
+                too_long | overlong_2 | two_conts | overlong_3 | too_large,
+                too_long | overlong_2 | two_conts | surrogate | too_large,
+                too_long | overlong_2 | two_conts | surrogate | too_large,
+                too_short, too_short, too_short, too_short
+        ), _mm_and_si128(_mm_srli_epi16(input, 4), low_nibble));
+
+        __m128i special = _mm_and_si128(_mm_and_si128(byte_1_high, byte_1_low), byte_2_high);
+
+        // The third and fourth bytes of a sequence must be continuations,
+        // and only they may follow two continuations.
+        __m128i prev2 = _mm_alignr_epi8(input, prev, 14);
+        __m128i prev3 = _mm_alignr_epi8(input, prev, 13);
+        __m128i third = _mm_subs_epu8(prev2, _mm_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+        __m128i fourth = _mm_subs_epu8(prev3, _mm_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+        __m128i must23 = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8(static_cast<char>(0x80)));
+        return _mm_xor_si128(must23, special);
+    }
+
+    /**
+     * utf8_valid_prefix() for CPUs with SSSE3.
+     * Blocks are checked 16 bytes at a time. On the first failing block,
+     * or at the tail, the scalar decoder takes over from the sequence
+     * boundary before the previous block, which is known to be good.
+     */
+    MOZART_STRING_TARGET_SSSE3
+    inline const unsigned char *utf8_valid_prefix_ssse3(const unsigned char *p, const unsigned char *e) {
+        const unsigned char *begin = p;
+        __m128i prev = _mm_setzero_si128();
+        bool prev_ascii = true;
+        for (; static_cast<size_t>(e - p) >= simd_block; p += simd_block) {
+            __m128i input = simd_load(p);
+            bool ascii = _mm_movemask_epi8(input) == 0;
+            if (!(ascii && prev_ascii)) {
+                __m128i errors = utf8_block_errors(input, prev);
+                if (_mm_movemask_epi8(_mm_cmpeq_epi8(errors, _mm_setzero_si128())) != 0xFFFF) {
+                    break;
+                }
+            }
+            prev = input;
+            prev_ascii = ascii;
+        }
+
+        // The previous block may end with an incomplete sequence.
+        if (p != begin) {
+            p -= simd_block;
+        }
+        while (p > begin && (*p & 0xC0) == 0x80) {
+            --p;
+        }
+        while (p < e) {
+            char32_t ch = 0;
+            size_t n = utf8_decode(p, e, ch);
+            if (n == 0) {
+                return p;
+            }
+            p += n;
+        }
+        return p;
+    }
+#endif
+
+    /**
+     * Find the end of the longest well-formed UTF-8 prefix of [p, e).
+     * Uses utf8_valid_prefix_ssse3() when the CPU allows. Otherwise
+     * runs of ASCII are skipped a block at a time, other runs go through
+     * utf8_dfa. Only when the DFA rejects a run is it decoded again with
+     * utf8_decode() to locate the bad byte.
+     *
+     * @return e if the whole buffer is valid, otherwise the first bad byte
+     */
+    inline const unsigned char *utf8_valid_prefix(const unsigned char *p, const unsigned char *e) {
+#ifdef MOZART_STRING_SSSE3
+        if (cpu_has_ssse3()) {
+            return utf8_valid_prefix_ssse3(p, e);
+        }
+#endif
+        constexpr size_t run_length = 4 * simd_block;
+        while (p < e) {
+            if (static_cast<size_t>(e - p) >= simd_block) {
+                std::uint32_t high = simd_mask_high(p);
+                if (high == 0) {
+                    p += simd_block;
+                    continue;
+                }
+                p += ctz32(high);
+            }
+
+            const unsigned char *run = p;
+            const unsigned char *stop = p + std::min(run_length, static_cast<size_t>(e - p));
+            std::uint64_t state = utf8_dfa::accept;
+            for (; p < stop; ++p) {
+                state = utf8_dfa_table.row[*p] >> (state & 63);
+            }
+            // finish the sequence that crosses the end of the run
+            while ((state & 63) >= utf8_dfa::pending && p < e) {
+                state = utf8_dfa_table.row[*p++] >> (state & 63);
+            }
+
+            if ((state & 63) != utf8_dfa::accept) {
+                for (p = run;;) {
+                    char32_t ch = 0;
+                    size_t n = utf8_decode(p, e, ch);
+                    if (n == 0) {
+                        return p;
+                    }
+                    p += n;
+                }
+            }
+        }
+        return p;
+    }
+
+    /**
+     * Number of bytes in [p, e) which start a code point,
+     * i.e. are not continuation bytes (10xxxxxx).
+     */
+    inline size_t utf8_count_leads(const unsigned char *p, const unsigned char *e) {
+        return (e - p) - simd_count_range(p, e, 0x80, 0xBF);
+    }
+}
+
+namespace mpp {
+    namespace unicode {
+        /**
+         * Check whether the code point has the XID_Start property (UAX #31).
+         *
+         * @param ch code point
+         * @return can start an identifier?
+         */
+        inline bool is_xid_start(char32_t ch) {
+            return (mpp_impl::xid_lookup(ch) & mpp_impl::xid_start_bit) != 0;
+        }
+
+        /**
+         * Check whether the code point has the XID_Continue property (UAX #31).
+         *
+         * @param ch code point
+         * @return can continue an identifier?
+         */
+        inline bool is_xid_continue(char32_t ch) {
+            return (mpp_impl::xid_lookup(ch) & mpp_impl::xid_continue_bit) != 0;
+        }
+
+        /**
+         * Measure the identifier at the beginning of a UTF-8 string,
+         * without decoding the whole string.
+         * An identifier starts with an XID_Start character or an underscore,
+         * followed by any number of XID_Continue characters.
+         * Scanning stops at the first character that does not qualify or
+         * at the first ill-formed sequence.
+         *
+         * @param str UTF-8 encoded string
+         * @return length of the identifier in bytes, 0 if there is none
+         */
+        inline size_t scan_identifier(string_ref str) {
+            const unsigned char *begin = str.bytes_begin();
+            const unsigned char *end = str.bytes_end();
+            const unsigned char *p = begin;
+
+            // '_' is not XID_Start, but is accepted as a start character.
+            std::uint8_t required = mpp_impl::xid_start_bit;
+            while (p < end) {
+                char32_t ch = 0;
+                size_t n = mpp_impl::utf8_decode(p, end, ch);
+                if (n == 0) {
+                    break;
+                }
+                if (!(mpp_impl::xid_lookup(ch) & required) && ch != '_') {
+                    break;
+                }
+                required = mpp_impl::xid_continue_bit;
+                p += n;
+            }
+            return p - begin;
+        }
+
+        /**
+         * Check whether a buffer is well-formed UTF-8.
+         * Overlong forms, surrogates, values beyond U+10FFFF and truncated
+         * sequences are all rejected.
+         *
+         * @param data buffer
+         * @param length buffer size in bytes
+         * @return is valid UTF-8?
+         */
+        inline bool validate_utf8(const char *data, size_t length) {
+            const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+            return mpp_impl::utf8_valid_prefix(p, p + length) == p + length;
+        }
+
+        inline bool validate_utf8(string_ref str) {
+            return validate_utf8(str.data(), str.size());
+        }
+
+        /**
+         * Count the code points in a UTF-8 buffer without decoding it.
+         * The input is expected to be valid, see validate_utf8().
+         *
+         * @param data buffer
+         * @param length buffer size in bytes
+         * @return number of code points
+         */
+        inline size_t count_code_points(const char *data, size_t length) {
+            const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+            return mpp_impl::utf8_count_leads(p, p + length);
+        }
+
+        inline size_t count_code_points(string_ref str) {
+            return count_code_points(str.data(), str.size());
+        }
+
+        /**
+         * Number of char32_t needed to hold the decoded form of a valid UTF-8 buffer.
+         *
+         * @param data buffer
+         * @param length buffer size in bytes
+         * @return length of the UTF-32 string
+         */
+        inline size_t utf32_length_from_utf8(const char *data, size_t length) {
+            return count_code_points(data, length);
+        }
+
+        /**
+         * Number of bytes needed to encode a UTF-32 string as UTF-8.
+         *
+         * @param data code points
+         * @param length number of code points
+         * @return length of the UTF-8 string in bytes
+         */
+        inline size_t utf8_length_from_utf32(const char32_t *data, size_t length) {
+            // Branch free so that the compiler is free to vectorize it.
+            size_t bytes = length;
+            for (size_t i = 0; i < length; ++i) {
+                std::uint32_t ch = data[i];
+                bytes += (ch >= 0x80) + (ch >= 0x800) + (ch >= 0x10000);
+            }
+            return bytes;
+        }
+
+        inline size_t utf8_length_from_utf32(const std::u32string &str) {
+            return utf8_length_from_utf32(str.data(), str.size());
+        }
+
+        /**
+         * Locate the start of the index-th code point in a valid UTF-8 buffer.
+         *
+         * @param data buffer
+         * @param length buffer size in bytes
+         * @param index code point index
+         * @return byte offset of the code point, length if index equals the
+         * number of code points, or string_ref::npos if it is greater
+         */
+        inline size_t code_point_offset(const char *data, size_t length, size_t index) {
+            const unsigned char *begin = reinterpret_cast<const unsigned char *>(data);
+            const unsigned char *end = begin + length;
+            const unsigned char *p = begin;
+
+            // Skip whole blocks while the target lies beyond them.
+            while (static_cast<size_t>(end - p) >= mpp_impl::simd_block) {
+                std::uint32_t leads = ~mpp_impl::simd_mask_range(p, 0x80, 0xBF) & 0xFFFFu;
+                size_t count = mpp_impl::popcount32(leads);
+                if (count > index) {
+                    while (index-- != 0) {
+                        leads &= leads - 1;
+                    }
+                    return (p - begin) + mpp_impl::ctz32(leads);
+                }
+                index -= count;
+                p += mpp_impl::simd_block;
+            }
+
+            for (; p < end; ++p) {
+                if ((*p & 0xC0) != 0x80 && index-- == 0) {
+                    return p - begin;
+                }
+            }
+            return index == 0 ? length : string_ref::npos;
+        }
+
+        inline size_t code_point_offset(string_ref str, size_t index) {
+            return code_point_offset(str.data(), str.size(), index);
+        }
+    }
+
+    /**
+     * A lazy view of the code points in a UTF-8 string_ref.
+     *
+     * Code points are decoded on the fly as the iterators move, so walking
+     * a view never allocates. Every iterator knows its byte offset, so the
+     * positions found in code point space can be turned back into
+     * zero-copy string_ref slices.
+     * Ill-formed sequences are reported as U+FFFD, one byte at a time.
+     */
+    class utf8_view {
+    public:
+        static constexpr char32_t replacement_char = mpp_impl::unicode_replacement;
+
+        class iterator {
+            friend class utf8_view;
+
+        public:
+            using iterator_category = std::bidirectional_iterator_tag;
+            using value_type = char32_t;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const char32_t *;
+            using reference = char32_t;
+
+        private:
+            const unsigned char *_begin = nullptr;
+            const unsigned char *_pos = nullptr;
+            const unsigned char *_end = nullptr;
+
+            /**
+             * The code point at _pos and its width in bytes,
+             * width is 0 at the end of the view.
+             */
+            char32_t _ch = 0;
+            size_t _width = 0;
+
+            iterator(const unsigned char *begin, const unsigned char *pos, const unsigned char *end)
+                    : _begin(begin), _pos(pos), _end(end) {
+                decode();
+            }
+
+            void decode() {
+                if (_pos == _end) {
+                    _width = 0;
+                    return;
+                }
+                _width = mpp_impl::utf8_decode(_pos, _end, _ch);
+                if (_width == 0) {
+                    _ch = replacement_char;
+                    _width = 1;
+                }
+            }
+
+        public:
+            iterator() = default;
+
+            char32_t operator*() const { return _ch; }
+
+            /**
+             * Get the byte offset of the current code point in the view.
+             *
+             * @return offset in bytes
+             */
+            size_t offset() const { return _pos - _begin; }
+
+            /**
+             * Get the number of bytes the current code point occupies.
+             *
+             * @return width in bytes, 0 at the end of the view
+             */
+            size_t width() const { return _width; }
+
+            iterator &operator++() {
+                _pos += _width;
+                decode();
+                return *this;
+            }
+
+            iterator operator++(int) {
+                iterator old = *this;
+                ++*this;
+                return old;
+            }
+
+            iterator &operator--() {
+                // A well-formed sequence is at most 4 bytes long, and it must
+                // end exactly where we are, otherwise step back over one bad byte.
+                const unsigned char *q = _pos - 1;
+                while (q > _begin && _pos - q < 4 && (*q & 0xC0) == 0x80) {
+                    --q;
+                }
+                char32_t ch = 0;
+                size_t n = mpp_impl::utf8_decode(q, _end, ch);
+                if (n != static_cast<size_t>(_pos - q)) {
+                    q = _pos - 1;
+                }
+                _pos = q;
+                decode();
+                return *this;
+            }
+
+            iterator operator--(int) {
+                iterator old = *this;
+                --*this;
+                return old;
+            }
+
+            bool operator==(const iterator &rhs) const { return _pos == rhs._pos; }
+
+            bool operator!=(const iterator &rhs) const { return _pos != rhs._pos; }
+        };
+
+        using const_iterator = iterator;
+
+    private:
+        string_ref _str;
+
+    public:
+        utf8_view() = default;
+
+        /*implicit*/ utf8_view(string_ref str) : _str(str) {}
+
+        iterator begin() const {
+            return iterator{_str.bytes_begin(), _str.bytes_begin(), _str.bytes_end()};
+        }
+
+        iterator end() const {
+            return iterator{_str.bytes_begin(), _str.bytes_end(), _str.bytes_end()};
+        }
+
+        /**
+         * Get an iterator to the code point starting at a byte offset.
+         * The offset is expected to be on a code point boundary.
+         *
+         * @param offset offset in bytes, clamped to the size of the view
+         * @return iterator
+         */
+        iterator at_offset(size_t offset) const {
+            return iterator{_str.bytes_begin(), _str.bytes_begin() + std::min(offset, _str.size()),
+                            _str.bytes_end()};
+        }
+
+        /**
+         * Get the underlying bytes.
+         *
+         * @return string_ref
+         */
+        string_ref str() const { return _str; }
+
+        bool empty() const { return _str.empty(); }
+
+        /**
+         * Count the elements iteration yields, this walks the whole view.
+         * Each invalid byte counts as one replacement_char, like the
+         * iterator steps over it.
+         *
+         * @return number of code points
+         */
+        size_t size() const {
+            const unsigned char *p = _str.bytes_begin();
+            const unsigned char *e = _str.bytes_end();
+            const unsigned char *valid = mpp_impl::utf8_valid_prefix(p, e);
+            size_t count = mpp_impl::utf8_count_leads(p, valid);
+            // past the first bad byte, step the way the iterator does
+            for (p = valid; p != e; ++count) {
+                char32_t ch = 0;
+                size_t n = mpp_impl::utf8_decode(p, e, ch);
+                p += n == 0 ? 1 : n;
+            }
+            return count;
+        }
+
+        /**
+         * Return a reference to the bytes from [first, last).
+         *
+         * @param first
+         * @param last
+         * @return
+         */
+        string_ref slice(iterator first, iterator last) const {
+            return _str.slice(first.offset(), last.offset());
+        }
+
+        /**
+         * Return a reference to the bytes from first to the end of the view.
+         *
+         * @param first
+         * @return
+         */
+        string_ref slice(iterator first) const {
+            return _str.substr(first.offset());
+        }
+    };
+
+    /**
+     * Return a reference to the code points [start_index, start_index + N)
+     * of a UTF-8 string. Like string_ref::substr(), out of range arguments are
+     * clamped to the end of the string.
+     *
+     * @param str valid UTF-8 string
+     * @param start_index index of the first code point
+     * @param N number of code points
+     * @return
+     */
+    inline string_ref utf8_substr(string_ref str, size_t start_index, size_t N = string_ref::npos) {
+        size_t start = unicode::code_point_offset(str, start_index);
+        if (start == string_ref::npos) {
+            return str.substr(str.size());
+        }
+        string_ref rest = str.substr(start);
+        return rest.substr(0, N == string_ref::npos ? N : unicode::code_point_offset(rest, N));
+    }
+
+    /**
+     * Search for the first code point satisfying the predicate f
+     *
+     * @param str UTF-8 string
+     * @param f
+     * @param start_index byte offset to start from, on a code point boundary
+     * @return byte offset of the code point or npos
+     */
+    inline size_t utf8_find_if(string_ref str, const mpp::function<bool(char32_t)> &f,
+                               size_t start_index = 0) {
+        utf8_view view(str);
+        for (auto it = view.at_offset(start_index), end = view.end(); it != end; ++it) {
+            if (f(*it)) {
+                return it.offset();
+            }
+        }
+        return string_ref::npos;
+    }
+
+    /**
+     * Search for the first code point not satisfying the predicate f
+     *
+     * @param str UTF-8 string
+     * @param f
+     * @param start_index byte offset to start from, on a code point boundary
+     * @return byte offset of the code point or npos
+     */
+    inline size_t utf8_find_if_not(string_ref str, const mpp::function<bool(char32_t)> &f,
+                                   size_t start_index = 0) {
+        return utf8_find_if(
+                str,
+                [&f](char32_t c) { return !f(c); },
+                start_index
+        );
+    }
+}
@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+#
+# Mozart++ Template Library: String
+# Licensed under MIT License
+# Copyright (c) 2020 Covariant Institute
+# Website: https://covariant.cn/
+# Github:  https://github.com/covariant-institute/
+#
+# Generate mozart++/mpp_string/xid_tables.hpp, the three-stage lookup
+# tables used by mpp::unicode::is_xid_start() and is_xid_continue().
+#
+# Usage:
+#   gen-xid-tables.py [DerivedCoreProperties.txt] > xid_tables.hpp
+#
+# Without an argument the properties are taken from Python's own
+# unicodedata, whose str.isidentifier() is defined by XID_Start and
+# XID_Continue (PEP 3131).
+
+import sys
+import unicodedata
+
+MAX_CODE_POINT = 0x110000
+LEAF_BITS = 7
+MID_BITS = 5
+
+XID_CONTINUE = 1
+XID_START = 2
+
+
+def load_from_ucd(path):
+    props = [0] * MAX_CODE_POINT
+    with open(path, encoding='utf-8') as f:
+        for line in f:
+            line = line.split('#', 1)[0].strip()
+            if not line:
+                continue
+            cps, name = [x.strip() for x in line.split(';')]
+            if name == 'XID_Start':
+                bit = XID_START
+            elif name == 'XID_Continue':
+                bit = XID_CONTINUE
+            else:
+                continue
+            lo, _, hi = cps.partition('..')
+            for cp in range(int(lo, 16), int(hi or lo, 16) + 1):
+                props[cp] |= bit
+    return props, 'DerivedCoreProperties.txt'
+
+
+def load_from_python():
+    props = [0] * MAX_CODE_POINT
+    for cp in range(MAX_CODE_POINT):
+        if 0xD800 <= cp < 0xE000:
+            continue
+        ch = chr(cp)
+        if ch != '_' and ch.isidentifier():
+            props[cp] |= XID_START
+        if ('a' + ch).isidentifier():
+            props[cp] |= XID_CONTINUE
+    return props, 'Python unicodedata'
+
+
+def dedup(seq, width):
+    blocks, index = {}, []
+    for i in range(0, len(seq), width):
+        block = tuple(seq[i:i + width])
+        index.append(blocks.setdefault(block, len(blocks)))
+    return [b for b, _ in sorted(blocks.items(), key=lambda kv: kv[1])], index
+
+
+def emit(name, values, per_line=16):
+    print('    static constexpr std::uint8_t %s[%d] = {' % (name, len(values)))
+    for i in range(0, len(values), per_line):
+        print('        ' + ', '.join('0x%02X' % v for v in values[i:i + per_line]) + ',')
+    print('    };')
+
+
+def main():
+    props, source = load_from_ucd(sys.argv[1]) if len(sys.argv) > 1 else load_from_python()
+
+    leaves, leaf_index = dedup(props, 1 << LEAF_BITS)
+    mids, mid_index = dedup(leaf_index, 1 << MID_BITS)
+    assert len(leaves) <= 256 and len(mids) <= 256
+
+    # 2 bits per code point, 4 code points per byte
+    leaf_bytes = []
+    for leaf in leaves:
+        for i in range(0, len(leaf), 4):
+            leaf_bytes.append(leaf[i] | leaf[i + 1] << 2 | leaf[i + 2] << 4 | leaf[i + 3] << 6)
+
+    print('/**')
+    print(' * Mozart++ Template Library: String')
+    print(' * Licensed under MIT License')
+    print(' * Copyright (c) 2020 Covariant Institute')
+    print(' * Website: https://covariant.cn/')
+    print(' * Github:  https://github.com/covariant-institute/')
+    print(' */')
+    print()
+    print('// Generated by scripts/gen-xid-tables.py from %s (Unicode %s).'
+          % (source, unicodedata.unidata_version))
+    print('// DO NOT EDIT.')
+    print()
+    print('#pragma once')
+    print()
+    print('#include <cstdint>')
+    print()
+    print('namespace mpp_impl {')
+    print('    static constexpr unsigned xid_leaf_bits = %d;' % LEAF_BITS)
+    print('    static constexpr unsigned xid_mid_bits = %d;' % MID_BITS)
+    print()
+    emit('xid_top', mid_index)
+    print()
+    emit('xid_mid', [i for m in mids for i in m])
+    print()
+    emit('xid_leaf', leaf_bytes)
+    print('}')
+
+
+if __name__ == '__main__':
+    main()
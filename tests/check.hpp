@@ -0,0 +1,33 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#pragma once
+
+#include <cstdio>
+
+/**
+ * The failed checks of the test program.
+ */
+static int failures = 0;
+
+inline void check(bool cond, const char *what) {
+    if (!cond) {
+        printf("FAILED: %s\n", what);
+        ++failures;
+    }
+}
+
+/**
+ * Print the summary line of a test program.
+ *
+ * @return its exit status
+ */
+inline int report(const char *name) {
+    printf("%s: %d failure(s)\n", name, failures);
+    return failures == 0 ? 0 : 1;
+}
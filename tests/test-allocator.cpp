@@ -0,0 +1,142 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#include <mozart++/string>
+#include <mozart++/format>
+#include <mozart++/codecvt>
+#include <mozart++/string_pool>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+#include "check.hpp"
+
+// every allocation from the global heap made by this program
+static size_t heap_allocations = 0;
+
+void *operator new(size_t size) {
+    ++heap_allocations;
+    void *p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+    std::free(p);
+}
+
+/**
+ * Run fn and check the global heap allocations it made.
+ */
+template <typename Fn>
+void expect_allocations(size_t expected, const char *what, Fn &&fn) {
+    size_t before = heap_allocations;
+    fn();
+    size_t made = heap_allocations - before;
+    if (made != expected) {
+        printf("FAILED: %s: %zu heap allocation(s), expected %zu\n", what, made, expected);
+        ++failures;
+    }
+}
+
+using arena_string = mpp::alloc_string<mpp::arena_allocator<char>>;
+
+int main() {
+    mpp::string_ref long_text("a string long enough to leave the small string buffer");
+    mpp::string_ref csv("alpha,beta,gamma,delta,epsilon,zeta,eta,theta");
+
+    // the default allocator: what each operation costs
+    {
+        expect_allocations(1, "str", [&] { check(long_text.str().size() == long_text.size(), "str size"); });
+        expect_allocations(0, "short str", [] { check(mpp::string_ref("abc").str() == "abc", "short str"); });
+        expect_allocations(1, "upper", [&] { check(long_text.upper()[0] == 'A', "upper"); });
+        std::vector<mpp::string_ref> parts;
+        parts.reserve(16);
+        expect_allocations(0, "split into reserved vector", [&] { csv.split(parts, ','); });
+        check(parts.size() == 8, "split parts");
+        expect_allocations(0, "short format", [] { check(mpp::format("{}-{}", 1, 2) == "1-2", "format"); });
+        std::string expected = long_text.str() + ": 0xff 2.50";
+        expect_allocations(1, "long format", [&] {
+            check(mpp::format("{}: {x} {.2}", long_text, 255, 2.5) == expected, "long format");
+        });
+    }
+
+    // a per-request path on a stack arena never touches the heap
+    {
+        alignas(16) char buffer[8192];
+        mpp::string_arena arena(buffer, sizeof(buffer));
+        mpp::arena_allocator<char> alloc(arena);
+
+        std::string expected = long_text.str() + " ....42 3.142 0xff " + long_text.str();
+        expect_allocations(0, "arena request", [&] {
+            arena_string copy = long_text.str(alloc);
+            check(mpp::string_ref(copy).equals(long_text), "arena str");
+
+            arena_string lower = mpp::string_ref("MIXED Case Text Longer Than Fifteen").lower(alloc);
+            check(mpp::string_ref(lower).equals("mixed case text longer than fifteen"), "arena lower");
+            arena_string upper = long_text.upper(alloc);
+            check(upper[2] == 'S', "arena upper");
+
+            std::vector<mpp::string_ref, mpp::arena_allocator<mpp::string_ref>> fields(alloc);
+            csv.split(fields, ',');
+            csv.split(fields, ",", 2);
+            check(fields.size() == 11 && fields[10].equals("gamma,delta,epsilon,zeta,eta,theta"), "arena split");
+
+            arena_string line = mpp::format(std::allocator_arg, alloc, "{} {:6|.} {.3} {x} {}",
+                                            long_text, 42, 3.14159, 255, copy);
+            check(mpp::string_ref(line).equals(expected), "arena format");
+            mpp::format_to(line, " and {}", "more");
+            check(mpp::string_ref(line).endswith(" and more"), "arena format_to");
+
+            auto wide = mpp::codecvt::utf8::decode<mpp::codecvt::error_policy::replace>(
+                    "caf\xc3\xa9 cr\xc3\xa8me br\xc3\xbbl\xc3\xa9\xff", alloc);
+            check(wide.value.size() == 17 && wide.error_offset == 20, "arena decode");
+            auto narrow = mpp::codecvt::utf8::encode(wide.value, alloc);
+            check(mpp::string_ref(narrow.value).equals("caf\xc3\xa9 cr\xc3\xa8me br\xc3\xbbl\xc3\xa9\xef\xbf\xbd"),
+                  "arena encode");
+            auto gbk = mpp::codecvt::gbk::decode(mpp::string_ref("ab\xb0\xa1"), alloc);
+            check(gbk.ok() && gbk.value.size() == 3 && gbk.value[2] == 0xB0A1, "arena gbk decode");
+            auto ascii = mpp::codecvt::ascii::decode(long_text, alloc);
+            check(ascii.ok() && ascii.value.size() == long_text.size(), "arena ascii decode");
+        });
+        check(arena.chunk_count() == 0, "within the buffer");
+        check(arena.bytes_used() > 0, "arena used");
+
+        // running out of buffer falls back to a heap chunk (and the list of
+        // chunks), which the harness sees
+        arena.clear();
+        mpp::string_arena small(buffer, 32, 1024);
+        mpp::arena_allocator<char> small_alloc(small);
+        expect_allocations(2, "arena overflow", [&] {
+            arena_string copy = long_text.str(small_alloc);
+            check(copy.size() == long_text.size(), "overflow copy");
+        });
+        check(small.chunk_count() == 1, "overflow chunk");
+    }
+
+    return report("allocator");
+}
@@ -0,0 +1,158 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#include <mozart++/async_format>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "check.hpp"
+
+using mpp::string_ref;
+
+// writes part of its text, then fails
+struct faulty {
+    int value;
+};
+
+std::ostream &operator<<(std::ostream &out, faulty f) {
+    out << "partial " << f.value;
+    throw std::runtime_error("faulty");
+}
+
+int main() {
+    // formatting matches mpp::format
+    {
+        std::vector<std::string> lines;
+        {
+            mpp::async_formatter log([&](string_ref line) { lines.push_back(line.str()); });
+            log.post("plain");
+            log.post("{} + {} = {}", 1, 2, 3);
+            log.post("{.2} {x} {:5|*} {}", 3.14159, 255, 'c', "literal");
+            log.flush();
+            check(lines.size() == 3, "flush waits for the sink");
+        }
+        check(lines.size() == 3, "three lines");
+        check(lines[0] == "plain", "no arguments");
+        check(lines[1] == "1 + 2 = 3", "arguments");
+        check(lines[2] == mpp::format("{.2} {x} {:5|*} {}", 3.14159, 255, 'c', "literal"), "controls");
+    }
+
+    // a message that fails to format reaches the sink not even in part
+    {
+        std::vector<std::string> lines;
+        {
+            mpp::async_formatter log([&](string_ref line) { lines.push_back(line.str()); });
+            log.post("before");
+            log.post("{} {}", 1, faulty{2});
+            log.post("after");
+        }
+        check(lines.size() == 2 && lines[0] == "before" && lines[1] == "after", "failed message skipped");
+    }
+
+    // several producers, every message delivered in per-producer order
+    {
+        const int threads = 4;
+        const int per_thread = 2000;
+        std::vector<std::vector<int>> seen(threads);
+        {
+            mpp::async_format_options options;
+            options.capacity = 64;
+            mpp::async_formatter log([&](string_ref line) {
+                auto parts = line.split(' ');
+                seen[std::stoi(parts.first.str())].push_back(std::stoi(parts.second.str()));
+            }, options);
+            check(log.capacity() == 64, "capacity");
+
+            std::vector<std::thread> pool;
+            for (int t = 0; t < threads; ++t) {
+                pool.emplace_back([&log, t] {
+                    for (int i = 0; i < per_thread; ++i) {
+                        log.post("{} {}", t, i);
+                    }
+                });
+            }
+            for (auto &t : pool) {
+                t.join();
+            }
+            check(log.dropped() == 0, "block never drops");
+        }
+        bool ordered = true;
+        for (const auto &numbers : seen) {
+            ordered = ordered && numbers.size() == per_thread;
+            for (size_t i = 0; ordered && i < numbers.size(); ++i) {
+                ordered = numbers[i] == static_cast<int>(i);
+            }
+        }
+        check(ordered, "every message, in order");
+    }
+
+    // drop and count with a stalled consumer
+    for (auto overflow : {mpp::async_overflow::drop, mpp::async_overflow::count}) {
+        std::mutex gate;
+        std::vector<std::string> lines;
+        mpp::async_format_options options;
+        options.capacity = 4;
+        options.overflow = overflow;
+        {
+            std::unique_lock<std::mutex> stall(gate);
+            mpp::async_formatter log([&](string_ref line) {
+                std::lock_guard<std::mutex> guard(gate);
+                lines.push_back(line.str());
+            }, options);
+
+            // the consumer takes the first message, frees its slot and blocks in the sink
+            log.post("first");
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            int accepted = 0;
+            for (int i = 0; i < 10; ++i) {
+                accepted += log.post("message {}", i) ? 1 : 0;
+            }
+            check(accepted == 4, "ring full after capacity messages");
+            check(log.dropped() == 6, "dropped count");
+            stall.unlock();
+            log.flush();
+            log.post("last");
+        }
+        size_t expected = overflow == mpp::async_overflow::count ? 7 : 6;
+        check(lines.size() == expected, "lines after overflow");
+        check(lines.back() == "last", "last line");
+        if (overflow == mpp::async_overflow::count) {
+            check(lines[1] == "async_formatter: 6 message(s) dropped\n", "drop report");
+        }
+    }
+
+    // benchmark: cost on the posting thread
+    {
+        const int n = 2000;
+        size_t bytes = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < n; ++i) {
+            bytes += mpp::format("request {} took {.3} ms", i, i * 0.25).size();
+        }
+        double sync_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+        {
+            mpp::async_format_options options;
+            options.capacity = n;
+            mpp::async_formatter log([&](string_ref line) { bytes += line.size(); }, options);
+            start = std::chrono::steady_clock::now();
+            for (int i = 0; i < n; ++i) {
+                log.post("request {} took {.3} ms", i, i * 0.25);
+            }
+            double post_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+            printf("async_formatter: format %.1f ns/message, post %.1f ns/message\n", sync_ns, post_ns);
+        }
+        check(bytes != 0, "benchmark output");
+    }
+
+    return report("async_formatter");
+}
@@ -0,0 +1,144 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#include <mozart++/batch>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "check.hpp"
+
+template <typename Pred>
+bool same_selection(const std::vector<mpp::string_ref> &strings, const mpp::selection_bitmap &bits,
+                    size_t selected, Pred pred) {
+    size_t expected = 0;
+    for (size_t i = 0; i < strings.size(); ++i) {
+        if (bits.test(i) != pred(strings[i])) {
+            return false;
+        }
+        expected += pred(strings[i]);
+    }
+    return selected == expected && bits.count() == expected;
+}
+
+int main() {
+    // selection bitmaps
+    {
+        mpp::selection_bitmap bits(130);
+        bits.set(0);
+        bits.set(64);
+        bits.set(129);
+        check(bits.count() == 3 && bits.test(64) && !bits.test(63), "set and test");
+        std::vector<size_t> rows;
+        bits.for_each([&](size_t i) { rows.push_back(i); });
+        check(rows == std::vector<size_t>({0, 64, 129}), "for_each");
+        bits.flip();
+        check(bits.count() == 127 && !bits.test(129), "flip keeps padding clear");
+        mpp::selection_bitmap all(130, true);
+        all &= bits;
+        check(all.count() == 127, "and");
+        bits.resize(10);
+        check(bits.count() == 9, "shrink");
+        bits.resize(100);
+        check(bits.count() == 9 && !bits.test(50), "grow");
+    }
+
+    // every predicate agrees with the string_ref method, row by row
+    {
+        std::mt19937 rng(7);
+        const char alphabet[] = "aAbBzZ@[`{09-_";
+        std::vector<std::string> storage;
+        for (int i = 0; i < 5000; ++i) {
+            std::string s(rng() % 40, ' ');
+            for (char &c : s) {
+                c = alphabet[rng() % (sizeof(alphabet) - 1)];
+            }
+            storage.push_back(s);
+        }
+        // needles that occur, at every length up to past two words
+        std::vector<std::string> needles{""};
+        for (size_t length = 1; length <= 20; ++length) {
+            for (const auto &s : storage) {
+                if (s.size() >= length) {
+                    needles.push_back(s.substr(0, length));
+                    break;
+                }
+            }
+        }
+        storage.insert(storage.end(), needles.begin(), needles.end());
+        std::vector<mpp::string_ref> strings(storage.begin(), storage.end());
+        strings.push_back(mpp::string_ref());
+
+        mpp::selection_bitmap bits;
+        for (const auto &n : needles) {
+            mpp::string_ref needle(n);
+            size_t selected = mpp::batch::starts_with(strings, needle, bits);
+            check(same_selection(strings, bits, selected, [&](mpp::string_ref s) { return s.startswith(needle); }),
+                  "starts_with");
+            selected = mpp::batch::equals(strings, needle, bits);
+            check(same_selection(strings, bits, selected, [&](mpp::string_ref s) { return s.equals(needle); }),
+                  "equals");
+            selected = mpp::batch::equals_ignore_case(strings, needle, bits);
+            check(same_selection(strings, bits, selected,
+                                 [&](mpp::string_ref s) { return s.equals_ignore_case(needle); }),
+                  "equals_ignore_case");
+            selected = mpp::batch::contains(strings, needle, bits);
+            check(same_selection(strings, bits, selected, [&](mpp::string_ref s) { return s.contains(needle); }),
+                  "contains");
+        }
+        check(mpp::batch::equals_ignore_case(strings, "AbZ@[", bits) == mpp::batch::equals_ignore_case(strings, "aBz@[", bits),
+              "case folding");
+
+        std::vector<std::uint64_t> hashes = mpp::batch::hash(strings);
+        bool same = true;
+        for (size_t i = 0; i < strings.size(); ++i) {
+            same = same && hashes[i] == strings[i].hash();
+        }
+        check(same, "hash");
+    }
+
+    // benchmark: short strings in separate buffers, one call per row against a batch
+    {
+        const size_t n = 1000000;
+        std::mt19937 rng(11);
+        const char *hosts[] = {"api", "www", "cdn", "Mail", "static", "img", "auth", "db"};
+        std::vector<std::unique_ptr<char[]>> buffers;
+        std::vector<mpp::string_ref> strings;
+        for (size_t i = 0; i < n; ++i) {
+            std::string s = std::string(hosts[rng() % 8]) + "-" + std::to_string(rng() % 1000) + ".example.com";
+            buffers.emplace_back(new char[s.size()]);
+            std::copy(s.begin(), s.end(), buffers.back().get());
+            strings.emplace_back(buffers.back().get(), s.size());
+        }
+        // rows in an order unrelated to where their bytes are
+        std::shuffle(strings.begin(), strings.end(), rng);
+
+        auto start = std::chrono::steady_clock::now();
+        size_t scalar = 0;
+        for (mpp::string_ref s : strings) {
+            scalar += s.startswith("static-");
+        }
+        for (mpp::string_ref s : strings) {
+            scalar += s.equals_ignore_case("mail-42.example.com");
+        }
+        auto mid = std::chrono::steady_clock::now();
+        mpp::selection_bitmap bits;
+        size_t batched = mpp::batch::starts_with(strings, "static-", bits);
+        batched += mpp::batch::equals_ignore_case(strings, "mail-42.example.com", bits);
+        auto end = std::chrono::steady_clock::now();
+        check(scalar == batched, "benchmark agrees");
+        printf("batch: starts_with + equals_ignore_case over %zu strings: per call %.2f ms, batch %.2f ms\n", n,
+               std::chrono::duration<double, std::milli>(mid - start).count(),
+               std::chrono::duration<double, std::milli>(end - mid).count());
+    }
+
+    return report("batch");
+}
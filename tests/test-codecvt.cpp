@@ -0,0 +1,94 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#include <mozart++/codecvt>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include "check.hpp"
+
+using mpp::codecvt::convert_error;
+using mpp::codecvt::error_policy;
+
+int main() {
+    using mpp::codecvt::utf8;
+    using mpp::codecvt::gbk;
+    using mpp::codecvt::ascii;
+
+    auto good = utf8::decode(u8"héllo, 世界");
+    check(good.ok() && good.value == U"héllo, 世界", "utf8 strict decode");
+    check(utf8::encode(good.value).value == u8"héllo, 世界", "utf8 strict encode");
+
+    // "\xE4\xB8" is the maximal subpart of a truncated 3-byte sequence
+    mpp::string_ref bad = "ab\xE4\xB8" "c\xFF" "d";
+    auto strict = utf8::decode<error_policy::strict>(bad);
+    check(!strict && strict.error == convert_error::ill_formed, "utf8 strict reports error");
+    check(strict.error_offset == 2 && strict.value == U"ab", "utf8 strict stops at error");
+
+    auto replaced = utf8::decode<error_policy::replace>(bad);
+    check(replaced.value == U"ab�c�d", "utf8 replace");
+    check(replaced.error_offset == 2, "utf8 replace keeps first error");
+
+    auto skipped = utf8::decode<error_policy::skip>(bad);
+    check(skipped.value == U"abcd", "utf8 skip");
+
+    std::u32string surrogate = U"x";
+    surrogate.push_back(0xD800);
+    surrogate.push_back(U'中');
+    check(utf8::encode(surrogate).error == convert_error::unrepresentable, "utf8 strict encode surrogate");
+    check(utf8::encode<error_policy::replace>(surrogate).value == u8"x�中", "utf8 replace encode");
+    check(utf8::encode<error_policy::skip>(surrogate).value == u8"x中", "utf8 skip encode");
+
+    auto hanzi = gbk::decode("\xD6\xD0" "a\xCE");
+    check(!hanzi && hanzi.error_offset == 3 && hanzi.value == U"\xD6D0" U"a", "gbk strict truncated");
+    check(gbk::decode<error_policy::replace>("\x81" "0").value == U"�0", "gbk replace bad trail");
+    check(gbk::encode<error_policy::replace>(U"\xD6D0\x20AC").value == "\xD6\xD0?", "gbk replace encode");
+
+    check(ascii::decode<error_policy::skip>("caf\xC3\xA9").value == U"caf", "ascii skip");
+    check(ascii::encode<error_policy::replace>(U"café").value == "caf?", "ascii replace encode");
+
+    // runtime policy through the charset interface
+    mpp::codecvt::utf8 cvt;
+    mpp::codecvt::charset &cs = cvt;
+    check(cs.try_local2wide(bad, error_policy::skip).value == U"abcd", "runtime policy decode");
+    check(!cs.try_wide2local(surrogate, error_policy::strict), "runtime policy encode");
+
+    using mpp::codecvt::charset_kind;
+    using mpp::codecvt::detect_charset;
+
+    check(detect_charset("plain old ascii").kind == charset_kind::ascii, "detect ascii");
+    auto bom = detect_charset("\xEF\xBB\xBFhello");
+    check(bom.kind == charset_kind::utf8 && bom.bom_length == 3 && bom.confidence == 1, "detect bom");
+    check(detect_charset(u8"这是一段中文文本").kind == charset_kind::utf8, "detect utf8");
+    // "这是一段中文文本" in GBK
+    check(detect_charset("\xD5\xE2\xCA\xC7\xD2\xBB\xB6\xCE\xD6\xD0\xCE\xC4\xCE\xC4\xB1\xBE").kind
+          == charset_kind::gbk, "detect gbk");
+    // a prefix limit that cuts "中" in half must not count as an error
+    auto cut = detect_charset(u8"abc中", 4);
+    check(cut.kind == charset_kind::utf8, "detect truncated utf8");
+
+    auto detected = mpp::codecvt::make_charset("\xD6\xD0\xCE\xC4");
+    check(dynamic_cast<mpp::codecvt::gbk *>(detected.get()) != nullptr, "make_charset");
+
+    std::string payload;
+    while (payload.size() < 1024) {
+        payload += u8"日志 log line with 中文 and ascii, ";
+    }
+    auto start = std::chrono::steady_clock::now();
+    size_t utf8_hits = 0;
+    constexpr int rounds = 100000;
+    for (int i = 0; i < rounds; ++i) {
+        utf8_hits += detect_charset(payload, 1024).kind == charset_kind::utf8;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    check(utf8_hits == rounds, "detect utf8 payload");
+    printf("detect_charset: %.1f ns per KB\n", static_cast<double>(elapsed) / rounds);
+
+    return report("codecvt");
+}
@@ -0,0 +1,53 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#include <mozart++/string>
+#include <cstdio>
+#include "check.hpp"
+
+using mpp::string_ref;
+
+constexpr string_ref header = "  Content-Type: text/plain  ";
+
+// parse a header at compile time
+constexpr string_ref header_name() {
+    return header.trim().split(':').first;
+}
+
+constexpr string_ref header_value() {
+    return header.split(':').second.trim();
+}
+
+static_assert(string_ref("hello").size() == 5, "constexpr length");
+static_assert(string_ref("hello").equals("hello") && !string_ref("hello").equals("help"), "equals");
+static_assert(string_ref("abc").compare("abd") < 0 && string_ref("b").compare("abc") > 0, "compare");
+static_assert(string_ref("Keyword").equals_ignore_case("KEYWORD"), "equals_ignore_case");
+static_assert(string_ref("hello world").startswith("hello") && string_ref("hello world").endswith("world"),
+              "startswith and endswith");
+static_assert(string_ref("hello world").find('o') == 4 && string_ref("hello world").rfind('o') == 7, "find char");
+static_assert(string_ref("hello world").find("wor") == 6 && string_ref("hello").find("xyz") == string_ref::npos,
+              "find string");
+static_assert(string_ref("a,b,,c").count(',') == 3 && string_ref("aaaa").count("aa") == 3, "count");
+static_assert(string_ref("x=1;y=2").find_first_of(";=") == 1, "find_first_of");
+static_assert(header_name().equals("Content-Type"), "split and trim");
+static_assert(header_value().equals("text/plain"), "split and trim value");
+static_assert(string_ref("key").hash() == mpp_impl::hash_bytes("key", 3), "constexpr hash");
+
+int main() {
+    // the same calls at runtime take the library and SIMD paths
+    string_ref runtime_header = header;
+    check(runtime_header.trim().split(':').first.equals(header_name()), "runtime split agrees");
+    check(string_ref("hello world").find("wor") == 6, "runtime find agrees");
+
+    constexpr std::uint64_t compile_time = string_ref("a string longer than eight bytes").hash();
+    volatile bool opaque = true;
+    string_ref runtime = opaque ? "a string longer than eight bytes" : "";
+    check(runtime.hash() == compile_time, "compile-time and runtime hashes agree");
+
+    return report("constexpr");
+}
@@ -0,0 +1,152 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#include <mozart++/glob_pattern>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "check.hpp"
+
+/**
+ * The textbook backtracking matcher, for *, ? and single byte classes.
+ */
+bool reference_match(const char *p, const char *pe, const char *t, const char *te) {
+    if (p == pe) {
+        return t == te;
+    }
+    if (*p == '*') {
+        for (const char *s = t;; ++s) {
+            if (reference_match(p + 1, pe, s, te)) {
+                return true;
+            }
+            if (s == te) {
+                return false;
+            }
+        }
+    }
+    if (t == te) {
+        return false;
+    }
+    if (*p == '[') {
+        // [xy] or [!xy]
+        const char *close = p + 1;
+        while (*close != ']') {
+            ++close;
+        }
+        bool negate = p[1] == '!';
+        bool in = std::string(p + 1 + negate, close).find(*t) != std::string::npos;
+        return in != negate && reference_match(close + 1, pe, t + 1, te);
+    }
+    return (*p == '?' || *p == *t) && reference_match(p + 1, pe, t + 1, te);
+}
+
+int main() {
+    // syntax
+    {
+        check(mpp::glob_pattern("user:*:session").match("user:42:session"), "star");
+        check(!mpp::glob_pattern("user:*:session").match("user:42:sessions"), "anchored end");
+        check(mpp::glob_pattern("*.example.com").match(".example.com"), "empty star");
+        check(mpp::glob_pattern("a?c").match("abc") && !mpp::glob_pattern("a?c").match("ac"), "question mark");
+        check(mpp::glob_pattern("v[0-9].[!x]").match("v2.y") && !mpp::glob_pattern("v[0-9].[!x]").match("v2.x"),
+              "classes");
+        check(mpp::glob_pattern("[]a]*").match("]b") && mpp::glob_pattern("[^a]").match("b"), "class forms");
+        check(mpp::glob_pattern("a[b").match("a[b"), "unterminated class");
+        check(mpp::glob_pattern("\\*\\?").match("*?") && !mpp::glob_pattern("\\*").match("a"), "escapes");
+        check(mpp::glob_pattern("***").match("") && mpp::glob_pattern("").match("") && !mpp::glob_pattern("").match("a"),
+              "empty");
+        check(mpp::glob_pattern("*ab*ab*").match("xabyab") && !mpp::glob_pattern("*ab*ab*").match("xaba"),
+              "segments in order");
+        check(!mpp::glob_pattern("ab*ba").match("aba"), "ends overlap");
+
+        mpp::glob_pattern upper("GET /API/*/[a-c]?", true);
+        check(upper.match("get /api/v2/B9") && upper.match("GET /Api/x/aa") && !upper.match("get /api/v2/d9"),
+              "ignore case");
+        check(mpp::glob_pattern("*needle-in-a-haystack*", true)
+                      .match("a long enough haystack with a NEEDLE-IN-A-HAYSTACK hidden in it"),
+              "ignore case search");
+    }
+
+    // the same answers as backtracking
+    {
+        std::mt19937 rng(23);
+        const char *atoms[] = {"a", "b", "c", "*", "?", "[ab]", "[!a]", "ab", "*a"};
+        int disagreements = 0;
+        for (int i = 0; i < 20000; ++i) {
+            std::string source;
+            for (int k = rng() % 7; k >= 0; --k) {
+                source += atoms[rng() % 9];
+            }
+            mpp::glob_pattern glob(source);
+            for (int t = 0; t < 10; ++t) {
+                std::string text(rng() % 40, ' ');
+                for (char &c : text) {
+                    c = "abc"[rng() % 3];
+                }
+                bool expected = reference_match(source.data(), source.data() + source.size(), text.data(),
+                                                text.data() + text.size());
+                if (glob.match(text) != expected && ++disagreements <= 5) {
+                    printf("FAILED: %s on %s\n", source.c_str(), text.c_str());
+                }
+            }
+        }
+        check(disagreements == 0, "agrees with backtracking");
+    }
+
+    // linear where backtracking is not
+    {
+        std::string text(100000, 'a');
+        mpp::glob_pattern glob("*a*a*a*a*a*a*a*b");
+        auto start = std::chrono::steady_clock::now();
+        check(!glob.match(text), "pathological");
+        check(mpp::glob_pattern("*a*a*a*a*a*a*a*").match(text), "pathological match");
+        printf("glob_pattern: pathological pattern over %zu bytes: %.3f ms\n", text.size(),
+               std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    // batches, and a benchmark on routing keys
+    {
+        const size_t n = 1000000;
+        std::mt19937 rng(29);
+        const char *services[] = {"billing", "users", "Orders", "search", "auth"};
+        const char *actions[] = {"get", "list", "create", "delete", "update"};
+        std::vector<std::string> storage;
+        for (size_t i = 0; i < n; ++i) {
+            storage.push_back(std::string("svc.") + services[rng() % 5] + ".v" + std::to_string(rng() % 4) + "."
+                              + actions[rng() % 5] + "." + std::to_string(rng() % 100000));
+        }
+        std::vector<mpp::string_ref> keys(storage.begin(), storage.end());
+        for (const char *source : {"svc.Orders.v[23].*", "*.delete.*", "svc.*.v1.create.1*", "*Orders*update*"}) {
+            mpp::glob_pattern glob(source);
+            auto start = std::chrono::steady_clock::now();
+            size_t expected = 0;
+            for (mpp::string_ref key : keys) {
+                expected += reference_match(source, source + std::strlen(source), key.data(), key.data() + key.size());
+            }
+            auto mid = std::chrono::steady_clock::now();
+            mpp::selection_bitmap bits;
+            size_t selected = glob.match(keys, bits);
+            auto end = std::chrono::steady_clock::now();
+            size_t single = 0;
+            for (mpp::string_ref key : keys) {
+                single += glob(key);
+            }
+            check(selected == expected && single == expected && bits.count() == expected, source);
+            printf("glob_pattern: %-20s %zu of %zu keys: backtracking %.2f ms, glob_pattern %.2f ms\n", source,
+                   selected, n, std::chrono::duration<double, std::milli>(mid - start).count(),
+                   std::chrono::duration<double, std::milli>(end - mid).count());
+        }
+        mpp::selection_bitmap bits;
+        check(mpp::glob_pattern("*ORDERS*UPDATE*", true).match(keys, bits)
+              == mpp::glob_pattern("*Orders*update*").match(keys, bits), "batch ignoring case");
+    }
+
+    return report("glob_pattern");
+}
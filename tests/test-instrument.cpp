@@ -0,0 +1,116 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#define MOZART_STRING_INSTRUMENT
+
+#include <mozart++/string>
+#include <mozart++/format>
+#include <mozart++/codecvt>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include "check.hpp"
+
+int main() {
+    static_assert(mpp::string_stats_enabled(), "instrumentation on");
+    mpp::reset_string_stats();
+
+    // string_ref algorithms
+    {
+        mpp::string_ref text("alpha,beta,gamma,delta");
+        check(text.find(',') == 5, "find char");
+        check(text.find("gamma") == 11, "find string");
+
+        std::vector<mpp::string_ref> parts;
+        text.split(parts, ',');
+        check(parts.size() == 4, "split");
+
+        mpp::string_ref long_text("a string long enough to leave the small string buffer");
+        check(long_text.upper() == "A STRING LONG ENOUGH TO LEAVE THE SMALL STRING BUFFER", "upper");
+        check(long_text.str().size() == long_text.size(), "str");
+        check(mpp::string_ref("abc").str() == "abc", "short str");
+
+        mpp::string_stats stats = mpp::collect_string_stats();
+        check(stats[mpp::string_op::find].calls >= 2, "find calls");
+        check(stats[mpp::string_op::find].bytes > 0, "find bytes");
+        check(stats[mpp::string_op::split].calls == 1, "split calls");
+        check(stats[mpp::string_op::split].bytes == text.size(), "split bytes");
+        check(stats[mpp::string_op::split].allocations == 1, "split growth counted");
+        check(stats[mpp::string_op::case_convert].calls == 1, "case calls");
+        check(stats[mpp::string_op::case_convert].allocations == 1, "case allocations");
+        // the long copy needs the heap, the short one fits in place
+        check(stats[mpp::string_op::copy].calls == 2, "copy calls");
+        check(stats[mpp::string_op::copy].allocations == 1, "copy allocations");
+        check(stats[mpp::string_op::find].cycles > 0, "cycles");
+    }
+
+    // reset starts from zero
+    {
+        mpp::reset_string_stats();
+        mpp::string_stats stats = mpp::collect_string_stats();
+        check(stats[mpp::string_op::find].calls == 0, "reset find");
+        check(stats[mpp::string_op::copy].allocations == 0, "reset copy");
+    }
+
+    // format and its placeholders
+    {
+        std::string s = mpp::format("{} and {}", 1, "two");
+        check(s == "1 and two", "format result");
+        mpp::string_stats stats = mpp::collect_string_stats();
+        check(stats[mpp::string_op::format].calls == 1, "format calls");
+        check(stats[mpp::string_op::format].bytes == 9, "format bytes");
+        check(stats[mpp::string_op::format_placeholder].calls == 2, "placeholder calls");
+        check(stats[mpp::string_op::format].allocations == 0, "short result stays in place");
+    }
+
+    // codecvt conversions
+    {
+        mpp::reset_string_stats();
+        mpp::codecvt::utf8 cvt;
+        std::u32string wide = cvt.local2wide("h\xc3\xa9llo");
+        check(wide.size() == 5, "decode");
+        check(cvt.wide2local(wide) == "h\xc3\xa9llo", "encode");
+        auto result = cvt.try_local2wide("abc", mpp::codecvt::error_policy::replace);
+        check(result.value.size() == 3, "try decode");
+
+        mpp::string_stats stats = mpp::collect_string_stats();
+        check(stats[mpp::string_op::decode].calls == 2, "decode calls");
+        check(stats[mpp::string_op::decode].bytes == 9, "decode bytes");
+        check(stats[mpp::string_op::encode].calls == 1, "encode calls");
+        check(stats[mpp::string_op::encode].bytes == 5 * sizeof(char32_t), "encode bytes");
+    }
+
+    // counters of other threads, running or exited, are summed in
+    {
+        mpp::reset_string_stats();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([] {
+                mpp::string_ref text("x,y,z");
+                for (int i = 0; i < 1000; ++i) {
+                    std::vector<mpp::string_ref> parts;
+                    text.split(parts, ',');
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        mpp::string_stats stats = mpp::collect_string_stats();
+        check(stats[mpp::string_op::split].calls == 4000, "threads split calls");
+        check(stats[mpp::string_op::split].bytes == 4000 * 5, "threads split bytes");
+    }
+
+    std::string table = mpp::format_string_stats(mpp::collect_string_stats());
+    check(table.find("split") != std::string::npos, "table lists split");
+    check(table.find("decode") == std::string::npos, "table skips unused ops");
+    mpp::dump_string_stats(stdout);
+
+    return report("instrument");
+}
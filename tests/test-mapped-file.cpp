@@ -0,0 +1,94 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#include <mozart++/mapped_file>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "check.hpp"
+
+using mpp::string_ref;
+
+int main() {
+    const char *path = "test-mapped-file.tmp";
+    std::string contents;
+    for (int i = 0; i < 5000; ++i) {
+        contents += "2020-01-01 INFO request " + std::to_string(i) + " served\n";
+    }
+    contents += "last line without newline";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << contents;
+    }
+
+    mpp::mapped_file_options options;
+    options.huge_pages = true;
+    mpp::mapped_file file(path, options);
+    check(file.is_open() && file.size() == contents.size(), "size");
+    check(file.ref().equals(contents), "contents");
+    check(file.ref().count('\n') == 5000, "string_ref algorithms on the mapping");
+    file.advise(mpp::access_hint::willneed, 4097, 10000);
+
+    size_t n = 0;
+    string_ref last;
+    for (string_ref line : mpp::lines(file)) {
+        last = line;
+        ++n;
+    }
+    check(n == 5001 && last.equals("last line without newline"), "line iterator");
+
+    std::vector<string_ref> small;
+    for (string_ref line : mpp::lines("a\n\nb\n")) {
+        small.push_back(line);
+    }
+    check(small.size() == 3 && small[1].empty() && small[2].equals("b"), "empty lines, trailing newline");
+    check(mpp::lines("").begin() == mpp::lines("").end(), "no lines in an empty string");
+
+    // count a pattern with chunks much smaller than the file
+    string_ref pattern = "request 4999 served";
+    size_t expected = file.ref().count("served");
+    size_t found = 0;
+    size_t position = string_ref::npos;
+    mpp::chunked_reader reader(file, 1000, pattern.size() - 1);
+    mpp::string_chunk chunk;
+    while (reader.next(chunk)) {
+        for (size_t i = chunk.data.find("served"); i != string_ref::npos && chunk.owns(i);
+             i = chunk.data.find("served", i + 1)) {
+            ++found;
+        }
+        size_t i = chunk.data.find(pattern);
+        if (i != string_ref::npos && chunk.owns(i)) {
+            position = chunk.offset + i;
+        }
+    }
+    check(found == expected, "overlapping chunks count each match once");
+    check(position == contents.find(pattern.str()), "match spanning a chunk boundary");
+    check(reader.chunk_count() == (contents.size() + 999) / 1000, "chunk count");
+
+    mpp::mapped_file moved = std::move(file);
+    check(!file.is_open() && moved.ref().startswith("2020"), "move");
+    moved.close();
+
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    }
+    mpp::mapped_file empty(path);
+    check(empty.is_open() && empty.empty() && empty.ref().empty(), "empty file");
+    std::remove(path);
+
+    bool threw = false;
+    try {
+        mpp::mapped_file missing("no/such/file");
+    } catch (const mpp::runtime_error &) {
+        threw = true;
+    }
+    check(threw, "missing file");
+
+    return report("mapped_file");
+}
@@ -0,0 +1,111 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#include <mozart++/natural_sort>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "check.hpp"
+
+using mpp::string_ref;
+
+int sign(int x) {
+    return (x > 0) - (x < 0);
+}
+
+int main() {
+    // comparison
+    {
+        check(string_ref("file9").compare_numeric("file10") < 0, "shorter number");
+        check(string_ref("file10").compare_numeric("file9") > 0, "longer number");
+        check(string_ref("a001").compare_numeric("a02") < 0, "leading zeros are not length");
+        check(string_ref("a1").compare_numeric("a01") < 0, "fewer zeros first");
+        check(string_ref("a01b").compare_numeric("a1c") < 0, "zeros are the last resort");
+        check(string_ref("a0").compare_numeric("a00") < 0, "zero");
+        check(string_ref("a00").compare_numeric("a00") == 0, "equal");
+        check(string_ref("x123456789012345678901234567890").compare_numeric("x123456789012345678901234567891") < 0,
+              "long digit runs");
+        check(string_ref("v1.9.2").compare_numeric("v1.10.0") < 0, "versions");
+        check(string_ref("abc").compare_numeric("abc1") < 0, "prefix");
+        check(string_ref("a-1").compare_numeric("a1") < 0, "'-' before digits");
+        check(string_ref("a_1").compare_numeric("a1") > 0, "'_' after digits");
+        check(string_ref("").compare_numeric("") == 0, "empty");
+        check(string_ref("IMG_2").compare_numeric("img_10") < 0, "case sensitive");
+        check(string_ref("img_20").compare_numeric("IMG_10") > 0, "case sensitive, 'i' > 'I'");
+        check(string_ref("img_20").compare_numeric_ignore_case("IMG_10") > 0, "ignore case");
+        check(string_ref("Img_10").compare_numeric_ignore_case("iMG_10") == 0, "ignore case equal");
+        check(mpp::natural_compare("File2", "file10", true) < 0, "natural_compare");
+    }
+
+    // natural_sort agrees with the comparator, and is stable
+    std::mt19937 rng(7);
+    std::vector<std::string> words;
+    for (int i = 0; i < 3000; ++i) {
+        std::string word;
+        for (size_t n = rng() % 12; n > 0; --n) {
+            word.push_back("aAbB0019-._"[rng() % 11]);
+        }
+        words.push_back(word);
+    }
+    for (bool ignore_case : {false, true}) {
+        mpp::natural_less less;
+        less.ignore_case = ignore_case;
+        std::vector<std::string> expected = words;
+        std::stable_sort(expected.begin(), expected.end(),
+                         [&](const std::string &lhs, const std::string &rhs) { return less(lhs, rhs); });
+
+        std::vector<std::string> sorted = words;
+        mpp::natural_sort(sorted, ignore_case);
+        check(sorted == expected, ignore_case ? "natural_sort ignoring case" : "natural_sort");
+
+        std::vector<string_ref> refs(words.begin(), words.end());
+        mpp::natural_sort(refs.begin(), refs.end(), ignore_case);
+        check(std::equal(refs.begin(), refs.end(), expected.begin(),
+                         [](string_ref lhs, const std::string &rhs) { return lhs.equals(rhs); }),
+              "natural_sort of string_refs");
+
+        // a consistent ordering
+        bool consistent = true;
+        for (size_t i = 0; i + 1 < sorted.size(); ++i) {
+            const std::string &a = sorted[i];
+            const std::string &b = sorted[i + 1];
+            int ab = mpp::natural_compare(a, b, ignore_case);
+            consistent = consistent && ab <= 0 && sign(mpp::natural_compare(b, a, ignore_case)) == -sign(ab);
+        }
+        check(consistent, "antisymmetric");
+    }
+
+    std::vector<std::string> small = {"z10", "z9", "Z1", "z09"};
+    mpp::natural_sort(small);
+    check(small == std::vector<std::string>({"Z1", "z9", "z09", "z10"}), "small array");
+
+    // benchmark: file names
+    {
+        std::vector<std::string> names;
+        for (int i = 0; i < 200000; ++i) {
+            names.push_back("photos/2020/IMG_" + std::to_string(rng() % 100000) + "_v" + std::to_string(rng() % 20)
+                            + ".jpg");
+        }
+        std::vector<std::string> a = names;
+        auto start = std::chrono::steady_clock::now();
+        std::sort(a.begin(), a.end(), mpp::natural_less());
+        auto mid = std::chrono::steady_clock::now();
+        std::vector<std::string> b = names;
+        mpp::natural_sort(b);
+        auto end = std::chrono::steady_clock::now();
+        check(a == b, "benchmark results");
+        printf("natural_sort: std::sort with natural_less %.1f ms, natural_sort %.1f ms\n",
+               std::chrono::duration<double, std::milli>(mid - start).count(),
+               std::chrono::duration<double, std::milli>(end - mid).count());
+    }
+
+    return report("natural_sort");
+}
@@ -0,0 +1,88 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#include <mozart++/parallel>
+#include <mozart++/mapped_file>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "check.hpp"
+
+using mpp::string_ref;
+
+std::vector<size_t> find_all(string_ref str, string_ref needle) {
+    std::vector<size_t> result;
+    for (size_t i = str.find(needle); i != string_ref::npos; i = str.find(needle, i + 1)) {
+        result.push_back(i);
+    }
+    return result;
+}
+
+int main() {
+    // a small alphabet makes plenty of overlapping and boundary-spanning matches
+    std::mt19937 rng(1);
+    std::string text;
+    for (int i = 0; i < 200000; ++i) {
+        text.push_back("ab\n"[rng() % 3]);
+    }
+    string_ref ref = text;
+
+    bool same = true;
+    for (size_t chunk : {1, 7, 64, 4096, 1 << 20}) {
+        for (size_t threads : {1, 3}) {
+            mpp::parallel_options options;
+            options.chunk_size = chunk;
+            options.concurrency = threads;
+            same = same && mpp::parallel_count(ref, 'a', options) == ref.count('a');
+            same = same && mpp::parallel_count(ref, "aba", options) == ref.count("aba");
+            same = same && mpp::parallel_count(ref, "aaaa", options) == ref.count("aaaa");
+            same = same && mpp::parallel_find_all(ref, "ab\nb", options) == find_all(ref, "ab\nb");
+
+            std::vector<string_ref> lines;
+            for (string_ref line : mpp::lines(ref)) {
+                lines.push_back(line);
+            }
+            auto split = mpp::parallel_split_lines(ref, options);
+            bool lines_same = split.size() == lines.size();
+            for (size_t i = 0; lines_same && i < lines.size(); ++i) {
+                lines_same = split[i].data() == lines[i].data() && split[i].size() == lines[i].size();
+            }
+            same = same && lines_same;
+        }
+    }
+    check(same, "parallel results match the sequential ones");
+    check(mpp::parallel_split_lines("a\n\nb").size() == 3, "empty lines");
+    check(mpp::parallel_split_lines("").empty() && mpp::parallel_count("", "x") == 0, "empty input");
+    check(mpp::parallel_count("abc", "") == 4, "empty needle counts like string_ref");
+
+    // scaling, 64 MiB of log-like text
+    std::string big;
+    big.reserve(64 << 20);
+    while (big.size() < (64u << 20)) {
+        big += "2020-01-01 12:00:00 INFO request served in ";
+        big += std::to_string(rng() % 1000);
+        big += " ms\n";
+    }
+    size_t expected = string_ref(big).count('\n');
+    unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+        mpp::parallel_options options;
+        options.concurrency = threads;
+        auto start = std::chrono::steady_clock::now();
+        size_t lines = mpp::parallel_split_lines(big, options).size();
+        size_t served = mpp::parallel_count(big, "served in 99", options);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        printf("parallel: 64 MiB split_lines + count on %u thread(s): %.1f ms (%zu matches)\n", threads, ms, served);
+        check(lines == expected, "line count");
+    }
+
+    return report("parallel");
+}
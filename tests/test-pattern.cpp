@@ -0,0 +1,249 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#include <mozart++/pattern>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "check.hpp"
+
+bool found_at(const mpp::pattern &p, mpp::string_ref text, size_t position, size_t length) {
+    mpp::pattern_match m = p.search(text);
+    return m.found() && m.position == position && m.length == length;
+}
+
+bool rejects(const char *source) {
+    try {
+        mpp::pattern p(source);
+    } catch (const std::exception &) {
+        return true;
+    }
+    return false;
+}
+
+std::mt19937 rng(17);
+
+// random patterns over a, b and c; the bodies of quantifiers never match
+// empty, where std::regex strays from ECMAScript
+std::string random_pattern(int depth);
+
+std::string random_solid(int depth) {
+    switch (rng() % 4) {
+        case 0:
+            return "a";
+        case 1:
+            return "b.";
+        case 2:
+            return "[ab]c?";
+        default:
+            return "(" + random_solid(depth + 1) + "|" + random_pattern(depth + 1) + "b)";
+    }
+}
+
+std::string random_pattern(int depth) {
+    const char *quantifiers[] = {"*", "+", "?", "{2}", "{1,3}", "{0,2}", "*?", "+?", "??", "{1,}"};
+    switch (rng() % (depth > 3 ? 4 : 9)) {
+        case 0:
+            return "a";
+        case 1:
+            return "B";
+        case 2:
+            return ".";
+        case 3:
+            return "[a-b]";
+        case 4:
+            return random_pattern(depth + 1) + random_pattern(depth + 1);
+        case 5:
+            return "(" + random_pattern(depth + 1) + "|" + random_pattern(depth + 1) + ")";
+        case 6:
+            return "(?:" + random_solid(depth + 1) + ")" + quantifiers[rng() % 10];
+        case 7:
+            return rng() % 2 ? "^" : "$";
+        default:
+            return random_pattern(depth + 1) + "[^b]";
+    }
+}
+
+int main() {
+    // syntax
+    {
+        check(found_at(mpp::pattern("ab*c"), "xabbbcac", 1, 5), "star");
+        check(found_at(mpp::pattern("a|ab"), "ab", 0, 1), "first alternative wins");
+        check(found_at(mpp::pattern("x(a+?)"), "xaaa", 0, 2), "lazy");
+        check(found_at(mpp::pattern("\\d{2,3}"), "1 12 1234", 2, 2), "counted");
+        check(found_at(mpp::pattern("[^a-c]+"), "abcdefabc", 3, 3), "negated class");
+        check(found_at(mpp::pattern("a$"), "aaa", 2, 1), "end anchor");
+        check(!mpp::pattern("^b").contains("ab"), "begin anchor");
+        check(found_at(mpp::pattern("[\\w.]+@\\w+\\.com"), "mail: jo.doe@example.com", 6, 18), "escapes in class");
+        check(found_at(mpp::pattern("\\x41\\t\\."), "xA\t.", 1, 3), "escapes");
+        check(found_at(mpp::pattern("caf\xc3\xa9"), "un caf\xc3\xa9", 3, 5), "utf-8 literal");
+        check(mpp::pattern("(?:ab|cd){2}").match("abcd") && !mpp::pattern("(?:ab|cd){2}").match("abc"), "match");
+        check(mpp::pattern("a|ab").match("ab"), "match takes any alternative");
+        check(mpp::pattern("").match("") && found_at(mpp::pattern(""), "abc", 0, 0), "empty pattern");
+        check(mpp::pattern("^$").match("") && !mpp::pattern("^$").contains("a"), "empty text");
+
+        mpp::pattern upper("GET /api/v[0-9]+", true);
+        check(upper.contains("get /API/V2/users") && !upper.contains("post /api/v2"), "ignore case");
+        check(mpp::pattern("[^a]", true).search("aAb").position == 2, "ignore case negated class");
+
+        std::vector<mpp::string_ref> words = mpp::pattern("[a-z]+").find_all("one, two;three");
+        check(words.size() == 3 && words[2].equals("three"), "find_all");
+        std::vector<mpp::string_ref> empties = mpp::pattern("a*").find_all("baaa");
+        check(empties.size() == 3 && empties[1].equals("aaa") && empties[2].empty(), "find_all empty matches");
+        check(mpp::pattern("ab").find_all("xabab").size() == 2, "find_all literal");
+        check(mpp::pattern("ab").search("xabab", 2).position == 3, "search from");
+
+        for (const char *bad : {"(ab", "ab)", "[ab", "*a", "a**", "a{2,1}", "a{", "\\1", "(?=a)", "\\b", "a\\",
+                                "^*", "\\q"}) {
+            check(rejects(bad), bad);
+        }
+        check(rejects("a{1001}") && rejects("(a{1000}){1000}"), "too large");
+    }
+
+    // the same matches as std::regex
+    {
+        int disagreements = 0;
+        for (int i = 0; i < 3000; ++i) {
+            std::string source = random_pattern(0);
+            bool icase = i % 4 == 0;
+            std::regex re(source, icase ? std::regex::ECMAScript | std::regex::icase : std::regex::ECMAScript);
+            mpp::pattern p(source, icase);
+            for (int t = 0; t < 8; ++t) {
+                std::string text(rng() % 14, ' ');
+                for (char &c : text) {
+                    c = "abcAB\r"[rng() % 6];
+                }
+                std::smatch m;
+                bool found = std::regex_search(text, m, re);
+                mpp::pattern_match ours = p.search(text);
+                bool same = found == ours.found() && p.contains(text) == found
+                            && p.match(text) == std::regex_match(text, re)
+                            && (!found || (static_cast<size_t>(m.position(0)) == ours.position
+                                           && static_cast<size_t>(m.length(0)) == ours.length));
+                // after an empty match std::regex tries for a longer one at
+                // the same place, find_all() moves on: compare without them
+                std::vector<mpp::string_ref> all = p.find_all(text);
+                std::vector<mpp::string_ref> expected;
+                bool empty_match = false;
+                for (std::sregex_iterator it(text.begin(), text.end(), re), end; it != end; ++it) {
+                    expected.emplace_back(text.data() + it->position(0), static_cast<size_t>(it->length(0)));
+                    empty_match = empty_match || it->length(0) == 0;
+                }
+                for (size_t j = 0; j < expected.size() && !empty_match && same; ++j) {
+                    same = j < all.size() && all[j].data() == expected[j].data() && all[j].size() == expected[j].size();
+                }
+                same = same && (empty_match || all.size() == expected.size());
+                if (!same) {
+                    if (++disagreements <= 5) {
+                        printf("FAILED: %s on %s\n", source.c_str(), text.c_str());
+                    }
+                    break;
+                }
+            }
+        }
+        check(disagreements == 0, "agrees with std::regex");
+    }
+
+    // linear time where backtracking is exponential
+    {
+        std::string text(100000, 'a');
+        auto start = std::chrono::steady_clock::now();
+        check(!mpp::pattern("(a|aa)*b").contains(text), "pathological contains");
+        check(!mpp::pattern("(a*)*b").match(text), "pathological match");
+        check(found_at(mpp::pattern("(a|aa)*"), text, 0, text.size()), "pathological search");
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        printf("pattern: pathological patterns over %zu bytes: %.2f ms\n", text.size(), ms);
+    }
+
+    // more DFA states than the cache holds
+    {
+        std::string text(20000, ' ');
+        for (char &c : text) {
+            c = "ab"[rng() % 2];
+        }
+        mpp::pattern p("[ab]*a[ab]{12}");
+        size_t last_a = text.rfind('a', text.size() - 13);
+        check(found_at(p, text, 0, last_a + 13), "cache flushes");
+        std::string tail = text.substr(0, 5000) + "a" + std::string(12, 'b');
+        check(p.match(tail), "match after flushes");
+    }
+
+    // shared between threads, or copied
+    {
+        mpp::pattern p("user=(\\w+) status=(2|5)\\d\\d");
+        std::string line = "ts=1 user=alice status=503 path=/x";
+        std::vector<std::thread> threads;
+        std::vector<int> counts(4, 0);
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&, t] {
+                mpp::pattern copy = t % 2 == 0 ? p : mpp::pattern(p.source());
+                const mpp::pattern &use = t < 2 ? p : copy;
+                for (int i = 0; i < 2000; ++i) {
+                    counts[t] += use.search(line).length == 21;
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        check(counts == std::vector<int>(4, 2000), "threads");
+    }
+
+    // benchmark: typical log patterns against std::regex
+    {
+        const char *levels[] = {"INFO", "DEBUG", "WARN", "ERROR"};
+        const char *paths[] = {"/api/v1/users/", "/api/v2/orders/", "/static/app.js?v=", "/health"};
+        std::vector<std::string> lines;
+        for (int i = 0; i < 20000; ++i) {
+            lines.push_back("2020-06-01T12:" + std::to_string(10 + i % 50) + ":00Z " + levels[rng() % 4] + " req="
+                            + std::to_string(rng() % 100000) + " client=10.0." + std::to_string(rng() % 256) + "."
+                            + std::to_string(rng() % 256) + " GET " + paths[rng() % 4] + std::to_string(rng() % 1000)
+                            + " status=" + std::to_string(rng() % 5 == 0 ? 500 : 200) + " took="
+                            + std::to_string(rng() % 900) + "ms");
+        }
+        const char *patterns[] = {
+                "ERROR",
+                "timeout|ERROR|WARN",
+                "client=\\d+\\.\\d+\\.\\d+\\.\\d+",
+                "GET /api/v\\d+/users/\\d+",
+                "status=5\\d\\d took=\\d{3}ms",
+                "req=(\\d+) client=10\\.0\\.1\\.",
+        };
+        for (const char *source : patterns) {
+            std::regex re(source);
+            mpp::pattern p(source);
+            auto start = std::chrono::steady_clock::now();
+            size_t expected = 0;
+            for (const auto &line : lines) {
+                std::smatch m;
+                if (std::regex_search(line, m, re)) {
+                    expected += m.position(0) + m.length(0);
+                }
+            }
+            auto mid = std::chrono::steady_clock::now();
+            size_t ours = 0;
+            for (const auto &line : lines) {
+                mpp::pattern_match m = p.search(line);
+                if (m) {
+                    ours += m.position + m.length;
+                }
+            }
+            auto end = std::chrono::steady_clock::now();
+            check(expected == ours, source);
+            printf("pattern: %-32s std::regex %8.2f ms, mpp::pattern %6.2f ms\n", source,
+                   std::chrono::duration<double, std::milli>(mid - start).count(),
+                   std::chrono::duration<double, std::milli>(end - mid).count());
+        }
+    }
+
+    return report("pattern");
+}
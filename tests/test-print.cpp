@@ -0,0 +1,169 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#include <mozart++/print>
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include "check.hpp"
+
+size_t file_size(int fd) {
+    struct stat st;
+    ::fstat(fd, &st);
+    return static_cast<size_t>(st.st_size);
+}
+
+std::string contents(int fd) {
+    std::string result(file_size(fd), '\0');
+    ::pread(fd, &result[0], result.size(), 0);
+    return result;
+}
+
+int main() {
+    char path[] = "/tmp/mpp-print-XXXXXX";
+    int fd = ::mkstemp(path);
+    ::unlink(path);
+
+    // full buffering: nothing reaches the file before a flush
+    {
+        mpp::print_options options;
+        options.flush = mpp::flush_policy::full;
+        mpp::set_print_options(options);
+        mpp::print(fd, "{} + {} = {}\n", 1, 2, 3);
+        mpp::println(fd, "{x} {.2}", 255, 3.14159);
+        mpp::println(fd, "plain");
+        check(file_size(fd) == 0, "buffered");
+        mpp::print_flush();
+        check(contents(fd) == "1 + 2 = 3\n" + mpp::format("{x} {.2}", 255, 3.14159) + "\nplain\n", "flushed");
+    }
+
+    // stream state does not leak from one print() to the next
+    {
+        ::ftruncate(fd, 0);
+        ::lseek(fd, 0, SEEK_SET);
+        mpp::print(fd, "{x}|{:4|*}|", 255, 7);
+        mpp::print(fd, "{}|{:2}", 255, 7);
+        mpp::print_flush();
+        check(contents(fd) == mpp::format("{x}|{:4|*}|", 255, 7) + "255| 7", "state reset");
+    }
+
+    // line and always policies
+    {
+        ::ftruncate(fd, 0);
+        ::lseek(fd, 0, SEEK_SET);
+        mpp::print_options options;
+        options.flush = mpp::flush_policy::line;
+        mpp::set_print_options(options);
+        mpp::print(fd, "no newline ");
+        check(file_size(fd) == 0, "line: held back");
+        mpp::print(fd, "{}\n", "newline");
+        check(contents(fd) == "no newline newline\n", "line: flushed at newline");
+
+        options.flush = mpp::flush_policy::always;
+        mpp::set_print_options(options);
+        mpp::print(fd, "x");
+        check(file_size(fd) == 20, "always");
+    }
+
+    // buffer overflow keeps every print() whole, large strings bypass the buffer
+    {
+        ::ftruncate(fd, 0);
+        ::lseek(fd, 0, SEEK_SET);
+        mpp::print_options options;
+        options.flush = mpp::flush_policy::full;
+        options.buffer_size = 64;
+        mpp::set_print_options(options);
+        std::string expected;
+        for (int i = 0; i < 100; ++i) {
+            mpp::println(fd, "line {}", i);
+            expected += "line " + std::to_string(i) + "\n";
+            // only whole lines were written
+            check(file_size(fd) == 0 || contents(fd).back() == '\n', "whole lines");
+        }
+        std::string big(1000, 'b');
+        mpp::print(fd, "{}", big);
+        expected += big;
+        mpp::println(fd, "end");
+        expected += "end\n";
+        mpp::print_flush();
+        check(contents(fd) == expected, "overflow output");
+    }
+
+    // FILE overload keeps ordering with earlier stdio output
+    {
+        ::ftruncate(fd, 0);
+        ::lseek(fd, 0, SEEK_SET);
+        std::FILE *file = ::fdopen(::dup(fd), "w");
+        std::fputs("stdio ", file);
+        mpp::print(file, "{}", "print");
+        mpp::print_flush();
+        check(contents(fd) == "stdio print", "FILE overload");
+        std::fclose(file);
+    }
+
+    // errors surface as exceptions
+    {
+        int bad = ::open("/dev/null", O_RDONLY);
+        mpp::print_options options;
+        options.flush = mpp::flush_policy::always;
+        mpp::set_print_options(options);
+        bool thrown = false;
+        try {
+            mpp::print(bad, "x");
+        } catch (const mpp::runtime_error &) {
+            thrown = true;
+        }
+        check(thrown, "write error");
+        ::close(bad);
+    }
+
+    // other threads have their own buffers, flushed at thread exit
+    {
+        ::ftruncate(fd, 0);
+        ::lseek(fd, 0, SEEK_SET);
+        std::thread([fd] {
+            mpp::print_options options;
+            options.flush = mpp::flush_policy::full;
+            mpp::set_print_options(options);
+            mpp::print(fd, "from thread\n");
+        }).join();
+        check(contents(fd) == "from thread\n", "thread exit flush");
+    }
+
+    // benchmark: lines to /dev/null
+    {
+        const int n = 200000;
+        int null = ::open("/dev/null", O_WRONLY);
+        std::ofstream stream("/dev/null");
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < n; ++i) {
+            stream << "a log line without arguments" << std::endl;
+        }
+        auto mid = std::chrono::steady_clock::now();
+        mpp::print_options options;
+        options.flush = mpp::flush_policy::full;
+        mpp::set_print_options(options);
+        for (int i = 0; i < n; ++i) {
+            mpp::println(null, "a log line without arguments");
+        }
+        mpp::print_flush();
+        auto end = std::chrono::steady_clock::now();
+        printf("print: ofstream with endl %.1f ns/line, mpp::println %.1f ns/line\n",
+               std::chrono::duration<double, std::nano>(mid - start).count() / n,
+               std::chrono::duration<double, std::nano>(end - mid).count() / n);
+        ::close(null);
+    }
+
+    ::close(fd);
+    return report("print");
+}
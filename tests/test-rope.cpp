@@ -0,0 +1,108 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#include <mozart++/rope>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include "check.hpp"
+
+using mpp::string_ref;
+
+int main() {
+    mpp::rope r("hello");
+    r += ", ";
+    r += std::string(1000, 'x');
+    r += "world";
+    check(r.size() == 1012, "size");
+    check(r.chunk_count() == 3, "small neighbours are merged");
+    check(r.at(0) == 'h' && r[1011] == 'd', "indexing");
+    check(r.substr(1007).equals("world"), "substr of the tail");
+    check(r.find("xworld") == 1006, "find across a chunk boundary");
+    check(r.find(", x") == 5, "find across the merged boundary");
+    check(r.find("hello", 1) == mpp::rope::npos, "find honours start_index");
+    check(!r.contains("xy"), "contains");
+
+    mpp::rope log;
+    for (int i = 0; i < 1000; ++i) {
+        log += "line\n";
+    }
+    check(log.size() == 5000 && log.chunk_count() <= 5000 / 256, "small appends are coalesced");
+
+    mpp::rope copy = r;
+    copy.insert(5, " there");
+    copy.erase(0, 1);
+    check(r.substr(0, 7).equals("hello, "), "copies are independent");
+    check(copy.substr(0, 12).equals("ello there, "), "insert and erase");
+
+    // a match spanning three chunks
+    mpp::rope spans = mpp::rope(std::string(600, 'a')) + mpp::rope(std::string(600, 'b'))
+                      + mpp::rope(std::string(600, 'c'));
+    std::string needle = "a" + std::string(600, 'b') + "c";
+    check(spans.find(needle) == 599, "match spanning several chunks");
+    check(spans.find(needle, 600) == mpp::rope::npos, "spanning match before start_index");
+
+    size_t total = 0;
+    for (string_ref chunk : spans.chunks()) {
+        total += chunk.size();
+    }
+    check(total == 1800, "chunk iteration covers the rope");
+
+    // random edits against a flat reference
+    std::mt19937 rng(42);
+    mpp::rope edited;
+    std::string reference;
+    bool same = true;
+    for (int i = 0; i < 3000 && same; ++i) {
+        size_t pos = reference.empty() ? 0 : rng() % (reference.size() + 1);
+        switch (rng() % 4) {
+            case 0:
+            case 1: {
+                std::string piece(1 + rng() % 300, static_cast<char>('a' + rng() % 26));
+                edited.insert(pos, piece);
+                reference.insert(pos, piece);
+                break;
+            }
+            case 2: {
+                size_t n = rng() % 200;
+                edited.erase(pos, n);
+                reference.erase(pos, n);
+                break;
+            }
+            default: {
+                size_t n = rng() % 500;
+                same = edited.substr(pos, n).equals(string_ref(reference).substr(pos, n));
+                break;
+            }
+        }
+        same = same && edited.size() == reference.size();
+    }
+    check(same && edited.str() == reference, "random edits");
+    check(edited.depth() <= 2 * 20, "tree stays balanced");
+    std::string probe = reference.substr(reference.size() / 2, 40);
+    check(edited.find(probe) == reference.find(probe), "find after random edits");
+
+    // repeated insertion in the middle of a large text
+    std::string text(4 << 20, '.');
+    mpp::rope doc(std::string{text});
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 2000; ++i) {
+        doc.insert(doc.size() / 2, "insert");
+    }
+    double rope_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 2000; ++i) {
+        text.insert(text.size() / 2, "insert");
+    }
+    double string_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    printf("rope: 2000 middle inserts into 4 MiB: rope %.2f ms, std::string %.2f ms\n", rope_ms, string_ms);
+    check(doc.str() == text, "bulk inserts");
+
+    return report("rope");
+}
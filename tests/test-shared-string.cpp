@@ -0,0 +1,77 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#include <mozart++/shared_string>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include "check.hpp"
+
+using mpp::string_ref;
+
+std::vector<mpp::shared_string> tokenize(const std::string &request) {
+    // the request buffer goes away, the tokens must not
+    mpp::shared_string line(request);
+    std::vector<mpp::shared_string> tokens;
+    line.trim().split(tokens, ' ', -1, false);
+    return tokens;
+}
+
+int main() {
+    std::vector<mpp::shared_string> tokens = tokenize("  GET /index.html   HTTP/1.1\r\n");
+    check(tokens.size() == 3, "split");
+    check(tokens[0] == "GET" && tokens[1] == "/index.html" && tokens[2] == "HTTP/1.1", "tokens");
+    check(tokens[0].use_count() == 3, "tokens share one buffer");
+    check(tokens[1].data() - tokens[0].data() == 4, "tokens point into the buffer");
+
+    mpp::shared_string header("Content-Type: text/plain");
+    auto kv = header.split(':');
+    check(kv.first == "Content-Type" && kv.second.trim() == "text/plain", "split pair");
+    check(header.use_count() == 3, "pair halves keep the parent alive");
+    mpp::shared_string value = kv.second.trim();
+    header = mpp::shared_string();
+    kv = std::make_pair(mpp::shared_string(), mpp::shared_string());
+    check(value == "text/plain" && value.use_count() == 1, "parent outlived by its slice");
+    check(!value.is_whole(), "slices are not the whole buffer");
+
+    mpp::shared_string path("/usr/local/lib");
+    check(path.substr(5).startswith("local") && path.slice(1, 4) == "usr", "substr and slice");
+    check(path.rsplit('/').second == "lib" && path.find("local") == 5, "queries mirror string_ref");
+    string_ref found = path.ref().substr(path.find("local"), 5);
+    check(path.share_piece(found) == "local" && path.share_piece(found).data() == found.data(), "share a found piece");
+    bool threw = false;
+    try {
+        path.share_piece("elsewhere");
+    } catch (const mpp::runtime_error &) {
+        threw = true;
+    }
+    check(threw, "pieces must lie inside the string");
+
+    mpp::shared_string empty;
+    check(empty.empty() && empty.use_count() == 0 && empty.substr(0).empty(), "empty string");
+    check(path.substr(100).use_count() == 0, "empty slices do not hold the buffer");
+
+    // copies handed to other threads
+    mpp::shared_string shared(std::string(1000, 'z'));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([shared] {
+            for (int i = 0; i < 10000; ++i) {
+                mpp::shared_string piece = shared.substr(i % 1000, 10);
+                (void) piece;
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    check(shared.use_count() == 1, "reference counts balance across threads");
+
+    return report("shared_string");
+}
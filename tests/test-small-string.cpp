@@ -0,0 +1,114 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#include <mozart++/small_string>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "check.hpp"
+
+using mpp::string_ref;
+
+// a stateful allocator that does not propagate on move assignment
+template <typename T>
+struct tagged_allocator {
+    using value_type = T;
+    int tag;
+
+    explicit tagged_allocator(int t) : tag(t) {}
+
+    template <typename U>
+    tagged_allocator(const tagged_allocator<U> &other) : tag(other.tag) {}
+
+    T *allocate(size_t n) { return std::allocator<T>().allocate(n); }
+
+    void deallocate(T *p, size_t n) { std::allocator<T>().deallocate(p, n); }
+
+    template <typename U>
+    bool operator==(const tagged_allocator<U> &rhs) const { return tag == rhs.tag; }
+
+    template <typename U>
+    bool operator!=(const tagged_allocator<U> &rhs) const { return tag != rhs.tag; }
+};
+
+template <typename StringT>
+double bench_vector(const std::vector<std::string> &keys) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<StringT> strings;
+    for (int round = 0; round < 10; ++round) {
+        strings.clear();
+        for (const auto &key : keys) {
+            strings.emplace_back(key);
+        }
+        std::sort(strings.begin(), strings.end(), [](const StringT &lhs, const StringT &rhs) {
+            return string_ref(lhs).compare(rhs) < 0;
+        });
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main() {
+    mpp::small_string<15> s("hello");
+    check(s.is_inline() && s.size() == 5 && s == "hello", "short string is inline");
+    s += ", world";
+    s.push_back('!');
+    check(s.is_inline() && s == "hello, world!", "append inline");
+    s += " and a much longer tail";
+    check(!s.is_inline() && s == "hello, world! and a much longer tail", "append spills to heap");
+    check(string_ref(s).endswith("tail") && s.ref().find("world") == 7, "string_ref interop");
+
+    s.append(string_ref(s).substr(0, 5));
+    check(s.ref().endswith("tailhello"), "append a slice of itself");
+
+    mpp::small_string<15> moved(std::move(s));
+    check(s.empty() && moved.ref().startswith("hello, world!"), "move steals the heap buffer");
+    moved.resize(3);
+    moved.shrink_to_fit();
+    check(moved.is_inline() && moved == "hel", "shrink back inline");
+
+    mpp::small_string<15> copy = moved;
+    copy[0] = 'H';
+    check(copy == "Hel" && moved == "hel", "copies are independent");
+    check(std::string(copy.c_str()) == "Hel", "null terminated");
+
+    mpp::inline_string<8> fixed("key");
+    fixed += "-42";
+    check(fixed.ref().equals("key-42") && sizeof(fixed) <= 24, "inline_string");
+    bool thrown = false;
+    try {
+        fixed += "overflow";
+    } catch (const mpp::runtime_error &) {
+        thrown = true;
+    }
+    check(thrown, "inline_string overflow");
+
+    check(std::is_trivially_copyable<mpp::inline_string<16>>::value, "inline_string is trivially copyable");
+
+    using tagged_string = mpp::small_string<4, tagged_allocator<char>>;
+    tagged_string first("heap contents of the first", tagged_allocator<char>(1));
+    tagged_string second(tagged_allocator<char>(2));
+    second = std::move(first);
+    check(second == "heap contents of the first" && second.get_allocator().tag == 2,
+          "move assignment across unequal allocators copies");
+    check(std::is_nothrow_move_assignable<mpp::small_string<23>>::value
+          && !std::is_nothrow_move_assignable<tagged_string>::value, "noexcept only when nothing is allocated");
+
+    std::vector<std::string> keys;
+    for (int i = 0; i < 100000; ++i) {
+        // longer than the 15 bytes libstdc++ keeps inline
+        keys.push_back("user:" + std::to_string(i * 7919 % 100000) + ":display_name");
+    }
+    printf("vector<std::string>:        %.1f ms\n", bench_vector<std::string>(keys));
+    printf("vector<small_string<23>>:   %.1f ms\n", bench_vector<mpp::small_string<23>>(keys));
+
+    return report("small_string");
+}
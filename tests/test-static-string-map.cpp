@@ -0,0 +1,136 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#include <mozart++/static_string_map>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "check.hpp"
+
+using mpp::string_ref;
+
+enum class keyword {
+    none, kw_if, kw_else, kw_while, kw_for, kw_return, kw_break, kw_continue, kw_function, kw_var,
+    kw_const, kw_class, kw_new, kw_delete, kw_try, kw_catch, kw_throw, kw_import, kw_export,
+    kw_switch, kw_case, kw_default, kw_true, kw_false, kw_null, kw_this
+};
+
+constexpr mpp::static_string_entry<keyword> keyword_list[] = {
+        {"if",       keyword::kw_if},
+        {"else",     keyword::kw_else},
+        {"while",    keyword::kw_while},
+        {"for",      keyword::kw_for},
+        {"return",   keyword::kw_return},
+        {"break",    keyword::kw_break},
+        {"continue", keyword::kw_continue},
+        {"function", keyword::kw_function},
+        {"var",      keyword::kw_var},
+        {"const",    keyword::kw_const},
+        {"class",    keyword::kw_class},
+        {"new",      keyword::kw_new},
+        {"delete",   keyword::kw_delete},
+        {"try",      keyword::kw_try},
+        {"catch",    keyword::kw_catch},
+        {"throw",    keyword::kw_throw},
+        {"import",   keyword::kw_import},
+        {"export",   keyword::kw_export},
+        {"switch",   keyword::kw_switch},
+        {"case",     keyword::kw_case},
+        {"default",  keyword::kw_default},
+        {"true",     keyword::kw_true},
+        {"false",    keyword::kw_false},
+        {"null",     keyword::kw_null},
+        {"this",     keyword::kw_this},
+};
+
+constexpr auto keywords = mpp::make_static_string_map(keyword_list);
+
+static_assert(keywords.get("while", keyword::none) == keyword::kw_while, "compile-time lookup");
+static_assert(!keywords.contains("whilst"), "compile-time miss");
+
+keyword if_chain(string_ref word) {
+    for (const auto &e : keyword_list) {
+        if (word.equals(e.key)) {
+            return e.value;
+        }
+    }
+    return keyword::none;
+}
+
+int main() {
+    bool all = true;
+    for (const auto &e : keyword_list) {
+        const keyword *found = keywords.find(e.key);
+        all = all && found && *found == e.value;
+    }
+    check(all, "every key is found");
+    check(keywords.find("") == nullptr && keywords.find("If") == nullptr && keywords.find("returns") == nullptr,
+          "misses");
+    check(keywords.size() == 25, "size");
+
+    constexpr auto commands = mpp::make_static_string_map_ignore_case<int>({
+            {"run", 1}, {"sum", 2}, {"I love you", 3}, {"quit", 4}
+    });
+    check(commands.get("RUN", 0) == 1 && commands.get("i LOVE you", 0) == 3, "case insensitive");
+    check(!commands.contains("Q") && commands.at("Quit") == 4, "case insensitive misses");
+
+    // punctuation a bit 0x20 apart is not folded together
+    constexpr auto brackets = mpp::make_static_string_map_ignore_case<int>({
+            {"[x]", 1}, {"{x}", 2}, {"a\\b", 3}, {"a|b", 4}, {"@^", 5}, {"`~", 6}
+    });
+    check(brackets.get("[X]", 0) == 1 && brackets.get("{X}", 0) == 2 && brackets.get("A\\B", 0) == 3
+          && brackets.get("a|B", 0) == 4 && brackets.get("@^", 0) == 5 && brackets.get("`~", 0) == 6,
+          "case insensitive punctuation");
+
+    bool threw = false;
+    try {
+        mpp::static_string_entry<int> duplicates[] = {{"a", 1}, {"b", 2}, {"a", 3}};
+        mpp::make_static_string_map(duplicates);
+    } catch (const mpp::runtime_error &) {
+        threw = true;
+    }
+    check(threw, "duplicate keys are rejected");
+
+    // half hits, half misses
+    std::vector<std::string> words;
+    for (int i = 0; i < 1000; ++i) {
+        words.push_back(keyword_list[i % 25].key.str());
+        words.push_back("identifier" + std::to_string(i));
+    }
+    std::unordered_map<std::string, keyword> hash_map;
+    for (const auto &e : keyword_list) {
+        hash_map.emplace(e.key.str(), e.value);
+    }
+
+    auto bench = [&words](const char *name, keyword (*lookup)(string_ref)) {
+        auto start = std::chrono::steady_clock::now();
+        size_t hits = 0;
+        for (int round = 0; round < 500; ++round) {
+            for (const auto &word : words) {
+                hits += lookup(word) != keyword::none;
+            }
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        printf("static_string_map: %-18s %.1f ns/lookup\n", name, ns / (500.0 * words.size()));
+        return hits;
+    };
+    static std::unordered_map<std::string, keyword> *map_ptr = &hash_map;
+    size_t a = bench("if-chain", if_chain);
+    size_t b = bench("unordered_map", [](string_ref word) {
+        auto it = map_ptr->find(word.str());
+        return it == map_ptr->end() ? keyword::none : it->second;
+    });
+    size_t c = bench("static_string_map", [](string_ref word) {
+        return keywords.get(word, keyword::none);
+    });
+    check(a == b && b == c, "benchmarks agree");
+
+    return report("static_string_map");
+}
@@ -0,0 +1,134 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#include <mozart++/string_builder>
+#include <chrono>
+#include <climits>
+#include <clocale>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include "check.hpp"
+
+using mpp::string_ref;
+
+int main() {
+    mpp::string_builder b;
+    b << "id=" << 42 << ' ' << -7 << ' ' << 0u << ' ' << true;
+    check(b.str() == "id=42 -7 0 true", "strings, chars and integers");
+
+    mpp::string_builder limits;
+    limits << LLONG_MIN << ' ' << ULLONG_MAX;
+    check(limits.str() == "-9223372036854775808 18446744073709551615", "integer limits");
+
+    mpp::string_builder floats;
+    floats << 0.1 << ' ' << 1.5 << ' ' << 1e300 << ' ' << -0.0;
+    check(floats.str() == "0.1 1.5 1e+300 -0", "shortest doubles");
+    bool round_trip = true;
+    srand(7);
+    for (int i = 0; i < 10000; ++i) {
+        double d = static_cast<double>(rand()) / rand() * (i % 2 ? 1e-12 : 1e12);
+        mpp::string_builder one;
+        one << d;
+        round_trip = round_trip && std::strtod(one.str().c_str(), nullptr) == d;
+    }
+    check(round_trip, "doubles read back exactly");
+
+    // any bit pattern, the shortest digits even where "%.15g" is not
+    round_trip = true;
+    for (std::uint64_t bits = 0x9E3779B97F4A7C15ull, i = 0; i < 100000; ++i, bits = bits * 6364136223846793005ull + 1) {
+        double d = 0;
+        std::memcpy(&d, &bits, sizeof(d));
+        mpp::string_builder one;
+        one << d;
+        round_trip = round_trip && (d != d || std::strtod(one.str().c_str(), nullptr) == d);
+    }
+    check(round_trip, "any double reads back exactly");
+    mpp::string_builder edges;
+    edges << 5e-324 << ' ' << 1.7976931348623157e308 << ' ' << 1e16 << ' ' << 9007199254740992.0 << ' ' << 1e-5
+          << ' ' << -1.0 / 0.0 << ' ' << -1.3577664124045e-310;
+    check(edges.str() == "5e-324 1.7976931348623157e+308 1e+16 9007199254740992 1e-05 -inf -1.3577664124045e-310",
+          "edge doubles");
+
+    // the decimal point is '.' whatever the locale
+    for (const char *name : {"de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8"}) {
+        if (std::setlocale(LC_NUMERIC, name) != nullptr) {
+            mpp::string_builder localized;
+            localized << 1.5 << ' ' << 1.25e-300;
+            check(localized.str() == "1.5 1.25e-300", "locale independent doubles");
+            std::setlocale(LC_NUMERIC, "C");
+            break;
+        }
+    }
+
+    mpp::string_builder formatted;
+    formatted.append_format("{} + {} = {.2}", 1, 2, 3.0).append('!');
+    check(formatted.str() == "1 + 2 = 3.00!", "formatted fragments");
+
+    // spill over several chunks
+    mpp::string_builder big(16);
+    std::string reference;
+    for (int i = 0; i < 1000; ++i) {
+        big << "item " << i << '\n';
+        reference += "item " + std::to_string(i) + "\n";
+    }
+    check(big.size() == reference.size() && big.str() == reference, "many chunks");
+    check(big.chunk_count() < 16, "chunks grow geometrically");
+    size_t total = 0;
+    for (string_ref piece : big.pieces()) {
+        total += piece.size();
+    }
+    check(total == reference.size(), "pieces cover the contents");
+#ifdef MOZART_PLATFORM_UNIX
+    check(big.iovecs().size() == big.pieces().size(), "iovecs");
+#endif
+
+    mpp::string_arena arena;
+    string_ref in_arena = big.str(arena);
+    check(in_arena.equals(reference) && in_arena.data()[in_arena.size()] == '\0', "finalize into an arena");
+
+    mpp::string_builder single;
+    single.reserve(64);
+    single << "fits in one chunk";
+    const char *data = single.pieces()[0].data();
+    std::string taken = single.take();
+    check(taken == "fits in one chunk" && taken.data() == data, "take hands over a single chunk");
+    check(single.empty(), "take empties the builder");
+
+    big.clear();
+    big << "again";
+    check(big.str() == "again" && big.chunk_count() == 1, "clear keeps the first chunk");
+
+    auto start = std::chrono::steady_clock::now();
+    size_t stream_size = 0;
+    for (int round = 0; round < 20; ++round) {
+        std::stringstream out;
+        for (int i = 0; i < 10000; ++i) {
+            out << "key" << i << '=' << i * 3 << ';';
+        }
+        stream_size += out.str().size();
+    }
+    double stream_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    size_t builder_size = 0;
+    for (int round = 0; round < 20; ++round) {
+        mpp::string_builder out;
+        for (int i = 0; i < 10000; ++i) {
+            out << "key" << i << '=' << i * 3 << ';';
+        }
+        builder_size += out.take().size();
+    }
+    double builder_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    printf("string_builder: 200k records: stringstream %.2f ms, string_builder %.2f ms\n", stream_ms, builder_ms);
+    check(stream_size == builder_size, "benchmark outputs agree");
+
+    return report("string_builder");
+}
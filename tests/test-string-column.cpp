@@ -0,0 +1,150 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#include <mozart++/string_column>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "check.hpp"
+
+template <typename Pred>
+bool same_selection(const std::vector<std::string> &rows, const mpp::selection_bitmap &bits,
+                    size_t selected, Pred pred) {
+    size_t expected = 0;
+    for (size_t i = 0; i < rows.size(); ++i) {
+        if (bits.size() != rows.size() || bits.test(i) != pred(mpp::string_ref(rows[i]))) {
+            return false;
+        }
+        expected += pred(mpp::string_ref(rows[i]));
+    }
+    return selected == expected && bits.count() == expected;
+}
+
+int main() {
+    // the Arrow layout
+    {
+        std::vector<std::string> rows{"alpha", "", "beta", "", "", "gamma"};
+        mpp::string_column column(rows.begin(), rows.end());
+        check(column.size() == 6 && column.data_size() == 14, "size");
+        const std::int32_t expected[] = {0, 5, 5, 9, 9, 9, 14};
+        check(std::equal(expected, expected + 7, column.offsets()), "offsets");
+        check(mpp::string_ref(column.data(), column.data_size()).equals("alphabetagamma"), "data");
+        check(column[2].equals("beta") && column[1].empty() && column.at(5).equals("gamma"), "rows");
+        bool thrown = false;
+        try {
+            column.at(6);
+        } catch (const std::exception &) {
+            thrown = true;
+        }
+        check(thrown, "at out of range");
+        std::vector<mpp::string_ref> refs = column.refs();
+        check(refs.size() == 6 && refs[5].equals("gamma"), "refs");
+    }
+
+    // dictionary encoding
+    {
+        std::vector<std::string> rows{"red", "green", "red", "blue", "green", "red"};
+        mpp::string_column column(rows.begin(), rows.end(), mpp::column_encoding::dictionary);
+        check(column.size() == 6 && column.dictionary_size() == 3, "dictionary size");
+        check(column.dictionary_value(1).equals("green") && column.indices()[5] == 0, "indices");
+        check(mpp::string_ref(column.data(), column.data_size()).equals("redgreenblue"), "dictionary data");
+        for (size_t i = 0; i < rows.size(); ++i) {
+            check(column[i].equals(rows[i]), "dictionary rows");
+        }
+        column.decode_dictionary();
+        check(column.encoding() == mpp::column_encoding::plain && column.dictionary_size() == 0
+              && column.data_size() == 23 && column[3].equals("blue"), "decode");
+        column.encode_dictionary();
+        check(column.dictionary_size() == 3 && column[4].equals("green"), "encode");
+    }
+
+    // the scans agree with the string_ref methods, in both encodings
+    {
+        std::mt19937 rng(5);
+        const char alphabet[] = "abcab-";
+        std::vector<std::string> rows;
+        for (int i = 0; i < 3000; ++i) {
+            std::string s(rng() % 12, ' ');
+            for (char &c : s) {
+                c = alphabet[rng() % (sizeof(alphabet) - 1)];
+            }
+            rows.push_back(s);
+        }
+        std::vector<std::string> needles{"", "a", "ab", "b-a", "abcab", "cc-", "abcabcabcab", "zz"};
+        for (size_t i = 0; i < 20; ++i) {
+            needles.push_back(rows[rng() % rows.size()]);
+        }
+
+        mpp::string_column plain(rows.begin(), rows.end());
+        mpp::string_column encoded(rows.begin(), rows.end(), mpp::column_encoding::dictionary);
+        mpp::selection_bitmap bits;
+        for (const mpp::string_column *column : {&plain, &encoded}) {
+            for (const auto &n : needles) {
+                mpp::string_ref needle(n);
+                size_t selected = column->equals(needle, bits);
+                check(same_selection(rows, bits, selected, [&](mpp::string_ref s) { return s.equals(needle); }),
+                      "equals");
+                selected = column->starts_with(needle, bits);
+                check(same_selection(rows, bits, selected, [&](mpp::string_ref s) { return s.startswith(needle); }),
+                      "starts_with");
+                selected = column->find(needle, bits);
+                check(same_selection(rows, bits, selected, [&](mpp::string_ref s) { return s.contains(needle); }),
+                      "find");
+            }
+        }
+        // matches across the row boundaries are not matches
+        std::vector<std::string> split{"xa", "b", "", "ab"};
+        mpp::string_column column(split.begin(), split.end());
+        check(column.find("ab", bits) == 1 && bits.test(3), "find within rows");
+        check(column.find("xab", bits) == 0, "find across rows");
+        std::vector<std::string> spanning{"xaa", "bab", "b"};
+        mpp::string_column after(spanning.begin(), spanning.end());
+        check(after.find("ab", bits) == 1 && bits.test(1), "find after a match across rows");
+    }
+
+    // benchmark: a low cardinality column against strings in their own buffers
+    {
+        const size_t n = 1000000;
+        std::mt19937 rng(3);
+        const char *statuses[] = {"ok", "not-found", "redirect-permanent", "redirect-temporary",
+                                  "forbidden", "server-error", "timeout", "unavailable"};
+        std::vector<std::string> strings;
+        mpp::string_column plain;
+        mpp::string_column encoded(mpp::column_encoding::dictionary);
+        size_t string_bytes = 0;
+        for (size_t i = 0; i < n; ++i) {
+            strings.emplace_back(statuses[rng() % 8]);
+            plain.push_back(strings.back());
+            encoded.push_back(strings.back());
+            string_bytes += sizeof(std::string) + (strings.back().size() > 15 ? strings.back().size() + 1 : 0);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        size_t scalar = 0;
+        for (const auto &s : strings) {
+            scalar += mpp::string_ref(s).startswith("redirect-");
+        }
+        auto mid = std::chrono::steady_clock::now();
+        mpp::selection_bitmap bits;
+        size_t scanned = plain.starts_with("redirect-", bits);
+        auto plain_end = std::chrono::steady_clock::now();
+        size_t dictionary = encoded.starts_with("redirect-", bits);
+        auto end = std::chrono::steady_clock::now();
+        check(scalar == scanned && scalar == dictionary, "benchmark agrees");
+        printf("string_column: %zu rows, std::string %.1f MB, plain %.1f MB, dictionary %.1f MB\n", n,
+               string_bytes / 1e6, plain.memory_usage() / 1e6, encoded.memory_usage() / 1e6);
+        printf("string_column: starts_with: strings %.2f ms, plain %.2f ms, dictionary %.2f ms\n",
+               std::chrono::duration<double, std::milli>(mid - start).count(),
+               std::chrono::duration<double, std::milli>(plain_end - mid).count(),
+               std::chrono::duration<double, std::milli>(end - plain_end).count());
+    }
+
+    return report("string_column");
+}
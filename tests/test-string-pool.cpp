@@ -0,0 +1,94 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#include <mozart++/string_pool>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "check.hpp"
+
+using mpp::string_ref;
+
+int main() {
+    mpp::string_pool pool;
+
+    std::string key = "request.header.host";
+    auto id = pool.intern_id(key);
+    string_ref interned = pool.intern(key);
+    key[0] = 'R';
+
+    check(pool.intern_id("request.header.host") == id, "same contents, same id");
+    check(interned.equals("request.header.host"), "pooled copy is independent of the input");
+    check(pool.intern("request.header.host").data() == interned.data(), "same contents, same data");
+    check(pool.intern_id(key) != id, "different contents, different id");
+    check(pool.find("never interned") == mpp::string_pool::invalid_id, "find does not intern");
+    check(pool.lookup(id).equals("request.header.host"), "lookup by id");
+
+    // grow well past the initial table and a single arena chunk
+    std::vector<mpp::string_pool::id_type> ids;
+    for (int i = 0; i < 100000; ++i) {
+        ids.push_back(pool.intern_id("key-" + std::to_string(i)));
+    }
+    bool stable = true;
+    for (int i = 0; i < 100000; ++i) {
+        stable = stable && pool.intern_id("key-" + std::to_string(i)) == ids[i];
+    }
+    check(stable, "ids are stable across rehashing");
+    check(pool.size() == 100002, "distinct strings counted once");
+    check(pool.intern(std::string(200000, 'x')).size() == 200000, "oversized string");
+
+    auto stats = pool.stats();
+    printf("string_pool: %zu strings, %zu lookups, %zu hits, %zu/%zu arena bytes, %zu index bytes\n",
+           stats.strings, stats.lookups, stats.hits,
+           stats.arena_bytes_used, stats.arena_bytes_reserved, stats.index_bytes);
+    check(stats.hits == 100003, "hit count");
+
+    // the source of a move is left empty, and still usable
+    char buffer[64];
+    mpp::string_arena arena(buffer, sizeof(buffer));
+    char *x = arena.allocate<char>(8);
+    mpp::string_arena moved(std::move(arena));
+    char *y = moved.allocate<char>(8);
+    char *z = arena.allocate<char>(8);
+    check(x != y && y != z && arena.bytes_used() == 8, "moved-from arena");
+    arena = std::move(moved);
+    check(arena.allocate<char>(8) != moved.allocate<char>(8), "move assigned arena");
+
+    mpp::string_pool target(std::move(pool));
+    check(target.lookup(id).equals("request.header.host"), "moved pool keeps its strings");
+    check(pool.empty() && pool.find("key-1") == mpp::string_pool::invalid_id, "moved-from pool is empty");
+    check(pool.intern("key-1").equals("key-1") && pool.size() == 1, "moved-from pool interns");
+    pool = std::move(target);
+    check(pool.intern_id("key-1") == ids[1] && target.intern_id("other") == 0, "move assigned pool");
+
+    mpp::string_pool &local = mpp::local_string_pool();
+    check(local.intern("thread").data() == mpp::local_string_pool().intern("thread").data(), "local pool");
+
+    mpp::concurrent_string_pool shared;
+    std::vector<std::thread> threads;
+    std::vector<std::vector<mpp::concurrent_string_pool::id_type>> results(4);
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&shared, &results, t] {
+            for (int i = 0; i < 20000; ++i) {
+                results[t].push_back(shared.intern_id("symbol-" + std::to_string(i)));
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    check(results[0] == results[1] && results[1] == results[2] && results[2] == results[3],
+          "threads agree on ids");
+    check(shared.size() == 20000, "concurrent pool deduplicates");
+    check(shared.lookup(results[0][1234]).equals("symbol-1234"), "concurrent lookup");
+    check(shared.find("symbol-42") == results[0][42], "concurrent find");
+
+    return report("string_pool");
+}
@@ -0,0 +1,144 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#include <mozart++/string_sort>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "check.hpp"
+
+using mpp::string_ref;
+
+bool less(string_ref lhs, string_ref rhs) {
+    return lhs.compare(rhs) < 0;
+}
+
+// same contents and, for a stable sort, the same buffers
+bool same(const std::vector<string_ref> &lhs, const std::vector<string_ref> &rhs, bool identity) {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        if (!lhs[i].equals(rhs[i]) || (identity && lhs[i].data() != rhs[i].data())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<std::string> urls(std::mt19937 &rng, size_t count) {
+    static const char *hosts[] = {"https://www.example.com/", "https://api.example.com/v2/", "http://cdn.example.org/"};
+    std::vector<std::string> result;
+    for (size_t i = 0; i < count; ++i) {
+        result.push_back(std::string(hosts[rng() % 3]) + "users/" + std::to_string(rng() % 50000)
+                         + "/items?page=" + std::to_string(rng() % 100));
+    }
+    return result;
+}
+
+std::vector<std::string> log_keys(std::mt19937 &rng, size_t count) {
+    std::vector<std::string> result;
+    for (size_t i = 0; i < count; ++i) {
+        char key[64];
+        snprintf(key, sizeof(key), "2020-06-%02u %02u:%02u:%02u host-%03u",
+                 unsigned(1 + rng() % 30), unsigned(rng() % 24), unsigned(rng() % 60), unsigned(rng() % 60),
+                 unsigned(rng() % 200));
+        result.push_back(key);
+    }
+    return result;
+}
+
+void verify(const std::vector<std::string> &data, const char *what) {
+    std::vector<string_ref> input(data.begin(), data.end());
+    std::vector<string_ref> expected = input;
+    std::stable_sort(expected.begin(), expected.end(), less);
+
+    mpp::parallel_options options;
+    options.concurrency = 3;
+
+    std::vector<string_ref> sorted = input;
+    mpp::sort_strings(sorted);
+    check(same(sorted, expected, false), what);
+    sorted = input;
+    mpp::sort_strings(sorted, options);
+    check(same(sorted, expected, false), what);
+    sorted = input;
+    mpp::stable_sort_strings(sorted);
+    check(same(sorted, expected, true), what);
+    sorted = input;
+    mpp::stable_sort_strings(sorted, options);
+    check(same(sorted, expected, true), what);
+}
+
+int main() {
+    std::mt19937 rng(3);
+
+    // short strings over a tiny alphabet: duplicates, prefixes and embedded zero bytes
+    for (size_t count : {0, 1, 5, 17, 1000, 100000}) {
+        std::vector<std::string> data;
+        for (size_t i = 0; i < count; ++i) {
+            std::string s;
+            for (size_t n = rng() % 20; n > 0; --n) {
+                s.push_back(std::string("ab\0\xff", 4)[rng() % 4]);
+            }
+            data.push_back(s);
+        }
+        verify(data, "random strings");
+    }
+
+    // long shared prefixes
+    {
+        std::vector<std::string> data;
+        for (int i = 0; i < 50000; ++i) {
+            data.push_back(std::string(rng() % 40, 'x') + std::to_string(rng() % 10));
+        }
+        verify(data, "shared prefixes");
+    }
+
+    // a megabyte of common prefix, without a frame per 8 bytes of it
+    {
+        std::string prefix(1 << 20, 'p');
+        std::vector<std::string> data;
+        for (int i = 0; i < 40; ++i) {
+            data.push_back(prefix + std::to_string(rng() % 20));
+        }
+        data.push_back(prefix);
+        verify(data, "long common prefix");
+    }
+
+    std::vector<std::string> url_data = urls(rng, 200000);
+    std::vector<std::string> log_data = log_keys(rng, 200000);
+    verify(url_data, "urls");
+    verify(log_data, "log keys");
+
+    // benchmark
+    for (const auto *data : {&url_data, &log_data}) {
+        std::vector<string_ref> input(data->begin(), data->end());
+        std::vector<string_ref> a = input;
+        auto t0 = std::chrono::steady_clock::now();
+        std::sort(a.begin(), a.end(), less);
+        auto t1 = std::chrono::steady_clock::now();
+        std::vector<string_ref> b = input;
+        mpp::sort_strings(b);
+        auto t2 = std::chrono::steady_clock::now();
+        std::vector<string_ref> c = input;
+        mpp::sort_strings(c, mpp::parallel_options());
+        auto t3 = std::chrono::steady_clock::now();
+        check(same(a, b, false) && same(a, c, false), "benchmark results");
+        printf("sort_strings (%s): std::sort %.1f ms, sort_strings %.1f ms, parallel %.1f ms\n",
+               data == &url_data ? "urls" : "log keys",
+               std::chrono::duration<double, std::milli>(t1 - t0).count(),
+               std::chrono::duration<double, std::milli>(t2 - t1).count(),
+               std::chrono::duration<double, std::milli>(t3 - t2).count());
+    }
+
+    return report("sort_strings");
+}
@@ -0,0 +1,111 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#include <mozart++/tokenizer>
+#include <mozart++/mapped_file>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "check.hpp"
+
+using mpp::string_ref;
+
+std::vector<std::vector<string_ref>> nested_split(string_ref text, char delimiter) {
+    std::vector<std::vector<string_ref>> rows;
+    for (string_ref line : mpp::lines(text)) {
+        rows.emplace_back();
+        line.split(rows.back(), delimiter);
+    }
+    return rows;
+}
+
+bool same_fields(const mpp::field_table &table, const std::vector<std::vector<string_ref>> &rows) {
+    if (table.row_count() != rows.size()) {
+        return false;
+    }
+    for (size_t r = 0; r < rows.size(); ++r) {
+        if (table[r].size() != rows[r].size()) {
+            return false;
+        }
+        for (size_t c = 0; c < rows[r].size(); ++c) {
+            if (table[r][c].data() != rows[r][c].data() || table[r][c].size() != rows[r][c].size()) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main() {
+    mpp::field_table table;
+    mpp::tokenize("a,b,c\n1,,3\n\nlast,row", table);
+    check(table.row_count() == 4 && table.field_count() == 9, "rows and fields");
+    check(table[0][2].equals("c") && table[1][1].empty() && table[3][1].equals("row"), "field values");
+    check(table[2].size() == 1 && table[2][0].empty(), "empty line");
+
+    mpp::tokenize("x\r\ny\r\n", table);
+    check(table.row_count() == 2 && table[0][0].equals("x") && table[1][0].equals("y"), "crlf");
+
+    mpp::tokenize("", table);
+    check(table.row_count() == 0, "empty input");
+    mpp::tokenize("a,", table);
+    check(table.row_count() == 1 && table[0].size() == 2, "trailing separator");
+
+    mpp::tokenizer_options csv;
+    csv.quoted = true;
+    // the quoted comma and newline straddle a 16-byte block boundary
+    mpp::tokenize("id,text\n1,\"hello, \"\"quoted\"\"\nworld\",x\n2,plain,y\n", table, csv);
+    check(table.row_count() == 3, "quoted newline does not end the row");
+    check(table[1].size() == 3 && mpp::csv_unescape(table[1][1]) == "hello, \"quoted\"\nworld", "quoted field");
+    check(table[2][1].equals("plain") && table[2][2].equals("y"), "row after a quoted field");
+
+    mpp::tokenizer_options tabs;
+    tabs.delimiter = '\t';
+    tabs.trim_cr = false;
+    mpp::tokenize("a\tb\r\n", table, tabs);
+    check(table[0][1].equals("b\r"), "trim_cr off");
+
+    // random text against the nested split
+    std::mt19937 rng(3);
+    std::string text;
+    for (int i = 0; i < 100000; ++i) {
+        text.push_back("ab,\n"[rng() % 4]);
+    }
+    mpp::tokenizer_options plain;
+    plain.trim_cr = false;
+    mpp::tokenize(text, table, plain);
+    check(same_fields(table, nested_split(text, ',')), "random text matches nested split");
+
+    // benchmark on log-like data
+    std::string log;
+    while (log.size() < (32u << 20)) {
+        log += "2020-01-01,12:00:";
+        log += std::to_string(rng() % 60);
+        log += ",INFO,frontend-";
+        log += std::to_string(rng() % 16);
+        log += ",GET,/index.html,200,";
+        log += std::to_string(rng() % 1000);
+        log += "\n";
+    }
+    auto start = std::chrono::steady_clock::now();
+    auto rows = nested_split(log, ',');
+    double nested_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    mpp::tokenize(log, table);
+    double single_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    mpp::tokenize(log, table);
+    double reused_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    printf("tokenizer: 32 MiB, %zu rows: nested split %.1f ms, tokenize %.1f ms, reused table %.1f ms\n",
+           rows.size(), nested_ms, single_ms, reused_ms);
+    check(same_fields(table, rows), "benchmark outputs agree");
+
+    return report("tokenizer");
+}
@@ -0,0 +1,104 @@
+/**
+ * Mozart++ Template Library
+ * Licensed under MIT License
+ * Copyright (c) 2020 Covariant Institute
+ * Website: https://covariant.cn/
+ * Github:  https://github.com/covariant-institute/
+ */
+
+#include <mozart++/codecvt>
+#include <mozart++/unicode>
+#include <cstdio>
+#include <iterator>
+#include <vector>
+#include "check.hpp"
+
+using mpp::string_ref;
+
+int main() {
+    using namespace mpp::unicode;
+
+    check(is_xid_start('a') && is_xid_start('Z'), "ascii letters start");
+    check(!is_xid_start('0') && is_xid_continue('0'), "digits only continue");
+    check(!is_xid_start('_') && is_xid_continue('_'), "underscore only continues");
+    check(!is_xid_continue(' ') && !is_xid_continue('$'), "punctuation");
+    check(is_xid_start(0x4E2D) && is_xid_start(0x3007), "chinese characters");
+    check(is_xid_start(0x00E9) && is_xid_start(0x03B1), "latin-1 and greek letters");
+    check(!is_xid_start(0x0301) && is_xid_continue(0x0301), "combining mark");
+    check(is_xid_continue(0xE0100) && !is_xid_continue(0x10FFFF), "supplementary planes");
+    check(!is_xid_continue(0x110000) && !is_xid_continue(0xFFFFFFFF), "out of range");
+
+    check(scan_identifier("hello world") == 5, "ascii identifier");
+    check(scan_identifier("_tmp1+2") == 5, "underscore identifier");
+    check(scan_identifier("1abc") == 0, "no identifier");
+    check(scan_identifier("") == 0, "empty");
+    check(scan_identifier(u8"变量名 = 1") == 9, "chinese identifier");
+    check(scan_identifier(u8"café.") == 5, "accented identifier");
+    check(scan_identifier("ab\xC0\xAF") == 2, "stops at overlong sequence");
+    check(scan_identifier("ab\xE4\xB8") == 2, "stops at truncated sequence");
+
+    string_ref mixed = u8"ASCII text, then 中文字符 and an emoji 😀 at the end.";
+    check(validate_utf8(mixed), "valid mixed text");
+    check(validate_utf8(""), "valid empty text");
+    check(!validate_utf8("0123456789abcdef\xC0\x80"), "overlong nul");
+    check(!validate_utf8("\xED\xA0\x80"), "surrogate");
+    check(!validate_utf8("\xF4\x90\x80\x80"), "beyond U+10FFFF");
+    check(!validate_utf8("truncated \xE4\xB8"), "truncated sequence");
+    check(!validate_utf8("stray \x80 continuation"), "stray continuation");
+
+    std::u32string wide = U"ASCII text, then 中文字符 and an emoji 😀 at the end.";
+    check(count_code_points(mixed) == wide.size(), "count_code_points");
+    check(utf32_length_from_utf8(mixed.data(), mixed.size()) == wide.size(), "utf32_length_from_utf8");
+    check(utf8_length_from_utf32(wide) == mixed.size(), "utf8_length_from_utf32");
+    check(code_point_offset(mixed, 0) == 0, "offset of first code point");
+    check(code_point_offset(mixed, 17) == 17 && code_point_offset(mixed, 18) == 20, "offset after chinese");
+    check(mixed.substr(code_point_offset(mixed, 35)).startswith(u8"😀 at"), "offset of emoji");
+    check(code_point_offset(mixed, wide.size()) == mixed.size(), "offset of end");
+    check(code_point_offset(mixed, wide.size() + 1) == string_ref::npos, "offset out of range");
+
+    mpp::utf8_view view(u8"a中😀\xFFz");
+    std::vector<char32_t> forward;
+    std::vector<size_t> offsets;
+    for (auto it = view.begin(); it != view.end(); ++it) {
+        forward.push_back(*it);
+        offsets.push_back(it.offset());
+    }
+    check(forward == std::vector<char32_t>{'a', 0x4E2D, 0x1F600, 0xFFFD, 'z'}, "utf8_view forward");
+    check(offsets == std::vector<size_t>{0, 1, 4, 8, 9}, "utf8_view offsets");
+
+    std::vector<char32_t> backward;
+    for (auto it = view.end(); it != view.begin();) {
+        backward.push_back(*--it);
+    }
+    check(backward == std::vector<char32_t>{'z', 0xFFFD, 0x1F600, 0x4E2D, 'a'}, "utf8_view backward");
+    check(view.slice(++view.begin(), view.at_offset(8)).equals(u8"中😀"), "utf8_view slice");
+    for (string_ref bad : {string_ref("a\xFFz"), string_ref("\xE4\xB8"), string_ref("\xC0\xAF\x80x"),
+                           string_ref("\xF0\x9F\x98" "a\xED\xA0\x80"), string_ref(u8"中\x80\x80文")}) {
+        mpp::utf8_view bad_view(bad);
+        check(bad_view.size() == static_cast<size_t>(std::distance(bad_view.begin(), bad_view.end())),
+              "utf8_view size of invalid input");
+    }
+    check(view.size() == 5, "utf8_view size");
+
+    check(mpp::utf8_substr(mixed, 17, 4).equals(u8"中文字符"), "utf8_substr");
+    check(mpp::utf8_substr(mixed, 35).startswith(u8"😀"), "utf8_substr to end");
+    check(mpp::utf8_substr(mixed, 1000).empty(), "utf8_substr out of range");
+    check(mpp::utf8_find_if(mixed, [](char32_t c) { return c > 0x7F; }) == 17, "utf8_find_if");
+    check(mpp::utf8_find_if(mixed, [](char32_t c) { return c == 0x1F600; }, 20) == 43, "utf8_find_if from offset");
+    check(mpp::utf8_find_if_not(mixed, is_xid_start) == 5, "utf8_find_if_not");
+
+    mpp::codecvt::utf8 utf8;
+    mpp::codecvt::ascii ascii;
+    mpp::codecvt::gbk gbk;
+
+    check(utf8.is_identifier(0x4E2D) && utf8.is_identifier('_'), "utf8 is_identifier");
+    check(utf8.scan_identifier(u8"名字(") == 6, "utf8 scan_identifier");
+    check(!ascii.is_identifier(0xE9) && ascii.is_identifier('x'), "ascii is_identifier");
+    check(ascii.scan_identifier("foo_bar baz") == 7, "ascii scan_identifier");
+    check(gbk.is_xid_start(0xD6D0) && !gbk.is_xid_start('9'), "gbk is_xid_start");
+    check(gbk.scan_identifier("\xD6\xD0\xCE\xC4_1 x") == 6, "gbk scan_identifier");
+    check(gbk.scan_identifier("\xD6\xD0\xB1 x") == 2 && gbk.scan_identifier("a\xB1\x7F") == 1,
+          "gbk scan_identifier stops at a bad trail byte");
+
+    return report("unicode");
+}